@@ -0,0 +1,137 @@
+#pragma once
+
+#include "text_analyzer.hpp"
+#include "tokenizer.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Приближённый анализ для корпусов, чьи словари не помещаются в память:
+// частоты — алгоритм Space-Saving (Metwally и др.), число уникальных слов —
+// HyperLogLog. Память фиксирована и не зависит от объёма текста.
+
+// Оценка мощности множества по 64-битным хешам. 2^precision однобайтовых
+// регистров, стандартная относительная ошибка 1.04 / sqrt(2^precision).
+class HyperLogLog
+{
+public:
+    explicit HyperLogLog(unsigned precision = 14);
+
+    void add(std::uint64_t hash) noexcept;
+    double estimate() const;
+    double standard_error() const noexcept;
+
+    // Объединение множеств; точности должны совпадать.
+    void merge(const HyperLogLog& other);
+
+    size_t memory_bytes() const noexcept { return m_registers.size(); }
+
+private:
+    unsigned m_precision;
+    std::vector<std::uint8_t> m_registers;
+};
+
+// Space-Saving: k счётчиков с наибольшими частотами. Каждая оценка завышена
+// не более чем на свою погрешность error, а та — не больше N / k, где N —
+// число слов. Любое слово с частотой больше min_count() гарантированно в таблице.
+class SpaceSaving
+{
+public:
+    struct Entry
+    {
+        std::string word;
+        std::uint64_t hash{0};
+        std::uint64_t count{0}; // оценка сверху
+        std::uint64_t error{0}; // count - error <= истинная частота <= count
+        std::uint32_t length{0};
+        bool stop{false};
+        std::uint32_t heap_pos{0};
+    };
+
+    // Приблизительная стоимость одного счётчика в байтах (запись, куча, индекс);
+    // слова длиннее буфера короткой строки добавляют свою длину.
+    static constexpr size_t kBytesPerCounter = sizeof(Entry) + 3 * sizeof(std::uint32_t);
+
+    explicit SpaceSaving(size_t capacity);
+
+    // Возвращает запись, если слово только что попало в таблицу (новое или
+    // вытеснило другое), — чтобы вызывающий заполнил её атрибуты; иначе nullptr.
+    Entry* add(std::string_view word, std::uint64_t hash, std::uint32_t length);
+
+    // Наименьший счётчик заполненной таблицы (0, пока есть свободные) —
+    // верхняя граница частоты любого слова вне таблицы.
+    std::uint64_t min_count() const noexcept;
+
+    size_t capacity() const noexcept { return m_capacity; }
+    size_t size() const noexcept { return m_entries.size(); }
+    const std::vector<Entry>& entries() const noexcept { return m_entries; }
+
+    // Слияние сводок (Agarwal и др., «Mergeable summaries»): оценки складываются,
+    // отсутствующему в одной из сводок слову добавляется её min_count(), затем
+    // остаются capacity() наибольших. Погрешности складываются.
+    void merge(const SpaceSaving& other);
+
+    size_t memory_bytes() const noexcept;
+
+private:
+    static constexpr std::uint32_t kEmpty = ~std::uint32_t{0};
+
+    size_t m_capacity;
+    std::vector<Entry> m_entries;
+    std::vector<std::uint32_t> m_heap;  // индексы записей, мин-куча по count
+    std::vector<std::uint32_t> m_index; // открытая адресация: хеш -> индекс записи
+    size_t m_mask{0};
+
+    std::uint32_t find(std::string_view word, std::uint64_t hash) const;
+    void index_insert(std::uint32_t entry);
+    void index_erase(std::uint32_t entry);
+    void sift_down(size_t pos);
+    void sift_up(size_t pos);
+    void rebuild(std::vector<Entry> entries);
+};
+
+// Параметры приближённого режима.
+struct ApproxOptions
+{
+    // Общий бюджет памяти счётчиков, байт (HyperLogLog входит в него).
+    size_t memory_budget{16u << 20};
+};
+
+// Аналог StreamingAnalyzer с фиксированной памятью: точны total_words,
+// total_sentences и length_distribution, частоты и unique_words — оценки.
+class ApproxAnalyzer : public TextSink
+{
+public:
+    ApproxAnalyzer(const std::vector<std::string>& stopwords, const ApproxOptions& options);
+    // Множество не копируется и должно жить дольше анализатора.
+    ApproxAnalyzer(const StopwordSet& stopwords, const ApproxOptions& options);
+    ApproxAnalyzer(StopwordSet&&, const ApproxOptions&) = delete;
+
+    void feed(std::string_view chunk) override;
+    void end_block() override;
+
+    // Сливает другой анализатор с теми же параметрами (параллельная обработка).
+    void merge(const ApproxAnalyzer& other);
+
+    // Таблицы топа строятся по счётчикам Space-Saving, в stats.approx — границы ошибок.
+    TextStats finish();
+
+    // Приёмник токенизатора.
+    void on_word(std::string_view word, size_t length);
+    void on_sentence() { ++m_sentences; }
+
+private:
+    ApproxAnalyzer(std::shared_ptr<const StopwordSet> stopwords, const ApproxOptions& options);
+
+    std::shared_ptr<const StopwordSet> m_stops; // своё или внешнее (без владения)
+    size_t m_budget;
+    HyperLogLog m_unique;
+    SpaceSaving m_top;
+    std::uint64_t m_words{0};
+    std::uint64_t m_sentences{0};
+    std::vector<std::uint64_t> m_lengths; // распределение длин, индекс — длина
+    tokenizer::Tokenizer m_tokenizer;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Простая арена для строк: память выделяется крупными блоками и освобождается
+// целиком. Возвращаемые string_view остаются валидными до reset()/разрушения.
+class Arena
+{
+public:
+    explicit Arena(size_t block_size = 64 * 1024);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) noexcept = default;
+    Arena& operator=(Arena&&) noexcept = default;
+
+    char* allocate(size_t n);
+    std::string_view store(std::string_view s);
+
+    // Освобождает всё, кроме первого блока, — для повторного использования.
+    void reset();
+
+    size_t bytes_used() const noexcept { return m_used_total + m_used; }
+    size_t bytes_reserved() const noexcept { return m_reserved; }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    size_t m_block_size;
+    size_t m_next_block;
+    std::vector<Block> m_blocks;
+    size_t m_used{0};        // занято в текущем (последнем) блоке
+    size_t m_used_total{0};  // занято в предыдущих блоках
+    size_t m_reserved{0};    // сумма размеров блоков
+};
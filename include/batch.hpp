@@ -0,0 +1,85 @@
+#pragma once
+
+#include "approx.hpp"
+#include "read_ahead.hpp"
+#include "text_analyzer.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ExternalCounter;
+class PackReader;
+
+struct FileError
+{
+    std::string path;
+    std::string message;
+};
+
+struct BatchResult
+{
+    TextStats stats;
+    size_t files_total{0};
+    size_t files_ok{0};
+    std::vector<FileError> failed;
+
+    // Затраты на ввод-вывод, суммарно по всем потокам.
+    size_t bytes_read{0};
+    long long read_ns{0};
+    // Бэкенд упреждающего чтения ("io_uring" или "threads"); пусто — без него.
+    std::string read_ahead_backend;
+};
+
+// Сопоставление имени файла с шаблоном: '*' — любая подстрока, '?' — один символ.
+bool match_glob(std::string_view pattern, std::string_view name);
+
+// Файлы каталога dir (без рекурсии), имена которых подходят под pattern.
+// Результат отсортирован, чтобы порядок обработки не зависел от ФС.
+std::vector<std::string> list_directory(const std::string& dir, const std::string& pattern);
+
+// Файлы каталога dir по умолчанию для --input-dir: *.json и сжатые *.json.gz, *.json.zst.
+std::vector<std::string> list_json_files(const std::string& dir);
+
+// Шаблон вида "data/generated/text_*.json": каталог + шаблон имени.
+std::vector<std::string> expand_glob(const std::string& path_pattern);
+
+// Список путей из текстового файла, по одному на строку (пустые строки пропускаются).
+std::vector<std::string> read_file_list(const std::string& list_path);
+
+// Параллельный анализ набора файлов: чтение -> json::Parser::parse ->
+// extract_text_blocks -> analyze_text. Каждый поток копит свою TextStats,
+// в конце они сливаются. Ошибочные файлы не прерывают обработку, а попадают в failed.
+// С approx каждый поток ведёт ApproxAnalyzer, бюджет памяти делится между потоками.
+// С external (external_count.hpp) таблицы потоков сбрасываются прогонами в него:
+// бюджет делится между потоками, а потоков не больше, чем уместится в бюджет;
+// в stats тогда только итоги, словарь достраивает ExternalCounter::finish.
+BatchResult analyze_files(const std::vector<std::string>& files,
+                          const StopwordSet& stopwords,
+                          size_t threads,
+                          const std::optional<ApproxOptions>& approx = std::nullopt,
+                          ExternalCounter* external = nullptr);
+BatchResult analyze_files(const std::vector<std::string>& files,
+                          const std::vector<std::string>& stopwords,
+                          size_t threads,
+                          const std::optional<ApproxOptions>& approx = std::nullopt);
+// С упреждающим чтением (read_ahead.hpp): файлы читает отдельная стадия ввода,
+// рабочие потоки берут уже прочитанные в порядке готовности.
+BatchResult analyze_files(const std::vector<std::string>& files,
+                          const StopwordSet& stopwords,
+                          size_t threads,
+                          const ReadAheadOptions& read_ahead,
+                          const std::optional<ApproxOptions>& approx = std::nullopt,
+                          ExternalCounter* external = nullptr);
+
+// То же для упакованного корпуса (pack.hpp): документы берутся прямо из
+// отображённого файла, без системных вызовов на документ. Документы с
+// предызвлечённым текстом не разбираются; ошибки указываются по именам документов.
+BatchResult analyze_pack(const PackReader& pack,
+                         const StopwordSet& stopwords,
+                         size_t threads,
+                         const std::optional<ApproxOptions>& approx = std::nullopt,
+                         ExternalCounter* external = nullptr);
+
+std::string format_batch_summary(const BatchResult& result);
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <optional>
+#include <vector>
 
 struct CliOptions
 {
@@ -10,9 +11,66 @@ struct CliOptions
     std::optional<std::string> input_path;
     std::optional<std::string> stops_path;
     std::optional<std::string> output_path;
+    // Сохранить загруженные стоп-слова в двоичный файл StopwordSet.
+    std::optional<std::string> save_stops_path;
+
+    // Пакетный режим: каталог, шаблон пути или файл со списком путей.
+    std::optional<std::string> input_dir;
+    std::optional<std::string> input_glob;
+    std::optional<std::string> file_list;
+    // Упакованный корпус (textfreq_pack): документы читаются из одного отображённого файла.
+    std::optional<std::string> pack_path;
+    size_t threads{0};
+    // Упреждающее чтение файлов пакетного режима: глубина очереди (0 — выключено)
+    // и предел памяти под прочитанные, но ещё не разобранные файлы.
+    size_t read_ahead{0};
+    size_t read_ahead_memory_mb{64};
+    // Локальный map/reduce: число процессов map (fork), 0 — без них.
+    size_t processes{0};
+    // Инкрементальный режим: снапшот корпуса, обновляемый по списку файлов.
+    std::optional<std::string> update_path;
+
+    // Серверный режим: путь Unix-сокета или "-" для stdin/stdout (см. server.hpp).
+    std::optional<std::string> serve_path;
+    // Именованные наборы стоп-слов сервера (NAME=PATH), выбираемые запросом stops=NAME.
+    std::vector<std::string> serve_stops;
+
+    // Распределённый режим (partial.hpp): подкоманда "map" — анализ шарда --shard i/N
+    // в частичный файл, "reduce" — слияние частичных файлов в отчёт; пусто — обычный запуск.
+    std::string command;
+    std::optional<std::string> shard;
+    std::vector<std::string> partials;
+
+    // Потоковый режим: SAX-разбор входа окнами, текст сразу уходит в анализатор.
+    bool stream{false};
+    // Вход NDJSON: по документу на строку, из файла или stdin (--input -).
+    bool ndjson{false};
+
+    // Приближённый режим: Space-Saving + HyperLogLog в фиксированной памяти.
+    bool approx{false};
+    size_t approx_memory_mb{16};
+
+    // Внешний подсчёт (external_count.hpp): бюджет таблиц подсчёта в МБ (0 — выключен)
+    // и каталог для прогонов (по умолчанию системный временный).
+    size_t mem_limit_mb{0};
+    std::optional<std::string> spill_dir;
+
+    // Профиль по этапам в stderr: таблица или JSON.
+    bool profile{false};
+    std::string profile_format{"table"};
+
+    // Частоты n-грамм вместо слов (2 или 3; 0 — выключено).
+    size_t ngram{0};
+    bool keep_stop_ngrams{false};
 
     std::string report_type{"freq"};
     size_t top_n{20};
+    // Формат отчёта: text, json, csv или bin (см. report_writer.hpp).
+    std::string format{"text"};
+    // Перезаписывать --output без вопроса.
+    bool force{false};
+
+    bool batch_mode() const { return input_dir || input_glob || file_list || pack_path; }
 };
 
 CliOptions parse_arguments(int argc, char** argv);
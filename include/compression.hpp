@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Сжатые входные файлы (.gz, .zst) читаются без временных файлов: сжатые
+// данные распаковываются кусками прямо в буфер разбора или в поток SAX.
+// gzip поддерживается через zlib, zstd — через libzstd, если CMake их нашёл;
+// иначе открытие такого файла завершается понятной ошибкой.
+
+enum class Compression
+{
+    None,
+    Gzip,
+    Zstd,
+};
+
+// Формат по расширению пути: ".gz" — gzip, ".zst" — zstd, иначе None.
+Compression compression_of(std::string_view path);
+
+const char* compression_name(Compression kind);
+
+// Собрана ли поддержка формата (None поддерживается всегда).
+bool compression_supported(Compression kind);
+
+// Бросает std::runtime_error с путём файла, если его формат не поддерживается сборкой.
+void require_compression_support(const std::string& path, Compression kind);
+
+// Потоковый распаковщик: сжатые данные подаются кусками любого размера.
+// Склеенные потоки (несколько gzip-членов или zstd-кадров подряд)
+// распаковываются как один. Ошибки формата — std::runtime_error.
+class Decompressor
+{
+public:
+    // Бросает std::runtime_error, если поддержка формата не собрана.
+    explicit Decompressor(Compression kind);
+    ~Decompressor();
+
+    Decompressor(const Decompressor&) = delete;
+    Decompressor& operator=(const Decompressor&) = delete;
+
+    // Распаковывает начало in в out[0..capacity): in сдвигается на поглощённые
+    // байты, возвращается число записанных. 0 при непустом in не бывает, пока
+    // есть место в out.
+    size_t run(std::string_view& in, char* out, size_t capacity);
+
+    // Последний начатый поток завершён: если вход кончился, данные целые.
+    bool complete() const noexcept { return m_complete; }
+
+    // Готовит распаковщик к новым данным без повторного выделения памяти.
+    void reset();
+
+    Compression kind() const noexcept { return m_kind; }
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+    Compression m_kind;
+    bool m_complete{true};
+};
+
+// Распаковывает data целиком в out (ёмкость out переиспользуется).
+void decompress(std::string_view data, Compression kind, std::string& out);
+
+// Сжимает data (для тестов, бенчмарков и подготовки корпусов).
+std::string compress(std::string_view data, Compression kind);
+
+// Поток для чтения файла: сжатый распаковывается на лету кусками по 64 КБ,
+// несжатый открывается как std::ifstream. Бросает std::runtime_error, если
+// файл не открылся или формат не поддерживается.
+std::unique_ptr<std::istream> open_input_stream(const std::string& path);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "text_analyzer.hpp"
+#include "vocabulary.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Внешний подсчёт (--mem-limit) для словарей, которые не помещаются в память.
+//
+// Анализатор (StreamingAnalyzer::spill_to) считает слова в таблице
+// фиксированного размера; когда она заполняется, таблица сбрасывается на диск
+// прогоном — парами (слово, частота), отсортированными по слову, — и
+// очищается. В конце прогоны сливаются k-путевым слиянием: каждое слово
+// встречается один раз с точной суммарной частотой, в порядке возрастания
+// (как в TextStats::word_freq). Отчёт совпадает с обычным подсчётом в памяти.
+//
+// Бюджет покрывает таблицы подсчёта (хеш-таблица, столбцы словаря, строки в
+// арене, порядок сортировки), буферы записи прогонов и слияние (буферы и
+// читатели прогонов, текущие слова); буферы ввода и разбора JSON и строки
+// топа в него не входят. Если прогонов больше, чем читателей помещается в
+// бюджет, слияние идёт в несколько проходов.
+//
+// Формат прогона (порядок байт машины: прогоны живут только до конца запуска):
+// заголовок, затем записи
+//   частота u64 | длина слова в байтах u32 | длина в символах u32 (старший бит — стоп-слово) | байты слова
+class ExternalCounter
+{
+public:
+    // Буфер записи и чтения одного прогона.
+    static constexpr size_t kIoBuffer = 64 * 1024;
+    // Наименьший бюджет одного анализатора: таблица, арена и буфер записи.
+    static constexpr size_t kMinLimit = 256 * 1024;
+
+    // memory_limit — бюджет памяти в байтах (не меньше kMinLimit, иначе
+    // std::runtime_error); прогоны пишутся в новый подкаталог temp_dir
+    // (пусто — системный временный каталог), который удаляется в деструкторе.
+    explicit ExternalCounter(size_t memory_limit, const std::string& temp_dir = {});
+    ~ExternalCounter();
+
+    ExternalCounter(const ExternalCounter&) = delete;
+    ExternalCounter& operator=(const ExternalCounter&) = delete;
+
+    size_t memory_limit() const noexcept { return m_limit; }
+
+    // Сколько анализаторов уместится в бюджет, если их просят threads
+    // (0 — по числу аппаратных потоков): на каждый не меньше kMinLimit.
+    size_t workers(size_t threads) const;
+
+    // Записывает слова vocab с ненулевой частотой прогоном, отсортированным по
+    // слову; order — рабочий массив вызывающего. Можно вызывать из разных потоков.
+    void spill(const Vocabulary& vocab, std::vector<Vocabulary::Id>& order);
+
+    // Сброшенных прогонов, слов и байт в них (промежуточные слияния не считаются).
+    size_t runs() const;
+    std::uint64_t spilled_words() const;
+    std::uint64_t spilled_bytes() const;
+    // Промежуточных слияний, если прогонов было больше, чем буферов в бюджете.
+    size_t intermediate_merges() const noexcept { return m_intermediate_merges; }
+
+    // Сливает все прогоны: visit вызывается по разу на слово в порядке
+    // возрастания слов. Промежуточные проходы заменяют прогоны слитыми, поэтому
+    // повторный вызов читает уже меньше файлов.
+    using Visitor =
+        std::function<void(std::string_view word, std::uint64_t count, bool stop, std::uint32_t length)>;
+    void merge(const Visitor& visit);
+
+    // Достраивает статистику по прогонам: unique_words, length_distribution и
+    // словарь из строк топа top_n обеих таблиц отчёта (top_words по нему даёт
+    // тот же топ, что и по полному словарю). total_words и total_sentences уже
+    // посчитаны анализаторами; word_freq и word_freq_no_stops остаются пустыми —
+    // полные частоты отдаёт merge.
+    void finish(TextStats& stats, size_t top_n);
+
+private:
+    size_t m_limit;
+    std::string m_dir;
+    mutable std::mutex m_mutex;
+    std::vector<std::string> m_runs;
+    size_t m_next_run{0};
+    size_t m_spilled_runs{0};
+    std::uint64_t m_spilled_words{0};
+    std::uint64_t m_spilled_bytes{0};
+    size_t m_max_word{0}; // самое длинное слово прогонов: столько держит каждый читатель слияния
+    size_t m_intermediate_merges{0};
+
+    std::string next_run_path();
+};
+
+// Строка для вывода после отчёта: число прогонов, их объём и промежуточные слияния.
+std::string format_external_summary(const ExternalCounter& counter);
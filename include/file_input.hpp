@@ -0,0 +1,52 @@
+#pragma once
+
+#include "compression.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Содержимое входного файла без лишних копий.
+// Крупные обычные файлы отображаются в память (mmap + madvise(MADV_SEQUENTIAL)),
+// маленькие читаются одним pread, а каналы и устройства — в тот же
+// переиспользуемый буфер. Сжатые файлы (.gz, .zst; см. compression.hpp)
+// распаковываются кусками в тот же буфер, без временных файлов.
+// Парсер и токенизатор работают прямо с view().
+// Объект можно переиспользовать для следующего файла: буфер не освобождается.
+// При ошибке открытия или чтения бросает std::runtime_error.
+class InputFile
+{
+public:
+    // Файлы меньше порога читаются в буфер: mmap для них дороже одного pread.
+    static constexpr size_t kMmapThreshold = 64 * 1024;
+
+    InputFile() = default;
+    explicit InputFile(const std::string& path) { open(path); }
+    ~InputFile();
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    // Открывает path; прежнее содержимое (и все view на него) становятся недействительными.
+    void open(const std::string& path);
+    void close();
+
+    std::string_view view() const noexcept { return m_view; }
+    bool mapped() const noexcept { return m_map != nullptr; }
+
+private:
+    void* m_map{nullptr};
+    size_t m_map_size{0};
+
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_capacity{0};
+
+    std::unique_ptr<char[]> m_chunk; // сжатые данные при распаковке
+    std::unique_ptr<Decompressor> m_decoder;
+
+    std::string_view m_view;
+
+    char* reserve(size_t size);
+    void open_compressed(const std::string& path, Compression kind);
+};
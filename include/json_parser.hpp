@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 #include <map>
@@ -38,21 +39,52 @@ namespace json
         size_t m_position;
     };
 
+    // Предел вложенности массивов и объектов: глубже разбор сообщает ParseError,
+    // а не переполняет стек рекурсией.
+    constexpr size_t kMaxDepth = 1024;
+
+    class Tape;
+    class SaxHandler;
+
     class Parser
     {
     public:
-        explicit Parser(const std::string& text);
+        explicit Parser(std::string_view text);
         Value parse();
 
+        // Разбор в плоскую ленту (см. json_tape.hpp). Лента очищается перед разбором.
+        void parse(Tape& tape);
+
+        // Событийный (SAX) разбор без построения дерева (см. json_sax.hpp).
+        void parse(SaxHandler& handler);
+
     private:
-        const std::string& m_text;
+        std::string_view m_text;
         size_t m_pos{0};
+        size_t m_depth{0};
+        std::string m_scratch;
 
         void skip_whitespace();
-        bool match(char c);
-        char peek() const;
-        char get();
-        bool eof() const;
+
+        bool eof() const { return m_pos >= m_text.size(); }
+        char peek() const { return eof() ? '\0' : m_text[m_pos]; }
+
+        char get()
+        {
+            if (eof())
+                error("Unexpected end of input");
+            return m_text[m_pos++];
+        }
+
+        bool match(char c)
+        {
+            if (!eof() && m_text[m_pos] == c)
+            {
+                ++m_pos;
+                return true;
+            }
+            return false;
+        }
 
         Value parse_value();
         Value parse_null();
@@ -63,6 +95,14 @@ namespace json
         Value parse_array();
         Value parse_object();
         std::string parse_raw_string();
+        void parse_raw_string_into(std::string& out);
+        void append_escape(std::string& out);
+        double parse_number_value();
+        void expect_literal(std::string_view literal);
+
+        void enter_container();
+        void parse_tape_value(Tape& tape);
+        std::string_view parse_tape_string(Tape& tape);
 
         [[noreturn]] void error(const std::string& msg) const;
     };
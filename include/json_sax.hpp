@@ -0,0 +1,87 @@
+#pragma once
+
+#include "json_parser.hpp"
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace json
+{
+    // Обработчик событий SAX-разбора. По умолчанию все события игнорируются.
+    class SaxHandler
+    {
+    public:
+        virtual ~SaxHandler() = default;
+
+        virtual void on_null() {}
+        virtual void on_bool(bool) {}
+        virtual void on_number(double) {}
+
+        // Начало строкового значения. Вернуть true, если содержимое нужно:
+        // тогда оно придёт одним или несколькими on_string_chunk (уже без
+        // экранирований), иначе строка пропускается без копирования.
+        virtual bool on_string_begin() { return false; }
+        virtual void on_string_chunk(std::string_view) {}
+        virtual void on_string_end() {}
+
+        // Ключ объекта; view действителен только во время вызова.
+        virtual void on_key(std::string_view) {}
+
+        virtual void on_object_begin() {}
+        virtual void on_object_end() {}
+        virtual void on_array_begin() {}
+        virtual void on_array_end() {}
+    };
+
+    // Событийный разбор JSON. Вход — либо буфер в памяти, либо поток, который
+    // читается окнами фиксированного размера: документ любого размера
+    // разбирается в постоянной памяти (длинные строки отдаются кусками).
+    class SaxParser
+    {
+    public:
+        explicit SaxParser(std::string_view text);
+        explicit SaxParser(std::istream& in, size_t buffer_size = 64 * 1024);
+
+        void parse(SaxHandler& handler);
+
+        // Байт входа, прочитанных к этому моменту (после parse — весь документ).
+        size_t bytes_read() const noexcept { return m_offset + m_size; }
+
+    private:
+        std::istream* m_in{nullptr};
+        std::unique_ptr<char[]> m_buffer;
+        size_t m_capacity{0};
+
+        const char* m_data{nullptr};
+        size_t m_size{0};
+        size_t m_pos{0};
+        size_t m_offset{0}; // позиция начала окна во всём входе
+        size_t m_depth{0};  // открытых массивов и объектов (не больше kMaxDepth)
+
+        std::string m_key;
+        std::string m_number;
+
+        bool refill();
+        bool eof();
+        char peek();
+        char get();
+        bool match(char c);
+        void skip_whitespace();
+
+        void parse_value(SaxHandler& handler);
+        void parse_literal(std::string_view literal);
+        void parse_number(SaxHandler& handler);
+        void parse_string(SaxHandler& handler, bool wanted);
+        void parse_key(SaxHandler& handler);
+        void parse_array(SaxHandler& handler);
+        void parse_object(SaxHandler& handler);
+        // Декодирует экранирование после '\\'; байты результата уходят в emit(string_view).
+        template <typename Emit>
+        void parse_escape(Emit&& emit);
+
+        [[noreturn]] void error(const std::string& msg) const;
+    };
+
+} // namespace json
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTFREQ_JSON_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// Общие для json::Parser и json::SaxParser примитивы сканирования: поиск конца
+// неэкранированного участка строки и пропуск пробелов блоками по 16 байт (SSE2
+// входит в базовый x86-64; на прочих платформах — побайтовый цикл), а также
+// разбор чисел через std::from_chars и декодирование экранирований, включая
+// \uXXXX с суррогатными парами.
+namespace json::scan
+{
+    inline bool is_space(char c) noexcept
+    {
+        // Те же символы, что у std::isspace в локали "C".
+        return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+    }
+
+#if defined(TEXTFREQ_JSON_SSE2)
+    inline unsigned first_bit(unsigned mask) noexcept
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+#endif
+
+    // Длина префикса p[0..size) без '"' и '\\' (size, если их нет).
+    inline size_t string_run(const char* p, size_t size) noexcept
+    {
+        size_t i = 0;
+#if defined(TEXTFREQ_JSON_SSE2)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            const unsigned mask = static_cast<unsigned>(
+                _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, quote), _mm_cmpeq_epi8(c, backslash))));
+            if (mask != 0)
+                return i + first_bit(mask);
+        }
+#endif
+        while (i < size && p[i] != '"' && p[i] != '\\')
+            ++i;
+        return i;
+    }
+
+    // Длина префикса p[0..size) из пробельных символов.
+    inline size_t space_run(const char* p, size_t size) noexcept
+    {
+        // Чаще всего пробелов нет или он один: векторный путь — только для отступов.
+        if (size == 0 || !is_space(p[0]))
+            return 0;
+        if (size == 1 || !is_space(p[1]))
+            return 1;
+        size_t i = 2;
+#if defined(TEXTFREQ_JSON_SSE2)
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i range = _mm_set1_epi8('\r' - '\t');
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            // '\t'..'\r': беззнаковое c - '\t' <= 4, то есть min(c - '\t', 4) == c - '\t'.
+            const __m128i shifted = _mm_sub_epi8(c, tab);
+            const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, range), shifted);
+            const unsigned mask = static_cast<unsigned>(
+                _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, space), control)));
+            if (mask != 0xFFFF)
+                return i + first_bit(~mask & 0xFFFF);
+        }
+#endif
+        while (i < size && is_space(p[i]))
+            ++i;
+        return i;
+    }
+
+    // Число JSON (синтаксис уже проверен) в double без зависимости от локали;
+    // false — значение вне диапазона double.
+    inline bool to_double(std::string_view text, double& value)
+    {
+#if defined(__cpp_lib_to_chars)
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && end == text.data() + text.size();
+#else
+        try
+        {
+            value = std::stod(std::string(text));
+            return true;
+        }
+        catch (...)
+        {
+            return false;
+        }
+#endif
+    }
+
+    inline int hex_digit(char c) noexcept
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // Кодовая точка в UTF-8; возвращает число записанных байт (1..4).
+    inline size_t encode_utf8(std::uint32_t cp, char* out) noexcept
+    {
+        if (cp < 0x80)
+        {
+            out[0] = static_cast<char>(cp);
+            return 1;
+        }
+        if (cp < 0x800)
+        {
+            out[0] = static_cast<char>(0xC0 | (cp >> 6));
+            out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 2;
+        }
+        if (cp < 0x10000)
+        {
+            out[0] = static_cast<char>(0xE0 | (cp >> 12));
+            out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<char>(0xF0 | (cp >> 18));
+        out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 4;
+    }
+
+    constexpr std::uint32_t kReplacement = 0xFFFD;
+
+    // Декодирует экранирование, когда '\\' уже прочитан. Источник src даёт
+    // get() (следующий байт; в конце входа сам сообщает об ошибке), peek()
+    // ('\0' в конце) и error(сообщение); байты результата уходят в
+    // emit(std::string_view). Суррогатная пара даёт одну кодовую точку, а
+    // одиночный суррогат заменяется на U+FFFD, как это делают браузеры и Python.
+    template <typename Source, typename Emit>
+    void decode_escape(Source& src, Emit&& emit)
+    {
+        auto simple = [&src](char esc) -> char {
+            switch (esc)
+            {
+            case '"': return '"';
+            case '\\': return '\\';
+            case '/': return '/';
+            case 'b': return '\b';
+            case 'f': return '\f';
+            case 'n': return '\n';
+            case 'r': return '\r';
+            case 't': return '\t';
+            default:
+                src.error("Unsupported escape sequence");
+            }
+        };
+        auto hex4 = [&src]() -> std::uint32_t {
+            std::uint32_t value = 0;
+            for (int k = 0; k < 4; ++k)
+            {
+                const int digit = hex_digit(src.get());
+                if (digit < 0)
+                    src.error("Invalid \\u escape");
+                value = value << 4 | static_cast<std::uint32_t>(digit);
+            }
+            return value;
+        };
+        auto put = [&emit](std::uint32_t cp) {
+            char bytes[4];
+            emit(std::string_view(bytes, encode_utf8(cp, bytes)));
+        };
+        auto is_high = [](std::uint32_t cp) { return cp >= 0xD800 && cp <= 0xDBFF; };
+        auto is_low = [](std::uint32_t cp) { return cp >= 0xDC00 && cp <= 0xDFFF; };
+
+        const char esc = src.get();
+        if (esc != 'u')
+        {
+            const char c = simple(esc);
+            emit(std::string_view(&c, 1));
+            return;
+        }
+        std::uint32_t cp = hex4();
+        // Старшая половина пары: младшая (DC00..DFFF) должна идти сразу следом.
+        while (is_high(cp))
+        {
+            if (src.peek() != '\\')
+                return put(kReplacement);
+            src.get();
+            const char next = src.get();
+            if (next != 'u')
+            {
+                put(kReplacement);
+                const char c = simple(next);
+                emit(std::string_view(&c, 1));
+                return;
+            }
+            const std::uint32_t low = hex4();
+            if (is_low(low))
+                return put(0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00));
+            put(kReplacement);
+            cp = low;
+        }
+        put(is_low(cp) ? kReplacement : cp);
+    }
+} // namespace json::scan
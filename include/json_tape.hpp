@@ -0,0 +1,62 @@
+#pragma once
+
+#include "arena.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace json
+{
+    enum class NodeType : std::uint8_t
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    // Узел плоской ленты. Поддерево узла занимает индексы [i, end):
+    // у объекта за узлом идут пары «ключ (String) — значение», у массива — элементы.
+    struct TapeNode
+    {
+        NodeType type{NodeType::Null};
+        bool boolean{false};
+        std::uint32_t count{0}; // Array: число элементов, Object: число пар
+        std::uint32_t end{0};   // индекс узла, следующего за поддеревом
+        double number{0.0};
+        std::string_view str;   // String: срез входа (без экранирований) или арены
+    };
+
+    // Альтернативный DOM: все узлы лежат в одном векторе, строки без
+    // экранирований ссылаются прямо во входной буфер, остальные — в арену.
+    // Входной буфер должен жить не меньше ленты. Ленту выгодно переиспользовать
+    // между документами: clear() сохраняет выделенную память.
+    class Tape
+    {
+    public:
+        void clear();
+
+        size_t size() const noexcept { return m_nodes.size(); }
+        bool empty() const noexcept { return m_nodes.empty(); }
+        const TapeNode& operator[](size_t i) const { return m_nodes[i]; }
+
+        static constexpr size_t root() noexcept { return 0; }
+
+        // Индекс следующего соседа (узла после поддерева i).
+        size_t next(size_t i) const { return m_nodes[i].end; }
+
+        // Значение по ключу в объекте object (первое вхождение, как в json::Object).
+        std::optional<size_t> find(size_t object, std::string_view key) const;
+
+    private:
+        friend class Parser;
+
+        std::vector<TapeNode> m_nodes;
+        Arena m_arena{4096};
+    };
+
+} // namespace json
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "json_tape.hpp"
+#include "text_analyzer.hpp"
+
+#include <atomic>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Потоковый вход NDJSON (--ndjson): по JSON-документу на строку, в том числе
+// из stdin (--input -). Документы разбираются по одному, их текст сразу уходит
+// в анализатор, поэтому память не зависит от длины потока.
+
+// Построчное чтение потока окнами в переиспользуемый буфер: строка, целиком
+// лежащая в буфере, отдаётся без копирования, незавершённый хвост переносится
+// в начало. Буфер не больше окна плюс самая длинная строка (до max_line).
+class LineReader
+{
+public:
+    static constexpr size_t kWindow = 1 << 20;
+    static constexpr size_t kMaxLine = 64u << 20;
+
+    explicit LineReader(std::istream& in, size_t max_line = kMaxLine, size_t window = kWindow);
+
+    // Следующая строка без '\n' и '\r' перед ним; false — поток кончился.
+    // Строка длиннее max_line пропускается до конца и отдаётся пустой с oversized().
+    // Без may_read отдаются только строки, уже целиком лежащие в буфере.
+    bool next(std::string_view& line, bool may_read = true);
+
+    bool oversized() const noexcept { return m_oversized; }
+    size_t line_number() const noexcept { return m_line; }
+    size_t bytes() const noexcept { return m_bytes; }
+    // Прочитано, но ещё не отдано строками (незавершённый хвост).
+    size_t buffered() const noexcept { return m_skipping ? 0 : m_end - m_begin; }
+    size_t capacity() const noexcept { return m_capacity; }
+
+private:
+    std::istream& m_in;
+    size_t m_max_line;
+    size_t m_window;
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_capacity{0};
+    size_t m_begin{0};
+    size_t m_end{0};
+    bool m_eof{false};
+    bool m_skipping{false};  // дочитывается слишком длинная строка
+    bool m_oversized{false};
+    size_t m_line{0};
+    size_t m_bytes{0};
+
+    void refill();
+};
+
+struct NdjsonSummary
+{
+    // Ошибочная строка: номер (с 1) и сообщение.
+    struct LineError
+    {
+        size_t line;
+        std::string message;
+    };
+    static constexpr size_t kReportedErrors = 10;
+
+    size_t lines{0};
+    size_t records{0};   // документы с текстом, ушедшие в анализатор
+    size_t empty{0};     // пустые строки пропускаются молча
+    size_t errors{0};    // ошибки разбора, строки без текста и слишком длинные
+    size_t bytes{0};
+    std::vector<LineError> first_errors; // первые kReportedErrors ошибок
+};
+
+// Читает NDJSON из in и подаёт текст каждого документа в sink (правила
+// extract_text_blocks, по end_block на блок). Строка разбирается целиком до
+// анализа, поэтому ошибочная строка не оставляет в sink частичных данных:
+// она учитывается в errors и пропускается. stop — больше не читать вход: строки,
+// уже целиком прочитанные в буфер, ещё разбираются, незавершённый хвост
+// отбрасывается и в bytes не входит.
+NdjsonSummary analyze_ndjson(std::istream& in, TextSink& sink, const std::atomic<bool>* stop = nullptr,
+                             size_t max_line = LineReader::kMaxLine);
+
+std::string format_ndjson_summary(const NdjsonSummary& summary);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "text_analyzer.hpp"
+#include "tokenizer.hpp"
+#include "vocabulary.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Частоты n-грамм (--ngram 2|3). Слова интернируются в Vocabulary, n-грамма —
+// кортеж их id, упакованный в ключ хеш-таблицы; строки n-грамм собираются
+// только для строк отчёта. N-граммы не пересекают границ предложений и блоков.
+
+struct NgramOptions
+{
+    size_t n{2};                // 2 или 3
+    bool skip_stop_only{true};  // не считать n-граммы только из стоп-слов
+};
+
+// Хеш-таблица n-грамм с открытой адресацией: запись — три id и частота,
+// 24 байта (три машинных слова), заполнение не больше 70%.
+class NgramTable
+{
+public:
+    using Id = Vocabulary::Id;
+
+    struct Entry
+    {
+        Id ids[3];               // у биграмм ids[2] == 0
+        std::uint32_t reserved;
+        std::uint64_t count;     // 0 — свободный слот
+    };
+
+    NgramTable();
+
+    void add(const Id* ids, std::uint64_t n = 1);
+
+    size_t size() const noexcept { return m_size; }
+    const std::vector<Entry>& slots() const noexcept { return m_slots; }
+    size_t memory_bytes() const noexcept { return m_slots.capacity() * sizeof(Entry); }
+
+private:
+    std::vector<Entry> m_slots;
+    size_t m_mask{0};
+    size_t m_size{0};
+
+    void rehash(size_t capacity);
+};
+
+class NgramAnalyzer : public TextSink
+{
+public:
+    // Множество не копируется и должно жить дольше анализатора.
+    NgramAnalyzer(const StopwordSet& stopwords, const NgramOptions& options);
+    NgramAnalyzer(StopwordSet&&, const NgramOptions&) = delete;
+
+    void feed(std::string_view chunk) override;
+    // Конец блока — и конец n-грамм: следующий блок начинает новые.
+    void end_block() override;
+
+    const NgramTable& table() const noexcept { return m_table; }
+    const Vocabulary& words() const noexcept { return m_words; }
+
+    // Статистика для format_report: total_words, предложения, unique_words и
+    // распределение длин — по словам, а в vocab — только первые top_n n-грамм
+    // обеих таблиц (все и без стоп-слов) строками "слово слово"; итоги в stats.ngrams.
+    TextStats finish(size_t top_n);
+
+    // Приёмник токенизатора.
+    void on_word(std::string_view word, size_t length);
+    void on_sentence() { ++m_sentences; m_window_size = 0; }
+
+private:
+    const StopwordSet* m_stops;
+    NgramOptions m_options;
+    tokenizer::Tokenizer m_tokenizer;
+
+    Vocabulary m_words;
+    NgramTable m_table;
+    std::uint64_t m_total{0};
+    std::uint64_t m_skipped{0};
+    size_t m_word_count{0};
+    size_t m_sentences{0};
+
+    // Последние n слов текущего предложения.
+    NgramTable::Id m_window[3]{};
+    size_t m_window_size{0};
+};
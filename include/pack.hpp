@@ -0,0 +1,83 @@
+#pragma once
+
+#include "batch.hpp"
+#include "file_input.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Упакованный корпус: множество JSON-документов в одном файле.
+//
+// Вместо open/read/close на каждый из сотен тысяч маленьких файлов корпус
+// отображается в память один раз, а документы — это срезы отображения.
+// Необязательная секция текста хранит уже извлечённые блоки текста каждого
+// документа: при анализе такие документы не разбираются как JSON вовсе.
+//
+// Двоичный формат (little-endian):
+//   заголовок | документы | текст | имена | индекс
+// Индекс — записи фиксированной длины (смещение и длина документа, имени и
+// его текста), поэтому документ с номером i находится без просмотра остальных.
+// Блоки текста документа лежат подряд как [длина uint32][байты].
+class PackReader
+{
+public:
+    // Полуинтервал номеров документов [begin, end).
+    struct Range
+    {
+        size_t begin;
+        size_t end;
+    };
+
+    // Бросает std::runtime_error, если файл не читается, повреждён или другой версии.
+    explicit PackReader(const std::string& path);
+
+    size_t size() const noexcept { return m_count; }
+    bool has_text() const noexcept { return m_has_text; }
+
+    // Имя документа — путь, под которым он был упакован.
+    std::string_view name(size_t i) const;
+    // Исходный JSON документа.
+    std::string_view document(size_t i) const;
+    // Предызвлечённые блоки текста документа i. false, если их нет (пакет без
+    // секции текста или документ не разобрался при упаковке) — тогда документ
+    // разбирается как обычный JSON, и ошибка будет та же, что у исходного файла.
+    bool text_blocks(size_t i, std::vector<std::string_view>& blocks) const;
+
+    // Делит документы на не более чем parts непрерывных диапазонов примерно
+    // равного объёма — для раздачи рабочим потокам.
+    std::vector<Range> ranges(size_t parts) const;
+
+    size_t size_bytes() const noexcept { return m_data.size(); }
+
+private:
+    InputFile m_file;
+    std::string_view m_data;
+    std::string_view m_text;
+    std::string_view m_names;
+    const char* m_index{nullptr};
+    size_t m_count{0};
+    bool m_has_text{false};
+};
+
+struct PackOptions
+{
+    // Сохранять извлечённый текст документов (пакет больше, анализ быстрее).
+    bool extract_text{true};
+};
+
+struct PackSummary
+{
+    size_t documents{0};
+    size_t with_text{0};     // документы с предызвлечённым текстом
+    std::uint64_t bytes{0};  // размер пакета
+    std::vector<FileError> skipped; // файлы, которые не удалось прочитать
+};
+
+// Упаковывает files в path (через временный файл и переименование). Нечитаемые
+// файлы пропускаются и перечисляются в skipped; испорченный JSON упаковывается
+// как есть, чтобы анализ пакета сообщил о нём так же, как о файле.
+PackSummary write_pack(const std::vector<std::string>& files,
+                       const std::string& path,
+                       const PackOptions& options = {});
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "batch.hpp"
+#include "stopwords.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Частичные результаты для распределённого режима map/reduce.
+//
+// map анализирует свой шард набора файлов и сохраняет BatchResult в частичный
+// файл; reduce сливает частичные файлы всех шардов (merge_stats) в итог, равный
+// анализу всего набора одним процессом. Шард файла определяется хешем его пути,
+// поэтому разбиение не зависит от порядка списка, но все map должны получать
+// одинаковые пути.
+//
+// Двоичный формат (little-endian, записи фиксированной длины):
+//   заголовок | слова | ошибочные файлы | строки
+// В заголовке — номер шарда, число шардов и отпечаток стоп-слов: reduce
+// отказывается сливать неполный набор шардов или шарды с разными стоп-словами.
+
+struct ShardSpec
+{
+    size_t index{0};
+    size_t count{1};
+};
+
+// "i/N", 0 <= i < N; иначе std::runtime_error.
+ShardSpec parse_shard(const std::string& text);
+
+// Файлы шарда shard из files, в исходном порядке.
+std::vector<std::string> select_shard(const std::vector<std::string>& files, const ShardSpec& shard);
+
+struct PartialResult
+{
+    ShardSpec shard;
+    std::uint64_t stopwords_fingerprint{0};
+    BatchResult result; // stats — без упорядоченных представлений
+};
+
+// Запись во временный файл и переименование, как у снапшота.
+void write_partial(const std::string& path, const BatchResult& result, const ShardSpec& shard,
+                   const StopwordSet& stopwords);
+// Бросает std::runtime_error, если файл не читается, повреждён или другой версии.
+PartialResult read_partial(const std::string& path);
+
+// Сливает частичные результаты: каждый шард 0..N-1 должен встретиться ровно
+// один раз, стоп-слова у всех одинаковы. Упорядоченные представления построены.
+BatchResult reduce_partials(const std::vector<std::string>& paths);
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "tokenizer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Профилирование по этапам (--profile): таймеры с наносекундным разрешением
+// и счётчики. Пока профиль не включён, таймер — это одна проверка флага, без
+// обращения к часам, а анализатор идёт прежним слитным путём.
+//
+// Время этапов исключающее: вложенный таймер вычитается из объемлющего, поэтому
+// этапы в сумме не превышают общего времени. Этапы рабочих потоков суммируются
+// по потокам.
+namespace profile
+{
+    enum class Stage
+    {
+        StopwordLoad,
+        FileRead,
+        JsonParse,
+        BlockExtract,
+        Tokenize,
+        Count,
+        Merge,
+        Views,
+        TopK,
+        ReportFormat,
+        OutputWrite,
+        StageCount
+    };
+
+    enum class Counter
+    {
+        BytesRead,
+        Documents,
+        Blocks,
+        Tokens,
+        Sentences,
+        UniqueWords,
+        HashProbes,
+        Stopwords,
+        CounterCount
+    };
+
+    // Включается один раз до запуска рабочих потоков.
+    void enable();
+    inline bool enabled() noexcept;
+
+    void add_time(Stage stage, std::uint64_t ns) noexcept;
+    void add(Counter counter, std::uint64_t value) noexcept;
+    void set(Counter counter, std::uint64_t value) noexcept;
+
+    const char* stage_name(Stage stage) noexcept;   // ключ для JSON
+    const char* stage_title(Stage stage) noexcept;  // подпись для таблицы
+    const char* counter_name(Counter counter) noexcept;
+    const char* counter_title(Counter counter) noexcept;
+
+    // Отчёт: таблица этапов с долями от wall_ns и счётчики, либо JSON-документ.
+    std::string format_table(std::uint64_t wall_ns);
+    std::string format_json(std::uint64_t wall_ns);
+
+    namespace detail
+    {
+        extern bool g_enabled;
+    }
+
+    inline bool enabled() noexcept
+    {
+        return detail::g_enabled;
+    }
+
+    // Замер этапа на время жизни объекта.
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(Stage stage) noexcept
+            : m_stage(stage), m_active(enabled())
+        {
+            if (m_active)
+                start();
+        }
+        ~ScopedTimer()
+        {
+            if (m_active)
+                stop();
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        Stage m_stage;
+        bool m_active;
+        ScopedTimer* m_parent{nullptr};
+        std::uint64_t m_child_ns{0};
+        std::chrono::steady_clock::time_point m_start;
+
+        void start() noexcept;
+        void stop() noexcept;
+    };
+
+    class WordBuffer;
+    // Буфер слов текущего потока для анализаторов под профилем.
+    WordBuffer& thread_word_buffer();
+
+    // Токенизация и подсчёт под профилем: текст режется на ломти, слова ломтя
+    // собираются в буфер (этап Tokenize) и затем отдаются приёмнику (этап Count).
+    // Результат тот же, что у tokenizer.feed(chunk, sink) и tokenizer.end_block(sink).
+    class WordBuffer
+    {
+    public:
+        template <typename Sink>
+        void feed(tokenizer::Tokenizer& tok, std::string_view chunk, Sink& sink)
+        {
+            constexpr size_t kSlice = 64 * 1024;
+            for (size_t pos = 0; pos < chunk.size(); pos += kSlice)
+            {
+                {
+                    ScopedTimer timer(Stage::Tokenize);
+                    tok.feed(chunk.substr(pos, kSlice), *this);
+                }
+                replay(sink);
+            }
+        }
+
+        template <typename Sink>
+        void end_block(tokenizer::Tokenizer& tok, Sink& sink)
+        {
+            {
+                ScopedTimer timer(Stage::Tokenize);
+                tok.end_block(*this);
+            }
+            replay(sink);
+        }
+
+        // Приёмник токенизатора.
+        void on_word(std::string_view word, size_t length)
+        {
+            m_words.push_back(Word{m_bytes.size(), word.size(), length});
+            m_bytes.append(word);
+        }
+        void on_sentence() { ++m_sentences; }
+
+    private:
+        struct Word
+        {
+            size_t offset;
+            size_t size;
+            size_t length;
+        };
+
+        std::string m_bytes;
+        std::vector<Word> m_words;
+        size_t m_sentences{0};
+
+        template <typename Sink>
+        void replay(Sink& sink)
+        {
+            ScopedTimer timer(Stage::Count);
+            for (const Word& w : m_words)
+                sink.on_word(std::string_view(m_bytes).substr(w.offset, w.size), w.length);
+            for (; m_sentences != 0; --m_sentences)
+                sink.on_sentence();
+            m_words.clear();
+            m_bytes.clear();
+        }
+    };
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Упреждающее чтение набора файлов для пакетного режима (--read-ahead).
+// Отдельная стадия ввода держит в полёте до queue_depth чтений: через io_uring
+// (Linux 5.6+), а где он недоступен — потоками чтения. Файлы читаются целиком
+// в буферы из пула и отдаются рабочим потокам в порядке готовности.
+//
+// Память ограничена: байты буферов в полёте и прочитанных, но ещё не
+// возвращённых release(), не превышают max_inflight_bytes (файл больше предела
+// читается, только когда других буферов нет).
+struct ReadAheadOptions
+{
+    size_t queue_depth{32};
+    size_t max_inflight_bytes{64u << 20};
+    bool use_uring{true}; // false — сразу потоки чтения
+};
+
+class ReadAhead
+{
+public:
+    // Прочитанный файл. data действителен до release().
+    struct File
+    {
+        size_t index{0};         // индекс в списке files
+        std::string_view data;
+        std::string error;       // не пусто — файл не прочитан
+    private:
+        friend class ReadAhead;
+        std::unique_ptr<char[]> buffer;
+        size_t capacity{0};
+    };
+
+    // Чтение начинается сразу в фоновом потоке.
+    ReadAhead(const std::vector<std::string>& files, const ReadAheadOptions& options);
+    ~ReadAhead();
+
+    ReadAhead(const ReadAhead&) = delete;
+    ReadAhead& operator=(const ReadAhead&) = delete;
+
+    // Ждёт следующий прочитанный файл; false — все файлы уже выданы.
+    // Безопасно вызывать из нескольких потоков.
+    bool next(File& file);
+    // Возвращает буфер в пул и освобождает место под следующие чтения.
+    void release(File& file);
+
+    // "io_uring" или "threads".
+    const char* backend() const noexcept { return m_uring ? "io_uring" : "threads"; }
+
+private:
+    class Uring;
+    struct Pending;
+
+    const std::vector<std::string>& m_files;
+    ReadAheadOptions m_options;
+    // Буферы чтений, брошенных после сбоя io_uring: ядро ещё может писать в них,
+    // поэтому они освобождаются только после кольца (объявлены раньше m_uring).
+    std::vector<std::unique_ptr<char[]>> m_stranded;
+    std::unique_ptr<Uring> m_uring;
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready_cv;  // появился готовый файл
+    std::condition_variable m_space_cv;  // освободилось место под чтения
+    std::deque<File> m_ready;
+    size_t m_delivered{0};
+    size_t m_inflight_bytes{0};
+    bool m_cancelled{false};
+    // Свободные буферы по размерам (кратны странице).
+    std::multimap<size_t, std::unique_ptr<char[]>> m_free;
+    size_t m_free_bytes{0};
+
+    size_t m_next_file{0}; // для потоков чтения
+    std::vector<std::thread> m_threads;
+
+    // Резервирует место под size байт и выдаёт буфер. wait — ждать, пока место
+    // освободится; false — места нет (без wait) или чтение отменено.
+    bool acquire(size_t size, File& file, bool wait);
+    void complete(File&& file);
+
+    void run_uring();
+    void run_threads();
+    // Сбой io_uring: чтения в полёте завершаются ошибкой, остальные файлы
+    // дочитываются pread в этом же потоке.
+    void abandon_uring(std::vector<Pending>& slots, size_t next, const std::string& reason);
+};
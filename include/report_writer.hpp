@@ -0,0 +1,79 @@
+#pragma once
+
+#include "text_analyzer.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Буферизованная запись прямо в файловый дескриптор: отчёт не собирается
+// в строку целиком, куски уходят в write(2) по мере заполнения буфера.
+// При ошибке записи бросает std::runtime_error.
+class FdWriter
+{
+public:
+    static constexpr size_t kBufferSize = 64 * 1024;
+
+    // Стандартный вывод (дескриптор не закрывается).
+    FdWriter();
+    // Создаёт или обрезает файл path.
+    explicit FdWriter(const std::string& path);
+    // Запись в память (ответы --serve): flush дописывает буфер в конец *target.
+    explicit FdWriter(std::string* target);
+    ~FdWriter();
+
+    FdWriter(const FdWriter&) = delete;
+    FdWriter& operator=(const FdWriter&) = delete;
+
+    void write(std::string_view bytes);
+    void put(char c);
+    void write_uint(std::uint64_t value);
+    void write_double(double value);
+
+    template <typename Pod>
+    void write_pod(const Pod& value)
+    {
+        write(std::string_view(reinterpret_cast<const char*>(&value), sizeof(Pod)));
+    }
+
+    void flush();
+    // Сбрасывает буфер и закрывает собственный дескриптор; ошибки — исключением.
+    void close();
+
+private:
+    int m_fd{-1};
+    bool m_owned{false};
+    std::string* m_target{nullptr};
+    std::string m_name;
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_used{0};
+
+    void write_direct(const char* data, size_t size);
+};
+
+// Формат отчёта (--format): текстовая таблица топа или машиночитаемые полные таблицы.
+enum class ReportFormat
+{
+    Text,
+    Json,
+    Csv,
+    Binary
+};
+
+// "text", "json", "csv", "bin"; иначе std::runtime_error.
+ReportFormat parse_report_format(const std::string& name);
+
+// Text — то же, что format_report. Json, Csv и Binary содержат все слова словаря
+// (частота по убыванию, затем слово), а не только топ; top_n на них не влияет.
+// У статистики --ngram в словаре только строки топа n-грамм — их и выводят.
+//  - Json: итоги, границы ошибок --approx, итоги --ngram, распределение по длине
+//    и массив words из объектов {"word", "count", "stop", "length"};
+//  - Csv: строки word,count,stop,length с заголовком;
+//  - Binary: файл "TFRP" — заголовок, записи фиксированного размера и строки
+//    слов подряд; читается read_binary_report без разбора.
+void write_report(FdWriter& out, const TextStats& stats, size_t top_n, ReportFormat format);
+
+// Загружает статистику из двоичного отчёта (--format bin): словарь, итоги,
+// распределение по длине и границы ошибок. Упорядоченные представления построены.
+TextStats read_binary_report(const std::string& path);
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "report_writer.hpp"
+#include "stopwords.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Долгоживущий режим (--serve): стоп-слова загружаются один раз, запросы
+// обрабатываются пулом потоков с прогретыми буферами, отчёт тот же, что у
+// разового запуска.
+//
+// Протокол одинаков для stdin/stdout и Unix-сокета — рамки с длиной
+// (целые little-endian):
+//   запрос:  [u32 длина][u32 id][строка параметров '\n' JSON-документ]
+//   ответ:   [u32 длина][u32 id][u8 статус][тело]   (длина = 1 + размер тела)
+// Параметры — слова через пробел: top=N, format=text|json|csv|bin, stops=NAME
+// (набор стоп-слов, загруженный при запуске через add_stopwords; файлы по
+// путям из запросов сервер не читает).
+// Вместо документа можно послать команду: "stats" — перцентили задержек,
+// "shutdown" — остановить сервер сокета. Статус 0 — тело содержит отчёт,
+// 1 — тело содержит текст ошибки. Ответы stdin/stdout могут идти не по порядку
+// запросов: их сопоставляют по id.
+class Server
+{
+public:
+    struct Options
+    {
+        size_t threads{0};      // 0 — по числу аппаратных потоков
+        size_t top_n{20};
+        ReportFormat format{ReportFormat::Text};
+        size_t max_request{64u << 20};
+        // Запросов, ждущих свободного потока (0 — вдвое больше потоков); пока
+        // очередь полна, новые рамки не читаются.
+        size_t max_pending{0};
+    };
+
+    enum Status : std::uint8_t
+    {
+        Ok = 0,
+        Error = 1
+    };
+
+    // Перцентили задержки (от получения запроса до готового ответа), нс.
+    struct Latency
+    {
+        std::uint64_t requests{0};
+        std::uint64_t p50{0};
+        std::uint64_t p90{0};
+        std::uint64_t p99{0};
+        std::uint64_t p999{0};
+        std::uint64_t max{0};
+    };
+
+    Server(StopwordSet stopwords, const Options& options);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Дополнительный набор стоп-слов, выбираемый параметром запроса stops=name.
+    // Вызывается до serve_*: во время работы наборы не меняются.
+    void add_stopwords(const std::string& name, StopwordSet stopwords);
+
+    // Обрабатывает тело одного запроса; ответ (без рамки) кладётся в response.
+    Status handle(std::string_view request, std::string& response);
+
+    // Читает запросы из in_fd до конца потока, ответы пишет в out_fd.
+    void serve_stream(int in_fd, int out_fd);
+    // Принимает соединения на Unix-сокете path до команды shutdown или stop().
+    // Сокеты читает один поток опроса, пул получает только готовые запросы.
+    void serve_unix(const std::string& path);
+    void stop();
+
+    Latency latency() const;
+    std::string format_latency() const;
+
+private:
+    const StopwordSet& stopwords_for(const std::string& name) const;
+    void record_latency(std::uint64_t ns);
+
+    StopwordSet m_stopwords;
+    Options m_options;
+
+    std::map<std::string, StopwordSet> m_named_stops;
+
+    // Кольцо последних задержек: перцентили считаются по нему.
+    static constexpr size_t kLatencySamples = 1 << 16;
+    mutable std::mutex m_latency_mutex;
+    std::vector<std::uint64_t> m_latency;
+    std::uint64_t m_requests{0};
+
+    std::atomic<bool> m_stopping{false};
+    int m_listen_fd{-1};
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "batch.hpp"
+#include "stopwords.hpp"
+#include "text_analyzer.hpp"
+#include "vocabulary.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Сохранённая статистика корпуса с поштучным манифестом файлов.
+//
+// Для каждого файла запоминаются путь, размер, время изменения, хеш содержимого
+// и его вклад (пары «id слова — частота», число слов и предложений). Поэтому
+// обновление по новому списку файлов вычитает вклад изменённых и удалённых
+// файлов и добавляет новые, читая с диска только их: время пропорционально
+// изменениям, а не размеру корпуса.
+//
+// Двоичный формат (little-endian, все секции выровнены на 8 байт):
+//   заголовок | слова | файлы | вклады | строки
+// Записи фиксированной длины читаются прямо из отображённого файла.
+class CorpusSnapshot
+{
+public:
+    struct UpdateSummary
+    {
+        size_t added{0};
+        size_t changed{0};
+        size_t removed{0};
+        size_t unchanged{0};
+        // Файлы, у которых сменилось время изменения, но не содержимое.
+        size_t touched{0};
+    };
+
+    CorpusSnapshot() = default;
+
+    // Бросает std::runtime_error, если файл не читается, повреждён или другой версии.
+    static CorpusSnapshot load(const std::string& path);
+    // Запись во временный файл и переименование: прежний снапшот не портится при сбое.
+    void save(const std::string& path) const;
+
+    // Приводит снапшот к набору files: новые и изменённые файлы анализируются
+    // (в threads потоках), вклад удалённых и изменённых вычитается. Файл считается
+    // неизменным, если совпали размер и время изменения либо хеш содержимого.
+    // Стоп-флаги словаря пересчитываются по stopwords.
+    UpdateSummary update(const std::vector<std::string>& files, const StopwordSet& stopwords, size_t threads);
+
+    // Текущая статистика с упорядоченными представлениями и списком ошибочных файлов.
+    BatchResult result() const;
+
+    size_t file_count() const noexcept { return m_files.size(); }
+
+private:
+    struct Contribution
+    {
+        Vocabulary::Id word;
+        std::uint32_t count;
+    };
+
+    struct FileEntry
+    {
+        std::string path;
+        std::uint64_t size{0};
+        std::int64_t mtime{0};
+        std::uint64_t content_hash{0};
+        bool ok{false};
+        std::string error;
+        std::uint64_t total_words{0};
+        std::uint64_t total_sentences{0};
+        // Вклад — отрезок m_contributions.
+        std::uint64_t contribution_offset{0};
+        std::uint32_t contribution_count{0};
+    };
+
+    TextStats m_stats; // только счётчики, без упорядоченных представлений
+    std::vector<FileEntry> m_files;
+    // Вклады всех файлов подряд: загружаются одним копированием. Вклады
+    // изменённых файлов дописываются в конец, старые отрезки уходят при save().
+    std::vector<Contribution> m_contributions;
+    std::uint64_t m_stopwords_hash{0};
+
+    void subtract(const FileEntry& file);
+    void add(FileEntry& file, const TextStats& stats);
+};
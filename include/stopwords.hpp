@@ -0,0 +1,99 @@
+#pragma once
+
+#include "file_input.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Замороженное множество стоп-слов: строится один раз (из extract_stopwords или
+// двоичного файла) и дальше только читается, в том числе из нескольких потоков.
+//
+// Поиск: сначала префильтр — маска встречающихся длин и битовая карта первых
+// байтов, — отсекающий большинство слов текста за два сравнения; затем хеш-таблица
+// с открытой адресацией (заполнение не больше 1/2) и сверка байтов.
+//
+// Двоичный формат совпадает с представлением в памяти: заголовок, слоты, байты
+// слов. Поэтому загрузка — это отображение файла в память (InputFile) и проверка
+// заголовка, без разбора и перестройки таблиц.
+class StopwordSet
+{
+public:
+    // Пустое множество.
+    StopwordSet();
+    // Слова должны быть уже в нижнем регистре (как из extract_stopwords); дубликаты удаляются.
+    explicit StopwordSet(const std::vector<std::string>& words);
+
+    StopwordSet(StopwordSet&&) noexcept;
+    StopwordSet& operator=(StopwordSet&&) noexcept;
+    StopwordSet(const StopwordSet&) = delete;
+    StopwordSet& operator=(const StopwordSet&) = delete;
+    ~StopwordSet();
+
+    // Загружает двоичный файл, записанный save(). Бросает std::runtime_error,
+    // если файл не читается или повреждён.
+    static StopwordSet load(const std::string& path);
+    // Проверяет сигнатуру двоичного формата (для выбора между JSON и .bin).
+    static bool is_binary(std::string_view data) noexcept;
+
+    void save(const std::string& path) const;
+
+    bool contains(std::string_view word) const noexcept
+    {
+        const size_t length_bit = word.size() < 64 ? word.size() : 63;
+        if ((m_header.length_mask >> length_bit & 1) == 0 || word.empty())
+            return false;
+        const auto first = static_cast<unsigned char>(word[0]);
+        if ((m_header.first_bytes[first >> 6] >> (first & 63) & 1) == 0)
+            return false;
+        return lookup(word);
+    }
+
+    size_t size() const noexcept { return m_header.count; }
+    bool empty() const noexcept { return m_header.count == 0; }
+
+    // Слова множества в порядке возрастания.
+    std::vector<std::string> words() const;
+    // Хеш отсортированного списка слов: одинаков у равных множеств, откуда бы
+    // они ни были загружены (сверка снапшотов и частичных результатов).
+    std::uint64_t fingerprint() const;
+
+    // true, если данные отображены из файла.
+    bool mapped() const noexcept;
+
+    // Объём представления (в памяти и на диске), байт.
+    size_t size_bytes() const noexcept { return m_data.size(); }
+
+private:
+    // Заголовок двоичного файла; все поля — little-endian.
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t count;
+        std::uint32_t slot_count; // степень двойки
+        std::uint64_t bytes_size; // байты слов
+        std::uint64_t length_mask;      // бит n — есть слово длины n (63 — длины >= 63)
+        std::uint64_t first_bytes[4];   // битовая карта первых байтов
+    };
+
+    struct Slot
+    {
+        std::uint32_t tag;    // старшие биты хеша; слот пуст, если length == 0
+        std::uint32_t offset; // смещение слова в байтах слов
+        std::uint32_t length;
+    };
+
+    Header m_header{};
+    const Slot* m_slots{nullptr};
+    const char* m_bytes{nullptr};
+    std::string_view m_data; // весь образ: заголовок + слоты + байты
+
+    std::vector<char> m_owned;           // образ построенного множества
+    std::unique_ptr<InputFile> m_file;   // или отображённый файл
+
+    void attach(std::string_view data);
+    bool lookup(std::string_view word) const noexcept;
+};
@@ -1,27 +1,226 @@
 #pragma once
 
 #include "json_parser.hpp"
+#include "json_sax.hpp"
+#include "json_tape.hpp"
+#include "stopwords.hpp"
+#include "tokenizer.hpp"
+#include "vocabulary.hpp"
 
 #include <string>
+#include <string_view>
 #include <map>
+#include <memory>
+#include <optional>
 #include <vector>
 
+// Границы ошибок приближённого анализа (см. approx.hpp).
+struct ApproxBounds
+{
+    size_t memory_budget{0};         // бюджет памяти, байт
+    size_t counters{0};              // счётчиков Space-Saving
+    std::uint64_t max_overcount{0};  // наибольшее завышение частоты среди счётчиков
+    std::uint64_t missing_bound{0};  // частота любого слова вне таблиц не больше этого
+    double unique_error{0.0};        // относительная стандартная ошибка unique_words
+};
+
+// Итоги анализа n-грамм (см. ngram.hpp).
+struct NgramSummary
+{
+    size_t n{2};
+    std::uint64_t total{0};     // учтённых n-грамм
+    std::uint64_t distinct{0};  // различных n-грамм
+    std::uint64_t skipped{0};   // пропущенных n-грамм только из стоп-слов
+    bool skip_stop_only{true};
+    size_t memory_bytes{0};     // таблица n-грамм
+};
+
 struct TextStats
 {
     size_t total_words{0};
     size_t total_sentences{0};
     size_t unique_words{0};
 
+    // Основная таблица подсчёта: слово -> id, частоты, стоп-флаги и длины по id.
+    Vocabulary vocab;
+
+    // Карты слов для внешнего кода и статистики без vocab. Отчёты читают vocab
+    // напрямую, поэтому карты строятся только по запросу — build_word_maps.
     std::map<std::string, size_t> word_freq;
     std::map<std::string, size_t> word_freq_no_stops;
     std::map<size_t, size_t> length_distribution;
+
+    // Задано, если статистика получена приближённым анализом: частоты в vocab —
+    // оценки сверху, unique_words — оценка HyperLogLog.
+    std::optional<ApproxBounds> approx;
+
+    // Задано для --ngram: vocab содержит строки топа n-грамм ("слово слово"),
+    // а total_words, unique_words и length_distribution по-прежнему описывают слова.
+    std::optional<NgramSummary> ngrams;
 };
 
+// Пересобирает length_distribution и unique_words по vocab за один проход.
+void build_ordered_views(TextStats& stats);
+
+// Копирует словарь в word_freq и word_freq_no_stops (для кода, которому нужны
+// упорядоченные карты слов; отчёты обходятся без них).
+void build_word_maps(TextStats& stats);
+
 std::vector<std::string> extract_text_blocks(const json::Value& root);
 std::vector<std::string> extract_stopwords(const json::Value& root);
 
+// Те же правила извлечения для плоской ленты; блоки ссылаются в ленту/входной буфер.
+std::vector<std::string_view> extract_text_blocks(const json::Tape& tape);
+std::vector<std::string> extract_stopwords(const json::Tape& tape);
+
+// Стоп-слова из файла --stops: JSON (см. extract_stopwords) или двоичный файл
+// StopwordSet::save, который отображается в память как есть.
+StopwordSet load_stopword_file(const std::string& path);
+
 TextStats analyze_text(const std::vector<std::string>& blocks,
                        const std::vector<std::string>& stopwords);
+TextStats analyze_text(const std::vector<std::string_view>& blocks,
+                       const std::vector<std::string>& stopwords);
+
+// То же с заранее построенным множеством стоп-слов: при многократных вызовах
+// оно не перестраивается.
+TextStats analyze_text(const std::vector<std::string>& blocks, const StopwordSet& stopwords);
+TextStats analyze_text(const std::vector<std::string_view>& blocks, const StopwordSet& stopwords);
+
+class ExternalCounter;
+
+// Приёмник текста блоками: кусок за куском, затем граница блока.
+class TextSink
+{
+public:
+    virtual ~TextSink() = default;
+
+    virtual void feed(std::string_view chunk) = 0;
+    virtual void end_block() = 0;
+};
+
+// Делит блок на куски примерно по chunk_bytes байт так, что каждый кусок
+// кончается сразу после ASCII-разделителя или знака конца предложения: ни слово,
+// ни символ UTF-8 не разрезаются. Кусок без такого байта растягивается дальше.
+std::vector<std::string_view> split_at_word_boundaries(std::string_view block, size_t chunk_bytes);
+
+// Параллельный analyze_text для очень больших документов: блоки режутся
+// split_at_word_boundaries, куски разбирают threads потоков (0 — все ядра) в
+// свои таблицы, таблицы сливаются попарным деревом. Результат совпадает с
+// последовательным analyze_text. chunk_bytes == 0 — размер куска подбирается сам.
+TextStats analyze_text_parallel(const std::vector<std::string_view>& blocks,
+                                const StopwordSet& stopwords,
+                                size_t threads = 0,
+                                size_t chunk_bytes = 0);
+TextStats analyze_text_parallel(const std::vector<std::string_view>& blocks,
+                                const std::vector<std::string>& stopwords,
+                                size_t threads = 0,
+                                size_t chunk_bytes = 0);
+
+// Однопроходный анализ: токенизатор отдаёт слова прямо в счётчики, память
+// растёт с размером словаря, а не с числом слов. Текст блока можно подавать
+// кусками произвольного размера, слово на стыке кусков собирается корректно.
+// analyze_text — это один StreamingAnalyzer, в который поданы все блоки.
+class StreamingAnalyzer : public TextSink
+{
+public:
+    explicit StreamingAnalyzer(const std::vector<std::string>& stopwords);
+    // Множество не копируется и должно жить дольше анализатора.
+    explicit StreamingAnalyzer(const StopwordSet& stopwords);
+    explicit StreamingAnalyzer(StopwordSet&&) = delete;
+
+    void feed(std::string_view chunk) override;
+    // Конец блока: незавершённое слово засчитывается и не склеивается со следующим блоком.
+    void end_block() override;
+
+    const TextStats& stats() const noexcept { return m_stats; }
+
+    // Завершает анализ. Без with_views упорядоченные представления не строятся —
+    // это удобно, если результат ещё будет сливаться с другими (merge_stats).
+    TextStats finish(bool with_views = true);
+
+    // Внешний подсчёт (external_count.hpp), вызывается до подачи текста: таблица
+    // слов занимает не больше memory_limit байт (не меньше ExternalCounter::kMinLimit)
+    // и при заполнении сбрасывается прогоном в counter. finish тогда сбрасывает
+    // остаток и возвращает только total_words и total_sentences, словарь
+    // достраивает ExternalCounter::finish.
+    void spill_to(ExternalCounter& counter, size_t memory_limit);
+
+    // Приёмник токенизатора.
+    void on_word(std::string_view word, size_t length);
+    void on_sentence() { ++m_stats.total_sentences; }
+
+private:
+    TextStats m_stats;
+    std::shared_ptr<const StopwordSet> m_stops; // своё или внешнее (без владения)
+    tokenizer::Tokenizer m_tokenizer;
+
+    ExternalCounter* m_spill{nullptr};
+    size_t m_spill_words{0};  // слов в таблице до сброса
+    size_t m_spill_arena{0};  // байт строк в арене до сброса
+    std::vector<Vocabulary::Id> m_spill_order;
+
+    void spill();
+};
+
+// SAX-обработчик с правилами extract_text_blocks: берёт "text" корневого
+// объекта либо строки/"paragraph" элементов корневого массива и передаёт их
+// содержимое кусками в анализатор (TextSink). Прочие значения пропускаются без копирования.
+class TextBlockExtractor : public json::SaxHandler
+{
+public:
+    explicit TextBlockExtractor(TextSink& sink);
+
+    size_t blocks() const noexcept { return m_blocks; }
+
+    bool on_string_begin() override;
+    void on_string_chunk(std::string_view chunk) override;
+    void on_string_end() override;
+    void on_key(std::string_view key) override;
+    void on_null() override { value_seen(); }
+    void on_bool(bool) override { value_seen(); }
+    void on_number(double) override { value_seen(); }
+    void on_object_begin() override;
+    void on_object_end() override { --m_depth; }
+    void on_array_begin() override;
+    void on_array_end() override { --m_depth; }
+
+private:
+    enum class Root { None, Object, Array, Other };
+
+    TextSink& m_sink;
+    Root m_root{Root::None};
+    size_t m_depth{0};
+    size_t m_blocks{0};
+    bool m_capture_next{false}; // следующее значение — искомое поле
+    bool m_key_taken{false};    // искомый ключ уже встречался в текущем объекте
+
+    void value_seen();
+};
+
+// Сливает статистику from в into (используется при параллельной обработке).
+// При многократном слиянии представления выгодно строить один раз в конце:
+// rebuild_views = false, затем build_ordered_views.
+void merge_stats(TextStats& into, const TextStats& from, bool rebuild_views = true);
+
+// Строка топа: слово ссылается в словарь (или карту) TextStats.
+struct WordCount
+{
+    std::string_view word;
+    size_t count{0};
+};
+
+struct TopWords
+{
+    std::vector<WordCount> all;      // все слова
+    std::vector<WordCount> no_stops; // без стоп-слов
+};
+
+// Первые top_n слов по убыванию частоты, при равенстве — по алфавиту (как в
+// format_report). Обе таблицы выбираются за один проход по vocab ограниченными
+// кучами: O(N log top_n) без копирования и полной сортировки словаря.
+// Если vocab пуст (статистика заполнена вручную), используются word_freq и word_freq_no_stops.
+TopWords top_words(const TextStats& stats, size_t top_n);
 
 std::string format_report(const TextStats& stats, size_t top_n);
 
@@ -0,0 +1,385 @@
+#pragma once
+
+#include "unicode.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace tokenizer
+{
+    // Классы ASCII-байтов: буквы, цифры и апостроф образуют слова; '.', '!', '?'
+    // завершают предложение. Байты >= 0x80 разбираются как UTF-8: буквы
+    // (см. unicode::is_letter) тоже образуют слова, прочие символы — разделители.
+    enum CharClass : unsigned char
+    {
+        Separator = 0,
+        Word = 1,
+        SentenceEnd = 2,
+        NonAscii = 3
+    };
+
+    struct Tables
+    {
+        std::array<unsigned char, 256> cls{};
+
+        constexpr Tables()
+        {
+            for (int c = 0; c < 256; ++c)
+            {
+                bool alpha = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+                bool digit = c >= '0' && c <= '9';
+                cls[c] = c >= 0x80 ? NonAscii
+                       : (alpha || digit || c == '\'') ? Word
+                       : (c == '.' || c == '!' || c == '?') ? SentenceEnd
+                       : Separator;
+            }
+        }
+    };
+
+    inline constexpr Tables kTables{};
+
+    // Ядро классификации: 64 байта -> маски ASCII-символов слов, концов
+    // предложений и байтов >= 0x80 (бит k соответствует байту p[k]). Варианты
+    // ядра выбираются во время выполнения по возможностям процессора; все
+    // дают одинаковые маски.
+    struct Kernel
+    {
+        const char* name;
+        void (*classify64)(const char* p, std::uint64_t& word_mask, std::uint64_t& sentence_mask,
+                           std::uint64_t& non_ascii_mask);
+    };
+
+    const Kernel& scalar_kernel();
+    // Лучшее ядро для текущего процессора (AVX2, SSE2 или скалярное).
+    const Kernel& active_kernel();
+    // Все ядра, поддерживаемые текущим процессором, — для тестов и бенчмарков.
+    std::vector<const Kernel*> available_kernels();
+
+    inline unsigned count_trailing_zeros(std::uint64_t x)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+    }
+
+    // Слияние разбора на слова с подсчётом: токенизатор понижает регистр прямо в
+    // фиксированный буфер и отдаёт каждое слово приёмнику в момент его окончания,
+    // без промежуточного списка слов. Текст можно подавать кусками любого
+    // размера: незаконченное слово (и даже обрезанный символ UTF-8) переносится
+    // в следующий кусок.
+    //
+    // Блоки из одного ASCII идут по быстрому пути без ветвлений по символам;
+    // блоки с байтами >= 0x80 разбираются посимвольно с декодированием UTF-8.
+    //
+    // Приёмник (Sink) должен предоставлять:
+    //   void on_word(std::string_view word, size_t length); // нижний регистр, длина в символах
+    //   void on_sentence();
+    // view слова действителен только во время вызова.
+    class Tokenizer
+    {
+    public:
+        // Слова длиннее буфера (редкость) собираются в отдельной строке.
+        static constexpr size_t kScratchSize = 256;
+
+        explicit Tokenizer(const Kernel& kernel = active_kernel())
+            : m_classify(kernel.classify64)
+        {
+        }
+
+        template <typename Sink>
+        void feed(std::string_view chunk, Sink& sink)
+        {
+            const char* p = chunk.data();
+            const size_t n = chunk.size();
+            size_t i = 0;
+            if (m_pending_len != 0)
+            {
+                i = complete_pending(p, n, sink);
+                if (m_pending_len != 0)
+                    return;
+            }
+            bool in_word = m_len != 0;
+            size_t seg = i; // начало текущего куска слова в chunk
+
+            while (i + 64 <= n)
+            {
+                std::uint64_t word_mask;
+                std::uint64_t sentence_mask;
+                std::uint64_t non_ascii_mask;
+                m_classify(p + i, word_mask, sentence_mask, non_ascii_mask);
+
+                if (non_ascii_mask != 0)
+                {
+                    const size_t stop = i + 64;
+                    while (i < stop)
+                    {
+                        i = step(p, n, i, in_word, seg, sink);
+                        if (m_pending_len != 0)
+                            return;
+                    }
+                    continue;
+                }
+
+                // Быстрый путь для чистого ASCII: из масок получаем начала и концы
+                // слов и обходим их парами с помощью поиска младшего бита. Концы
+                // предложений отдаются в том же порядке относительно слов.
+                std::uint64_t prev = (word_mask << 1) | (in_word ? 1u : 0u);
+                std::uint64_t starts = word_mask & ~prev;
+                std::uint64_t ends = ~word_mask & prev;
+
+                if (in_word && ends != 0)
+                {
+                    // Слово, начатое раньше (в прошлом блоке или куске).
+                    unsigned e = count_trailing_zeros(ends);
+                    ends &= ends - 1;
+                    append(p + seg, i + e - seg);
+                    emit(sink);
+                }
+                while (starts != 0)
+                {
+                    unsigned b = count_trailing_zeros(starts);
+                    starts &= starts - 1;
+                    std::uint64_t before = sentence_mask & ((std::uint64_t{1} << b) - 1);
+                    sentence_mask ^= before;
+                    for (; before != 0; before &= before - 1)
+                        sink.on_sentence();
+                    if (ends == 0)
+                    {
+                        seg = i + b; // слово продолжается в следующем блоке
+                        break;
+                    }
+                    unsigned e = count_trailing_zeros(ends);
+                    ends &= ends - 1;
+                    append(p + i + b, e - b);
+                    emit(sink);
+                }
+                for (; sentence_mask != 0; sentence_mask &= sentence_mask - 1)
+                    sink.on_sentence();
+                in_word = (word_mask >> 63) != 0;
+                i += 64;
+            }
+
+            while (i < n)
+            {
+                i = step(p, n, i, in_word, seg, sink);
+                if (m_pending_len != 0)
+                    return;
+            }
+
+            if (in_word)
+                append(p + seg, n - seg); // слово может продолжиться в следующем куске
+        }
+
+        // Граница блока: незаконченное слово завершается, обрезанный символ
+        // UTF-8 считается разделителем.
+        template <typename Sink>
+        void end_block(Sink& sink)
+        {
+            m_pending_len = 0;
+            if (m_len != 0)
+                emit(sink);
+        }
+
+        bool in_word() const noexcept { return m_len != 0; }
+
+    private:
+        void (*m_classify)(const char*, std::uint64_t&, std::uint64_t&, std::uint64_t&);
+        std::array<char, kScratchSize> m_scratch{};
+        std::string m_long;
+        size_t m_len{0};   // байт в текущем слове (после смены регистра)
+        size_t m_chars{0}; // символов в текущем слове
+
+        char m_pending[4]{};   // начало символа UTF-8, обрезанного концом куска
+        size_t m_pending_len{0};
+
+        template <typename Sink>
+        void end_word(const char* p, size_t seg, size_t i, bool& in_word, Sink& sink)
+        {
+            if (in_word)
+            {
+                append(p + seg, i - seg);
+                emit(sink);
+                in_word = false;
+            }
+        }
+
+        // Один символ посимвольного пути; возвращает индекс следующего.
+        template <typename Sink>
+        size_t step(const char* p, size_t n, size_t i, bool& in_word, size_t& seg, Sink& sink)
+        {
+            unsigned char cls = kTables.cls[static_cast<unsigned char>(p[i])];
+            if (cls == Word)
+            {
+                if (!in_word)
+                {
+                    seg = i;
+                    in_word = true;
+                }
+                return i + 1;
+            }
+            if (cls != NonAscii)
+            {
+                end_word(p, seg, i, in_word, sink);
+                if (cls == SentenceEnd)
+                    sink.on_sentence();
+                return i + 1;
+            }
+
+            char32_t cp;
+            int len = unicode::decode(p + i, n - i, cp);
+            if (len == unicode::kIncomplete)
+            {
+                // Символ обрезан концом куска: слово до него уходит в буфер,
+                // а байты символа ждут продолжения.
+                if (in_word)
+                    append(p + seg, i - seg);
+                in_word = false;
+                m_pending_len = n - i;
+                std::memcpy(m_pending, p + i, m_pending_len);
+                return n;
+            }
+            if (len == unicode::kInvalid)
+            {
+                end_word(p, seg, i, in_word, sink);
+                return i + 1;
+            }
+            if (unicode::is_letter(cp))
+            {
+                if (!in_word)
+                {
+                    seg = i;
+                    in_word = true;
+                }
+            }
+            else
+            {
+                end_word(p, seg, i, in_word, sink);
+            }
+            return i + static_cast<size_t>(len);
+        }
+
+        // Дописывает к обрезанному символу байты из начала нового куска.
+        // Возвращает число использованных байт куска.
+        template <typename Sink>
+        size_t complete_pending(const char* p, size_t n, Sink& sink)
+        {
+            const size_t need = unicode::sequence_length(static_cast<unsigned char>(m_pending[0]));
+            const size_t had = m_pending_len;
+            const size_t take = std::min(need - had, n);
+            std::memcpy(m_pending + had, p, take);
+
+            char32_t cp;
+            int len = unicode::decode(m_pending, had + take, cp);
+            if (len == unicode::kIncomplete)
+            {
+                m_pending_len = had + take;
+                return n;
+            }
+            m_pending_len = 0;
+            if (len == unicode::kInvalid)
+            {
+                // Первый байт — разделитель; остальное разбирается заново.
+                if (m_len != 0)
+                    emit(sink);
+                return 0;
+            }
+            if (unicode::is_letter(cp))
+                append(m_pending, static_cast<size_t>(len));
+            else if (m_len != 0)
+                emit(sink);
+            return static_cast<size_t>(len) - had;
+        }
+
+        void put(const char* s, size_t n)
+        {
+            if (m_len + n <= kScratchSize)
+            {
+                std::memcpy(m_scratch.data() + m_len, s, n);
+            }
+            else
+            {
+                if (m_len <= kScratchSize)
+                    m_long.assign(m_scratch.data(), m_len);
+                m_long.append(s, n);
+            }
+            m_len += n;
+        }
+
+        // Дописывает к слову байты p[0..n) (только символы слов) в нижнем регистре.
+        void append(const char* p, size_t n)
+        {
+            unsigned char high = 0;
+            for (size_t k = 0; k < n; ++k)
+                high |= static_cast<unsigned char>(p[k]);
+
+            if (high < 0x80)
+            {
+                // ASCII: буквы, цифры или апостроф. У цифр и апострофа бит 0x20
+                // уже установлен, поэтому нижний регистр — это просто c | 0x20.
+                if (m_len + n <= kScratchSize)
+                {
+                    char* out = m_scratch.data() + m_len;
+                    for (size_t k = 0; k < n; ++k)
+                        out[k] = static_cast<char>(p[k] | 0x20);
+                    m_len += n;
+                }
+                else
+                {
+                    for (size_t k = 0; k < n; ++k)
+                    {
+                        char c = static_cast<char>(p[k] | 0x20);
+                        put(&c, 1);
+                    }
+                }
+                m_chars += n;
+                return;
+            }
+
+            size_t k = 0;
+            while (k < n)
+            {
+                char32_t cp;
+                int len = unicode::decode(p + k, n - k, cp);
+                char buf[4];
+                if (len <= 0)
+                {
+                    buf[0] = p[k];
+                    put(buf, 1);
+                    ++k;
+                }
+                else
+                {
+                    put(buf, unicode::encode(unicode::to_lower(cp), buf));
+                    k += static_cast<size_t>(len);
+                }
+                ++m_chars;
+            }
+        }
+
+        template <typename Sink>
+        void emit(Sink& sink)
+        {
+            std::string_view word = m_len <= kScratchSize
+                ? std::string_view(m_scratch.data(), m_len)
+                : std::string_view(m_long);
+            sink.on_word(word, m_chars);
+            m_len = 0;
+            m_chars = 0;
+        }
+    };
+
+} // namespace tokenizer
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Минимальная поддержка Unicode для токенизатора: декодирование UTF-8,
+// классификация букв и приведение к нижнему регистру по таблицам.
+// Таблицы покрывают латиницу (Latin-1, Extended-A/B, IPA), греческий и
+// кириллицу; для остальных письменностей регистр не меняется, а буквой
+// считается всё, кроме известных блоков пунктуации и символов.
+namespace unicode
+{
+    constexpr char32_t kTableSize = 0x0530;
+
+    extern const std::array<std::uint16_t, kTableSize> kLower;
+    extern const std::array<std::uint8_t, kTableSize> kLetter;
+
+    bool is_letter_outside_table(char32_t cp);
+
+    inline bool is_letter(char32_t cp)
+    {
+        return cp < kTableSize ? kLetter[cp] != 0 : is_letter_outside_table(cp);
+    }
+
+    inline char32_t to_lower(char32_t cp)
+    {
+        return cp < kTableSize ? kLower[cp] : cp;
+    }
+
+    // Результат decode: длина символа в байтах (1..4), либо
+    constexpr int kIncomplete = 0; // последовательность обрезана концом буфера
+    constexpr int kInvalid = -1;   // недопустимая последовательность
+
+    int decode(const char* p, size_t n, char32_t& cp);
+
+    // Кодирует cp в out (не менее 4 байт), возвращает число байт.
+    size_t encode(char32_t cp, char* out);
+
+    // Длина последовательности по первому байту (0 — байт не может начинать символ).
+    size_t sequence_length(unsigned char lead);
+
+    // Число символов в строке UTF-8 (байты продолжения не считаются).
+    inline size_t code_points(std::string_view s)
+    {
+        size_t n = 0;
+        for (unsigned char c : s)
+            n += (c & 0xC0) != 0x80;
+        return n;
+    }
+
+    // Нижний регистр для строки UTF-8; недопустимые байты копируются как есть.
+    std::string to_lower(std::string_view s);
+
+} // namespace unicode
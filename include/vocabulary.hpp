@@ -0,0 +1,89 @@
+#pragma once
+
+#include "arena.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Словарь со сквозной нумерацией слов.
+// Каждое слово хранится в арене один раз и получает плотный id; поиск — открытая
+// адресация с линейным пробированием по степени двойки. Атрибуты слов лежат в
+// отдельных столбцах (struct of arrays): частота, признак стоп-слова, длина.
+class Vocabulary
+{
+public:
+    using Id = std::uint32_t;
+
+    Vocabulary();
+    Vocabulary(const Vocabulary& other);
+    Vocabulary& operator=(const Vocabulary& other);
+    Vocabulary(Vocabulary&&) noexcept = default;
+    Vocabulary& operator=(Vocabulary&&) noexcept = default;
+
+    static std::uint64_t hash(std::string_view word) noexcept;
+
+    // Возвращает id слова и признак того, что слово добавлено только что.
+    // Новое слово получает нулевую частоту, длину word.size() и stop == false.
+    std::pair<Id, bool> intern(std::string_view word);
+    std::pair<Id, bool> intern(std::string_view word, std::uint64_t hash);
+
+    // id слова или npos, если слова нет.
+    static constexpr Id npos = ~Id{0};
+    Id find(std::string_view word) const;
+
+    size_t size() const noexcept { return m_words.size(); }
+    bool empty() const noexcept { return m_words.empty(); }
+    void clear();
+    // Готовит столбцы и таблицу под words слов (например, перед загрузкой снапшота).
+    void reserve(size_t words);
+
+    std::string_view word(Id id) const { return m_words[id]; }
+
+    std::uint64_t count(Id id) const { return m_counts[id]; }
+    void add(Id id, std::uint64_t n = 1) { m_counts[id] += n; }
+    void set_count(Id id, std::uint64_t n) { m_counts[id] = n; }
+
+    bool is_stop(Id id) const { return m_stop[id] != 0; }
+    void set_stop(Id id, bool stop) { m_stop[id] = stop ? 1 : 0; }
+
+    std::uint32_t length(Id id) const { return m_lengths[id]; }
+    void set_length(Id id, std::uint32_t length) { m_lengths[id] = length; }
+
+    const std::vector<std::uint64_t>& counts() const noexcept { return m_counts; }
+
+    // Прибавляет частоты other (слова сопоставляются по тексту, атрибуты
+    // новых слов копируются).
+    void merge(const Vocabulary& other);
+
+    // Число проб в хеш-таблице с момента создания (для профилирования).
+    std::uint64_t probes() const noexcept { return m_probes; }
+
+    // Приблизительный объём занятой памяти.
+    size_t memory_bytes() const noexcept;
+    // Память строк (блоки арены).
+    size_t arena_bytes() const noexcept { return m_arena.bytes_reserved(); }
+    // Память хеш-таблицы и столбцов после reserve(words) на новом словаре, без строк.
+    static size_t table_bytes(size_t words) noexcept;
+
+private:
+    struct Slot
+    {
+        Id id;              // npos — свободный слот
+        std::uint32_t tag;  // старшие биты хеша: быстрое отсечение несовпадений
+    };
+
+    std::vector<Slot> m_slots;
+    size_t m_mask{0};
+    Arena m_arena;
+
+    std::vector<std::string_view> m_words;
+    std::vector<std::uint64_t> m_counts;
+    std::vector<std::uint8_t> m_stop;
+    std::vector<std::uint32_t> m_lengths;
+
+    mutable std::uint64_t m_probes{0};
+
+    void rehash(size_t capacity);
+};
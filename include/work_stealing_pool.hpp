@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Пул потоков с «воровством» задач.
+// Каждый поток получает свой непрерывный диапазон индексов задач и берёт их
+// с конца своей очереди; опустевший поток забирает задачи с начала очереди
+// соседа. Задачи — это индексы в [0, task_count).
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void(size_t worker, size_t task)>;
+
+    // threads == 0 — по числу аппаратных потоков.
+    explicit WorkStealingPool(size_t threads = 0);
+
+    size_t thread_count() const noexcept { return m_threads; }
+
+    // Выполняет fn(worker, task) для всех task из [0, task_count) и дожидается
+    // завершения. Первое исключение из задачи пробрасывается вызывающему.
+    void run(size_t task_count, const Task& fn);
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    size_t m_threads;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+
+    bool pop_local(size_t worker, size_t& task);
+    bool steal(size_t thief, size_t& task);
+};
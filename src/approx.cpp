@@ -0,0 +1,396 @@
+#include "approx.hpp"
+#include "profile.hpp"
+#include "vocabulary.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+    unsigned leading_zeros(std::uint64_t x)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        return _BitScanReverse64(&index, x) ? 63u - static_cast<unsigned>(index) : 64u;
+#else
+        return x == 0 ? 64u : static_cast<unsigned>(__builtin_clzll(x));
+#endif
+    }
+
+    size_t round_up_pow2(size_t n)
+    {
+        size_t p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+}
+
+// ---------------------------------------------------------------- HyperLogLog
+
+HyperLogLog::HyperLogLog(unsigned precision)
+    : m_precision(precision)
+    , m_registers(size_t{1} << precision, 0)
+{
+    if (precision < 4 || precision > 18)
+        throw std::invalid_argument("HyperLogLog: точность должна быть от 4 до 18");
+}
+
+void HyperLogLog::add(std::uint64_t hash) noexcept
+{
+    const size_t index = static_cast<size_t>(hash >> (64 - m_precision));
+    // Сторожевой бит ограничивает ранг значением 64 - precision + 1.
+    const std::uint64_t rest = (hash << m_precision) | (std::uint64_t{1} << (m_precision - 1));
+    const auto rank = static_cast<std::uint8_t>(leading_zeros(rest) + 1);
+    if (rank > m_registers[index])
+        m_registers[index] = rank;
+}
+
+double HyperLogLog::estimate() const
+{
+    const double m = static_cast<double>(m_registers.size());
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (std::uint8_t r : m_registers)
+    {
+        sum += std::ldexp(1.0, -static_cast<int>(r));
+        zeros += r == 0;
+    }
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double e = alpha * m * m / sum;
+    // Малые мощности точнее оцениваются линейным подсчётом пустых регистров.
+    if (e <= 2.5 * m && zeros != 0)
+        e = m * std::log(m / static_cast<double>(zeros));
+    return e;
+}
+
+double HyperLogLog::standard_error() const noexcept
+{
+    return 1.04 / std::sqrt(static_cast<double>(m_registers.size()));
+}
+
+void HyperLogLog::merge(const HyperLogLog& other)
+{
+    if (other.m_precision != m_precision)
+        throw std::invalid_argument("HyperLogLog: слияние счётчиков разной точности");
+    for (size_t i = 0; i < m_registers.size(); ++i)
+        m_registers[i] = std::max(m_registers[i], other.m_registers[i]);
+}
+
+// ---------------------------------------------------------------- SpaceSaving
+
+SpaceSaving::SpaceSaving(size_t capacity)
+    : m_capacity(std::max<size_t>(capacity, 1))
+{
+    m_entries.reserve(m_capacity);
+    m_heap.reserve(m_capacity);
+    m_index.assign(round_up_pow2(2 * m_capacity), kEmpty);
+    m_mask = m_index.size() - 1;
+}
+
+std::uint32_t SpaceSaving::find(std::string_view word, std::uint64_t hash) const
+{
+    for (size_t slot = hash & m_mask;; slot = (slot + 1) & m_mask)
+    {
+        std::uint32_t e = m_index[slot];
+        if (e == kEmpty)
+            return kEmpty;
+        if (m_entries[e].hash == hash && m_entries[e].word == word)
+            return e;
+    }
+}
+
+void SpaceSaving::index_insert(std::uint32_t entry)
+{
+    size_t slot = m_entries[entry].hash & m_mask;
+    while (m_index[slot] != kEmpty)
+        slot = (slot + 1) & m_mask;
+    m_index[slot] = entry;
+}
+
+void SpaceSaving::index_erase(std::uint32_t entry)
+{
+    size_t slot = m_entries[entry].hash & m_mask;
+    while (m_index[slot] != entry)
+        slot = (slot + 1) & m_mask;
+
+    // Удаление со сдвигом назад: цепочки линейного пробирования остаются без дыр.
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & m_mask; m_index[next] != kEmpty; next = (next + 1) & m_mask)
+    {
+        size_t home = m_entries[m_index[next]].hash & m_mask;
+        // Запись можно перенести в дыру, если её исходный слот не лежит в (hole, next].
+        bool movable = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (movable)
+        {
+            m_index[hole] = m_index[next];
+            hole = next;
+        }
+    }
+    m_index[hole] = kEmpty;
+}
+
+void SpaceSaving::sift_down(size_t pos)
+{
+    const size_t n = m_heap.size();
+    const std::uint32_t item = m_heap[pos];
+    const std::uint64_t count = m_entries[item].count;
+    for (;;)
+    {
+        size_t child = 2 * pos + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && m_entries[m_heap[child + 1]].count < m_entries[m_heap[child]].count)
+            ++child;
+        if (m_entries[m_heap[child]].count >= count)
+            break;
+        m_heap[pos] = m_heap[child];
+        m_entries[m_heap[pos]].heap_pos = static_cast<std::uint32_t>(pos);
+        pos = child;
+    }
+    m_heap[pos] = item;
+    m_entries[item].heap_pos = static_cast<std::uint32_t>(pos);
+}
+
+void SpaceSaving::sift_up(size_t pos)
+{
+    const std::uint32_t item = m_heap[pos];
+    const std::uint64_t count = m_entries[item].count;
+    while (pos > 0)
+    {
+        size_t parent = (pos - 1) / 2;
+        if (m_entries[m_heap[parent]].count <= count)
+            break;
+        m_heap[pos] = m_heap[parent];
+        m_entries[m_heap[pos]].heap_pos = static_cast<std::uint32_t>(pos);
+        pos = parent;
+    }
+    m_heap[pos] = item;
+    m_entries[item].heap_pos = static_cast<std::uint32_t>(pos);
+}
+
+SpaceSaving::Entry* SpaceSaving::add(std::string_view word, std::uint64_t hash, std::uint32_t length)
+{
+    std::uint32_t e = find(word, hash);
+    if (e != kEmpty)
+    {
+        ++m_entries[e].count;
+        sift_down(m_entries[e].heap_pos);
+        return nullptr;
+    }
+
+    if (m_entries.size() < m_capacity)
+    {
+        e = static_cast<std::uint32_t>(m_entries.size());
+        Entry entry;
+        entry.word.assign(word);
+        entry.hash = hash;
+        entry.count = 1;
+        entry.length = length;
+        m_entries.push_back(std::move(entry));
+        index_insert(e);
+        m_heap.push_back(e);
+        sift_up(m_heap.size() - 1);
+        return &m_entries[e];
+    }
+
+    // Вытесняется слово с наименьшим счётчиком; новое наследует его значение
+    // как погрешность.
+    e = m_heap.front();
+    index_erase(e);
+    Entry& victim = m_entries[e];
+    victim.word.assign(word);
+    victim.hash = hash;
+    victim.error = victim.count;
+    ++victim.count;
+    victim.length = length;
+    victim.stop = false;
+    index_insert(e);
+    sift_down(0);
+    return &m_entries[e];
+}
+
+std::uint64_t SpaceSaving::min_count() const noexcept
+{
+    return m_entries.size() < m_capacity ? 0 : m_entries[m_heap.front()].count;
+}
+
+void SpaceSaving::merge(const SpaceSaving& other)
+{
+    const std::uint64_t own_min = min_count();
+    const std::uint64_t other_min = other.min_count();
+
+    std::vector<Entry> combined = std::move(m_entries);
+    std::vector<bool> matched(other.m_entries.size(), false);
+    for (Entry& entry : combined)
+    {
+        std::uint32_t o = other.find(entry.word, entry.hash);
+        if (o != kEmpty)
+        {
+            entry.count += other.m_entries[o].count;
+            entry.error += other.m_entries[o].error;
+            matched[o] = true;
+        }
+        else
+        {
+            entry.count += other_min;
+            entry.error += other_min;
+        }
+    }
+    for (size_t o = 0; o < other.m_entries.size(); ++o)
+    {
+        if (matched[o])
+            continue;
+        Entry entry = other.m_entries[o];
+        entry.count += own_min;
+        entry.error += own_min;
+        combined.push_back(std::move(entry));
+    }
+
+    if (combined.size() > m_capacity)
+    {
+        std::nth_element(combined.begin(), combined.begin() + static_cast<std::ptrdiff_t>(m_capacity),
+                         combined.end(),
+                         [](const Entry& a, const Entry& b) { return a.count > b.count; });
+        combined.resize(m_capacity);
+    }
+    rebuild(std::move(combined));
+}
+
+void SpaceSaving::rebuild(std::vector<Entry> entries)
+{
+    m_entries = std::move(entries);
+    m_heap.clear();
+    std::fill(m_index.begin(), m_index.end(), kEmpty);
+    for (std::uint32_t e = 0; e < m_entries.size(); ++e)
+    {
+        index_insert(e);
+        m_heap.push_back(e);
+        sift_up(m_heap.size() - 1);
+    }
+}
+
+size_t SpaceSaving::memory_bytes() const noexcept
+{
+    size_t bytes = m_entries.capacity() * sizeof(Entry) + m_heap.capacity() * sizeof(std::uint32_t) +
+                   m_index.size() * sizeof(std::uint32_t);
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.word.capacity() > std::string().capacity())
+            bytes += entry.word.capacity() + 1;
+    }
+    return bytes;
+}
+
+// ------------------------------------------------------------- ApproxAnalyzer
+
+namespace
+{
+    size_t counters_for_budget(size_t budget, size_t hll_bytes)
+    {
+        size_t available = budget > hll_bytes ? budget - hll_bytes : 0;
+        // Индекс округляется до степени двойки и в худшем случае вдвое больше;
+        // запас под это закладывается в стоимость счётчика.
+        size_t per_counter = SpaceSaving::kBytesPerCounter + 2 * sizeof(std::uint32_t);
+        return std::max<size_t>(available / per_counter, 16);
+    }
+}
+
+ApproxAnalyzer::ApproxAnalyzer(const std::vector<std::string>& stopwords, const ApproxOptions& options)
+    : ApproxAnalyzer(std::make_shared<const StopwordSet>(stopwords), options)
+{
+}
+
+ApproxAnalyzer::ApproxAnalyzer(const StopwordSet& stopwords, const ApproxOptions& options)
+    : ApproxAnalyzer(std::shared_ptr<const StopwordSet>(std::shared_ptr<const StopwordSet>(), &stopwords), options)
+{
+}
+
+ApproxAnalyzer::ApproxAnalyzer(std::shared_ptr<const StopwordSet> stopwords, const ApproxOptions& options)
+    : m_stops(std::move(stopwords))
+    , m_budget(options.memory_budget)
+    , m_unique()
+    , m_top(counters_for_budget(options.memory_budget, m_unique.memory_bytes()))
+{
+}
+
+void ApproxAnalyzer::on_word(std::string_view word, size_t length)
+{
+    const std::uint64_t hash = Vocabulary::hash(word);
+    m_unique.add(hash);
+    // Стоп-слово проверяется, только когда слово попадает в таблицу.
+    if (SpaceSaving::Entry* entry = m_top.add(word, hash, static_cast<std::uint32_t>(length)))
+        entry->stop = m_stops->contains(word);
+    if (length >= m_lengths.size())
+        m_lengths.resize(length + 1, 0);
+    ++m_lengths[length];
+    ++m_words;
+}
+
+void ApproxAnalyzer::feed(std::string_view chunk)
+{
+    if (profile::enabled())
+        profile::thread_word_buffer().feed(m_tokenizer, chunk, *this);
+    else
+        m_tokenizer.feed(chunk, *this);
+}
+
+void ApproxAnalyzer::end_block()
+{
+    if (profile::enabled())
+        profile::thread_word_buffer().end_block(m_tokenizer, *this);
+    else
+        m_tokenizer.end_block(*this);
+}
+
+void ApproxAnalyzer::merge(const ApproxAnalyzer& other)
+{
+    profile::ScopedTimer timer(profile::Stage::Merge);
+    m_unique.merge(other.m_unique);
+    m_top.merge(other.m_top);
+    m_words += other.m_words;
+    m_sentences += other.m_sentences;
+    if (other.m_lengths.size() > m_lengths.size())
+        m_lengths.resize(other.m_lengths.size(), 0);
+    for (size_t len = 0; len < other.m_lengths.size(); ++len)
+        m_lengths[len] += other.m_lengths[len];
+}
+
+TextStats ApproxAnalyzer::finish()
+{
+    TextStats stats;
+    ApproxBounds bounds;
+    bounds.memory_budget = m_budget;
+    bounds.counters = m_top.capacity();
+    bounds.missing_bound = m_top.min_count();
+    bounds.unique_error = m_unique.standard_error();
+
+    for (const SpaceSaving::Entry& entry : m_top.entries())
+    {
+        auto [id, inserted] = stats.vocab.intern(entry.word, entry.hash);
+        stats.vocab.set_count(id, entry.count);
+        stats.vocab.set_stop(id, entry.stop);
+        stats.vocab.set_length(id, entry.length);
+        bounds.max_overcount = std::max(bounds.max_overcount, entry.error);
+    }
+    build_ordered_views(stats);
+
+    stats.total_words = m_words;
+    stats.total_sentences = m_sentences;
+    stats.unique_words = static_cast<size_t>(std::llround(m_unique.estimate()));
+    stats.length_distribution.clear();
+    for (size_t len = 0; len < m_lengths.size(); ++len)
+    {
+        if (m_lengths[len] != 0)
+            stats.length_distribution[len] = m_lengths[len];
+    }
+    stats.approx = bounds;
+
+    m_unique = HyperLogLog();
+    m_top = SpaceSaving(m_top.capacity());
+    m_words = 0;
+    m_sentences = 0;
+    m_lengths.clear();
+    return stats;
+}
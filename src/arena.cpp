@@ -0,0 +1,47 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+Arena::Arena(size_t block_size)
+    : m_block_size(block_size)
+    , m_next_block(std::min<size_t>(256, block_size))
+{
+}
+
+char* Arena::allocate(size_t n)
+{
+    if (m_blocks.empty() || m_blocks.back().size - m_used < n)
+    {
+        if (!m_blocks.empty())
+            m_used_total += m_used;
+        // Блоки растут геометрически до m_block_size: маленькие словари не
+        // платят за крупный первый блок.
+        size_t size = std::max(m_next_block, n);
+        m_next_block = std::min(m_next_block * 2, m_block_size);
+        m_blocks.push_back({std::unique_ptr<char[]>(new char[size]), size});
+        m_reserved += size;
+        m_used = 0;
+    }
+    char* p = m_blocks.back().data.get() + m_used;
+    m_used += n;
+    return p;
+}
+
+std::string_view Arena::store(std::string_view s)
+{
+    if (s.empty())
+        return {};
+    char* p = allocate(s.size());
+    std::memcpy(p, s.data(), s.size());
+    return {p, s.size()};
+}
+
+void Arena::reset()
+{
+    if (m_blocks.size() > 1)
+        m_blocks.erase(m_blocks.begin() + 1, m_blocks.end());
+    m_used = 0;
+    m_used_total = 0;
+    m_reserved = m_blocks.empty() ? 0 : m_blocks.front().size;
+}
@@ -0,0 +1,404 @@
+#include "batch.hpp"
+
+#include "compression.hpp"
+#include "external_count.hpp"
+#include "file_input.hpp"
+#include "json_parser.hpp"
+#include "json_tape.hpp"
+#include "pack.hpp"
+#include "profile.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+bool match_glob(std::string_view pattern, std::string_view name)
+{
+    size_t p = 0;
+    size_t n = 0;
+    size_t star = std::string_view::npos;
+    size_t star_n = 0;
+    while (n < name.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+        {
+            ++p;
+            ++n;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            star_n = n;
+        }
+        else if (star != std::string_view::npos)
+        {
+            p = star + 1;
+            n = ++star_n;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+        ++p;
+    return p == pattern.size();
+}
+
+namespace
+{
+    template <typename Match>
+    std::vector<std::string> list_matching(const std::string& dir, Match match)
+    {
+        std::error_code ec;
+        fs::directory_iterator it(dir, ec);
+        if (ec)
+        {
+            throw std::runtime_error("Не удалось открыть каталог: " + dir);
+        }
+
+        std::vector<std::string> files;
+        for (const auto& entry : it)
+        {
+            if (!entry.is_regular_file(ec))
+                continue;
+            if (match(entry.path().filename().string()))
+                files.push_back(entry.path().string());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+}
+
+std::vector<std::string> list_directory(const std::string& dir, const std::string& pattern)
+{
+    return list_matching(dir, [&pattern](const std::string& name) { return match_glob(pattern, name); });
+}
+
+std::vector<std::string> list_json_files(const std::string& dir)
+{
+    return list_matching(dir, [](const std::string& name) {
+        return match_glob("*.json", name) || match_glob("*.json.gz", name) || match_glob("*.json.zst", name);
+    });
+}
+
+std::vector<std::string> expand_glob(const std::string& path_pattern)
+{
+    fs::path p(path_pattern);
+    std::string dir = p.has_parent_path() ? p.parent_path().string() : std::string(".");
+    return list_directory(dir, p.filename().string());
+}
+
+std::vector<std::string> read_file_list(const std::string& list_path)
+{
+    std::ifstream in(list_path);
+    if (!in)
+    {
+        throw std::runtime_error("Не удалось открыть список файлов: " + list_path);
+    }
+    std::vector<std::string> files;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty())
+            files.push_back(line);
+    }
+    return files;
+}
+
+BatchResult analyze_files(const std::vector<std::string>& files,
+                          const std::vector<std::string>& stopwords,
+                          size_t threads,
+                          const std::optional<ApproxOptions>& approx)
+{
+    return analyze_files(files, StopwordSet(stopwords), threads, approx);
+}
+
+namespace
+{
+    // Состояние рабочего потока пакетной обработки: свой анализатор и буферы.
+    struct WorkerState
+    {
+        WorkerState(const StopwordSet& stopwords, const std::optional<ApproxOptions>& options)
+            : analyzer(stopwords)
+        {
+            if (options)
+                approx.emplace(stopwords, *options);
+        }
+
+        StreamingAnalyzer analyzer;
+        std::optional<ApproxAnalyzer> approx;
+        json::Tape tape;
+        InputFile input;
+        std::string inflated; // распакованный сжатый файл упреждающего чтения
+        std::vector<std::string_view> blocks;
+        size_t files_ok{0};
+        std::vector<FileError> failed;
+        size_t bytes_read{0};
+        size_t blocks_fed{0};
+        long long read_ns{0};
+
+        void feed(const std::vector<std::string_view>& text_blocks)
+        {
+            blocks_fed += text_blocks.size();
+            for (std::string_view block : text_blocks)
+            {
+                if (approx)
+                {
+                    approx->feed(block);
+                    approx->end_block();
+                }
+                else
+                {
+                    analyzer.feed(block);
+                    analyzer.end_block();
+                }
+            }
+            ++files_ok;
+        }
+
+        // Разбор JSON-документа и анализ его текста; ошибки копятся в failed.
+        void analyze_json(std::string_view name, std::string_view content)
+        {
+            try
+            {
+                {
+                    profile::ScopedTimer timer(profile::Stage::JsonParse);
+                    json::Parser parser(content);
+                    parser.parse(tape);
+                }
+                {
+                    profile::ScopedTimer timer(profile::Stage::BlockExtract);
+                    blocks = extract_text_blocks(tape);
+                }
+                if (blocks.empty())
+                {
+                    failed.push_back({std::string(name), "не найден текст (\"text\" или массив параграфов)"});
+                    return;
+                }
+                // Документ целиком разобран до анализа, поэтому испорченный JSON
+                // не оставляет в статистике потока частичных данных.
+                feed(blocks);
+            }
+            catch (const std::exception& e)
+            {
+                failed.push_back({std::string(name), e.what()});
+            }
+        }
+    };
+
+    using Workers = std::vector<std::unique_ptr<WorkerState>>;
+
+    Workers make_workers(const WorkStealingPool& pool,
+                         const StopwordSet& stopwords,
+                         const std::optional<ApproxOptions>& approx,
+                         ExternalCounter* external)
+    {
+        std::optional<ApproxOptions> worker_approx = approx;
+        if (worker_approx)
+            worker_approx->memory_budget /= pool.thread_count();
+        Workers workers;
+        for (size_t i = 0; i < pool.thread_count(); ++i)
+        {
+            workers.push_back(std::make_unique<WorkerState>(stopwords, worker_approx));
+            if (external)
+                workers.back()->analyzer.spill_to(*external, external->memory_limit() / pool.thread_count());
+        }
+        return workers;
+    }
+
+    size_t pool_threads(size_t threads, const ExternalCounter* external)
+    {
+        return external ? external->workers(threads) : threads;
+    }
+
+    // Сливает статистики потоков в общий результат.
+    BatchResult collect(Workers& workers, size_t files_total, const std::optional<ApproxOptions>& approx)
+    {
+        BatchResult result;
+        result.files_total = files_total;
+        for (auto& state_ptr : workers)
+        {
+            WorkerState& state = *state_ptr;
+            if (state.approx)
+            {
+                if (&state != workers.front().get())
+                    workers.front()->approx->merge(*state.approx);
+            }
+            else
+            {
+                merge_stats(result.stats, state.analyzer.finish(false), false);
+            }
+            result.files_ok += state.files_ok;
+            result.bytes_read += state.bytes_read;
+            result.read_ns += state.read_ns;
+            profile::add(profile::Counter::Documents, state.files_ok);
+            profile::add(profile::Counter::BytesRead, state.bytes_read);
+            profile::add(profile::Counter::Blocks, state.blocks_fed);
+            for (auto& err : state.failed)
+                result.failed.push_back(std::move(err));
+        }
+        if (approx)
+        {
+            result.stats = workers.front()->approx->finish();
+            result.stats.approx->memory_budget = approx->memory_budget;
+        }
+        else
+        {
+            build_ordered_views(result.stats);
+        }
+        std::sort(result.failed.begin(), result.failed.end(),
+                  [](const FileError& a, const FileError& b) { return a.path < b.path; });
+        return result;
+    }
+}
+
+BatchResult analyze_files(const std::vector<std::string>& files,
+                          const StopwordSet& stopwords,
+                          size_t threads,
+                          const std::optional<ApproxOptions>& approx,
+                          ExternalCounter* external)
+{
+    WorkStealingPool pool(pool_threads(threads, external));
+    Workers workers = make_workers(pool, stopwords, approx, external);
+
+    pool.run(files.size(), [&](size_t worker, size_t task) {
+        WorkerState& state = *workers[worker];
+        const std::string& path = files[task];
+        try
+        {
+            profile::ScopedTimer timer(profile::Stage::FileRead);
+            auto t_start = std::chrono::steady_clock::now();
+            state.input.open(path);
+            auto t_end = std::chrono::steady_clock::now();
+            state.read_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count();
+            state.bytes_read += state.input.view().size();
+        }
+        catch (const std::exception& e)
+        {
+            state.failed.push_back({path, e.what()});
+            return;
+        }
+        state.analyze_json(path, state.input.view());
+    });
+
+    return collect(workers, files.size(), approx);
+}
+
+BatchResult analyze_files(const std::vector<std::string>& files,
+                          const StopwordSet& stopwords,
+                          size_t threads,
+                          const ReadAheadOptions& read_ahead,
+                          const std::optional<ApproxOptions>& approx,
+                          ExternalCounter* external)
+{
+    WorkStealingPool pool(pool_threads(threads, external));
+    Workers workers = make_workers(pool, stopwords, approx, external);
+    ReadAhead reader(files, read_ahead);
+
+    // Задача — "взять следующий готовый файл": какой именно, решает стадия ввода.
+    pool.run(files.size(), [&](size_t worker, size_t) {
+        WorkerState& state = *workers[worker];
+        ReadAhead::File file;
+        {
+            profile::ScopedTimer timer(profile::Stage::FileRead);
+            auto t_start = std::chrono::steady_clock::now();
+            const bool got = reader.next(file);
+            auto t_end = std::chrono::steady_clock::now();
+            state.read_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count();
+            if (!got)
+                return;
+        }
+        const std::string& path = files[file.index];
+        if (!file.error.empty())
+        {
+            state.failed.push_back({path, file.error});
+            return;
+        }
+        std::string_view content = file.data;
+        if (const Compression kind = compression_of(path); kind != Compression::None)
+        {
+            // Стадия ввода читает сжатые байты, распаковка идёт в рабочем потоке.
+            try
+            {
+                profile::ScopedTimer timer(profile::Stage::FileRead);
+                require_compression_support(path, kind);
+                decompress(file.data, kind, state.inflated);
+                content = state.inflated;
+            }
+            catch (const std::exception& e)
+            {
+                state.failed.push_back({path, e.what()});
+                reader.release(file);
+                return;
+            }
+        }
+        state.bytes_read += content.size();
+        state.analyze_json(path, content);
+        reader.release(file);
+    });
+
+    BatchResult result = collect(workers, files.size(), approx);
+    result.read_ahead_backend = reader.backend();
+    return result;
+}
+
+BatchResult analyze_pack(const PackReader& pack,
+                         const StopwordSet& stopwords,
+                         size_t threads,
+                         const std::optional<ApproxOptions>& approx,
+                         ExternalCounter* external)
+{
+    WorkStealingPool pool(pool_threads(threads, external));
+    Workers workers = make_workers(pool, stopwords, approx, external);
+
+    // Непрерывные диапазоны документов: поток идёт по отображённому файлу подряд,
+    // а кусков больше, чем потоков, — чтобы было что перехватывать.
+    std::vector<PackReader::Range> ranges = pack.ranges(pool.thread_count() * 8);
+    pool.run(ranges.size(), [&](size_t worker, size_t task) {
+        WorkerState& state = *workers[worker];
+        for (size_t i = ranges[task].begin; i < ranges[task].end; ++i)
+        {
+            std::string_view document = pack.document(i);
+            state.bytes_read += document.size();
+            bool has_text = false;
+            {
+                profile::ScopedTimer timer(profile::Stage::BlockExtract);
+                has_text = pack.text_blocks(i, state.blocks);
+            }
+            if (has_text)
+                state.feed(state.blocks);
+            else
+                state.analyze_json(pack.name(i), document);
+        }
+    });
+
+    return collect(workers, pack.size(), approx);
+}
+
+std::string format_batch_summary(const BatchResult& result)
+{
+    std::ostringstream out;
+    out << "=== Пакетная обработка ===\n";
+    out << "Файлов всего: " << result.files_total << "\n";
+    out << "Обработано успешно: " << result.files_ok << "\n";
+    out << "Файлов с ошибками: " << result.failed.size() << "\n";
+    if (!result.failed.empty())
+    {
+        out << "\nФайлы с ошибками:\n";
+        for (const auto& err : result.failed)
+        {
+            out << "  " << err.path << ": " << err.message << "\n";
+        }
+    }
+    return out.str();
+}
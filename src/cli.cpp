@@ -1,4 +1,5 @@
 #include "cli.hpp"
+#include "report_writer.hpp"
 
 #include <iostream>
 #include <sstream>
@@ -8,7 +9,14 @@ CliOptions parse_arguments(int argc, char** argv)
 {
     CliOptions opts;
 
-    for (int i = 1; i < argc; ++i)
+    int first = 1;
+    if (argc > 1 && (std::string(argv[1]) == "map" || std::string(argv[1]) == "reduce"))
+    {
+        opts.command = argv[1];
+        first = 2;
+    }
+
+    for (int i = first; i < argc; ++i)
     {
         std::string arg = argv[i];
         if (arg == "--help" || arg == "-h")
@@ -19,14 +27,125 @@ CliOptions parse_arguments(int argc, char** argv)
         {
             opts.input_path = argv[++i];
         }
+        else if (arg == "--input-dir" && i + 1 < argc)
+        {
+            opts.input_dir = argv[++i];
+        }
+        else if (arg == "--glob" && i + 1 < argc)
+        {
+            opts.input_glob = argv[++i];
+        }
+        else if (arg == "--file-list" && i + 1 < argc)
+        {
+            opts.file_list = argv[++i];
+        }
+        else if (arg == "--pack" && i + 1 < argc)
+        {
+            opts.pack_path = argv[++i];
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            opts.threads = static_cast<size_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--read-ahead" && i + 1 < argc)
+        {
+            opts.read_ahead = static_cast<size_t>(std::stoul(argv[++i]));
+            if (opts.read_ahead == 0)
+                throw std::runtime_error("Глубина очереди --read-ahead должна быть не меньше 1.");
+        }
+        else if (arg == "--read-ahead-memory" && i + 1 < argc)
+        {
+            opts.read_ahead_memory_mb = static_cast<size_t>(std::stoul(argv[++i]));
+            if (opts.read_ahead_memory_mb == 0)
+                throw std::runtime_error("Предел памяти --read-ahead-memory должен быть не меньше 1 МБ.");
+        }
+        else if (arg == "--processes" && i + 1 < argc)
+        {
+            opts.processes = static_cast<size_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--shard" && i + 1 < argc)
+        {
+            opts.shard = argv[++i];
+        }
+        else if (arg == "--update" && i + 1 < argc)
+        {
+            opts.update_path = argv[++i];
+        }
         else if (arg == "--stops" && i + 1 < argc)
         {
             opts.stops_path = argv[++i];
         }
+        else if (arg == "--save-stops" && i + 1 < argc)
+        {
+            opts.save_stops_path = argv[++i];
+        }
         else if (arg == "--output" && i + 1 < argc)
         {
             opts.output_path = argv[++i];
         }
+        else if (arg == "--serve" && i + 1 < argc)
+        {
+            opts.serve_path = argv[++i];
+        }
+        else if (arg == "--serve-stops" && i + 1 < argc)
+        {
+            opts.serve_stops.push_back(argv[++i]);
+        }
+        else if (arg == "--stream")
+        {
+            opts.stream = true;
+        }
+        else if (arg == "--ndjson")
+        {
+            opts.ndjson = true;
+        }
+        else if (arg == "--approx")
+        {
+            opts.approx = true;
+        }
+        else if (arg == "--approx-memory" && i + 1 < argc)
+        {
+            opts.approx = true;
+            opts.approx_memory_mb = static_cast<size_t>(std::stoul(argv[++i]));
+            if (opts.approx_memory_mb == 0)
+                throw std::runtime_error("Бюджет памяти --approx-memory должен быть не меньше 1 МБ.");
+        }
+        else if (arg == "--mem-limit" && i + 1 < argc)
+        {
+            opts.mem_limit_mb = static_cast<size_t>(std::stoul(argv[++i]));
+            if (opts.mem_limit_mb == 0)
+                throw std::runtime_error("Бюджет памяти --mem-limit должен быть не меньше 1 МБ.");
+        }
+        else if (arg == "--spill-dir" && i + 1 < argc)
+        {
+            opts.spill_dir = argv[++i];
+        }
+        else if (arg == "--profile")
+        {
+            opts.profile = true;
+            if (i + 1 < argc && (std::string(argv[i + 1]) == "table" || std::string(argv[i + 1]) == "json"))
+                opts.profile_format = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            opts.format = argv[++i];
+            parse_report_format(opts.format);
+        }
+        else if (arg == "--force")
+        {
+            opts.force = true;
+        }
+        else if (arg == "--ngram" && i + 1 < argc)
+        {
+            std::string value = argv[++i];
+            if (value != "2" && value != "3")
+                throw std::runtime_error("--ngram принимает 2 или 3.");
+            opts.ngram = static_cast<size_t>(value[0] - '0');
+        }
+        else if (arg == "--keep-stop-ngrams")
+        {
+            opts.keep_stop_ngrams = true;
+        }
         else if (arg == "--report" && i + 1 < argc)
         {
             opts.report_type = argv[++i];
@@ -35,6 +154,10 @@ CliOptions parse_arguments(int argc, char** argv)
         {
             opts.top_n = static_cast<size_t>(std::stoul(argv[++i]));
         }
+        else if (opts.command == "reduce" && !arg.empty() && arg[0] != '-')
+        {
+            opts.partials.push_back(arg);
+        }
         else
         {
             std::ostringstream oss;
@@ -52,16 +175,68 @@ std::string make_help_text()
     std::ostringstream out;
     out << "Частотный анализ текста (итоговая лабораторная)\n\n";
     out << "Использование:\n";
-    out << "  textfreq_cli --input <file.json> --stops <stops.json> --report freq [--top N] [--output out.txt]\n\n";
+    out << "  textfreq_cli --input <file.json> --stops <stops.json> --report freq [--top N] [--output out.txt]\n";
+    out << "  textfreq_cli --input-dir <dir> [--glob PATTERN] [--threads N] --stops <stops.json> [--top N]\n";
+    out << "  textfreq_cli --update <snapshot.bin> --input-dir <dir> --stops <stops.json> [--top N]\n";
+    out << "  textfreq_cli --pack <corpus.pack> [--threads N] --stops <stops.json> [--top N]\n";
+    out << "  textfreq_cli --serve <socket|-> [--threads N] --stops <stops.json> [--top N] [--format F]\n";
+    out << "  textfreq_cli map --shard i/N --input-dir <dir> --stops <stops.json> [--output partial_i.bin]\n";
+    out << "  textfreq_cli reduce <partial_*.bin> [--top N] [--format F] [--output PATH]\n\n";
     out << "Параметры:\n";
     out << "  --help, -h        Показать эту справку.\n";
-    out << "  --input PATH      Входной JSON с текстом ({\"text\":\"...\"} или массив параграфов).\n";
+    out << "  --input PATH      Входной JSON с текстом ({\"text\":\"...\"} или массив параграфов);\n";
+    out << "                    \"-\" — стандартный ввод (разбирается потоково, как с --stream).\n";
+    out << "                    Файлы .gz и .zst (здесь, в пакетном режиме и в --stops) распаковываются на лету.\n";
+    out << "  --input-dir DIR   Пакетный режим: все файлы каталога (по умолчанию *.json, *.json.gz,\n";
+    out << "                    *.json.zst), обработка во всех потоках.\n";
+    out << "  --glob PATTERN    Шаблон файлов: с --input-dir — шаблон имени, иначе путь вида dir/text_*.json.\n";
+    out << "  --file-list PATH  Пакетный режим: текстовый файл со списком путей, по одному на строку.\n";
+    out << "  --pack PATH       Пакетный режим: корпус, упакованный textfreq_pack (один файл, отображается\n";
+    out << "                    в память; документы с извлечённым текстом не разбираются заново).\n";
+    out << "  --threads N       Число рабочих потоков: файлы пакетного режима или куски одного большого\n";
+    out << "                    документа --input (по умолчанию — все ядра).\n";
+    out << "  --read-ahead N    Пакетный режим (кроме --pack): отдельная стадия ввода держит до N чтений\n";
+    out << "                    в полёте (io_uring, где он есть, иначе потоки чтения).\n";
+    out << "  --read-ahead-memory MB  Предел памяти под прочитанные, но не разобранные файлы (по умолчанию 64).\n";
+    out << "  --processes N     Пакетный режим (кроме --pack): N локальных процессов map по шардам набора,\n";
+    out << "                    затем reduce их частичных результатов; отчёт тот же, что у одного процесса.\n";
+    out << "  --shard i/N       Для map: анализировать шард i из N (шард файла выбирается по хешу пути).\n";
+    out << "  --update PATH     Снапшот корпуса для пакетного режима: перечитываются только новые и изменённые\n";
+    out << "                    файлы, вклад удалённых вычитается; снапшот создаётся, если его нет.\n";
     out << "  --stops PATH      JSON со списком стоп-слов (массив строк или объектов {\"stop\":\"...\"}).\n";
+    out << "                    Можно передать и двоичный файл, записанный --save-stops: он отображается в память.\n";
+    out << "  --save-stops PATH Сохранить стоп-слова в компактный двоичный файл для быстрой загрузки\n";
+    out << "                    (без --input только сохраняет и завершается).\n";
+    out << "  --serve PATH      Долгоживущий сервер: запросы в рамках с длиной на Unix-сокете PATH\n";
+    out << "                    или на stdin/stdout (PATH = -); стоп-слова загружаются один раз, запросы\n";
+    out << "                    обрабатываются в --threads потоках. Протокол описан в README.\n";
+    out << "  --serve-stops NAME=PATH  Дополнительный набор стоп-слов сервера, загружаемый при запуске;\n";
+    out << "                    запрос выбирает его параметром stops=NAME (можно повторять).\n";
+    out << "  --stream          Потоковый разбор --input в постоянной памяти (для очень больших файлов).\n";
+    out << "  --ndjson          --input — поток NDJSON: по JSON-документу на строку, документы разбираются\n";
+    out << "                    по одному; строки с ошибками считаются и пропускаются.\n";
+    out << "  --approx          Приближённый анализ в фиксированной памяти: топ по Space-Saving,\n";
+    out << "                    число уникальных слов по HyperLogLog; в отчёте указаны границы ошибок.\n";
+    out << "  --approx-memory MB  Бюджет памяти приближённого режима в МБ (по умолчанию 16; включает --approx).\n";
+    out << "  --mem-limit MB    Точный подсчёт в ограниченной памяти: заполненная таблица слов сбрасывается\n";
+    out << "                    на диск отсортированным прогоном, в конце прогоны сливаются. Отчёт тот же,\n";
+    out << "                    что без ограничения; только --format text, без --approx, --ngram, --update,\n";
+    out << "                    --processes, map/reduce и --serve.\n";
+    out << "  --spill-dir DIR   Каталог для прогонов --mem-limit (по умолчанию системный временный).\n";
+    out << "  --profile [table|json]  Время этапов (чтение, разбор, токенизация, подсчёт, топ, вывод)\n";
+    out << "                    и счётчики в stderr; по умолчанию таблица.\n";
+    out << "  --ngram 2|3       Частоты биграмм или триграмм вместо слов (только --input, в том числе\n";
+    out << "                    с --stream и --ndjson); n-граммы не пересекают границ предложений.\n";
+    out << "  --keep-stop-ngrams  Учитывать и n-граммы только из стоп-слов (по умолчанию пропускаются).\n";
     out << "  --report TYPE     Тип отчёта. На данный момент поддерживается только 'freq'.\n";
     out << "  --top N           Количество слов в топе по частоте (по умолчанию 20).\n";
-    out << "  --output PATH     Путь к файлу для сохранения отчёта (если не указан, вывод в консоль).\n\n";
+    out << "  --output PATH     Путь к файлу для сохранения отчёта (если не указан, вывод в консоль).\n";
+    out << "  --format FORMAT   Формат отчёта: text (по умолчанию), json, csv или bin. Машиночитаемые\n";
+    out << "                    форматы содержат все слова, а не только топ; сводка и время — в консоль.\n";
+    out << "  --force           Перезаписать существующий --output без подтверждения.\n\n";
     out << "Примеры:\n";
     out << "  textfreq_cli --input data/sample_text.json --stops data/stopwords.json --report freq --top 20\n";
+    out << "  textfreq_cli --input-dir data/generated --stops data/stopwords.json --top 20 --threads 8\n";
     out << "  textfreq_cli --input data/large_text.json --stops data/stopwords.json --report freq --top 50 --output report.txt\n";
     return out.str();
 }
@@ -0,0 +1,340 @@
+#include "compression.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(TEXTFREQ_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(TEXTFREQ_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace
+{
+    bool ends_with(std::string_view s, std::string_view suffix)
+    {
+        return s.size() >= suffix.size() && s.substr(s.size() - suffix.size()) == suffix;
+    }
+
+    std::string unsupported_message(Compression kind)
+    {
+        return std::string("поддержка ") + compression_name(kind) + " не собрана (библиотека " +
+               (kind == Compression::Gzip ? "zlib" : "libzstd") + " не найдена при сборке)";
+    }
+
+    [[noreturn]] void unsupported(Compression kind)
+    {
+        throw std::runtime_error(unsupported_message(kind));
+    }
+
+    // Поток, распаковывающий сжатый файл кусками по kChunk байт.
+    class DecompressingBuffer : public std::streambuf
+    {
+    public:
+        static constexpr size_t kChunk = 64 * 1024;
+
+        DecompressingBuffer(const std::string& path, Compression kind)
+            : m_path(path)
+            , m_file(path, std::ios::binary)
+            , m_decoder(kind)
+            , m_in(new char[kChunk])
+            , m_out(new char[kChunk])
+        {
+            if (!m_file)
+                throw std::runtime_error("Не удалось открыть файл: " + path);
+        }
+
+    protected:
+        int_type underflow() override
+        {
+            if (gptr() < egptr())
+                return traits_type::to_int_type(*gptr());
+            for (;;)
+            {
+                if (m_pending.empty() && !m_eof)
+                {
+                    m_file.read(m_in.get(), static_cast<std::streamsize>(kChunk));
+                    if (m_file.bad())
+                        throw std::runtime_error("Ошибка чтения файла: " + m_path);
+                    const size_t got = static_cast<size_t>(m_file.gcount());
+                    m_pending = std::string_view(m_in.get(), got);
+                    m_eof = got == 0;
+                }
+                const size_t produced = m_decoder.run(m_pending, m_out.get(), kChunk);
+                if (produced != 0)
+                {
+                    setg(m_out.get(), m_out.get(), m_out.get() + produced);
+                    return traits_type::to_int_type(*gptr());
+                }
+                if (m_eof)
+                {
+                    if (!m_decoder.complete())
+                        throw std::runtime_error("Сжатый файл обрезан: " + m_path);
+                    return traits_type::eof();
+                }
+            }
+        }
+
+    private:
+        std::string m_path;
+        std::ifstream m_file;
+        Decompressor m_decoder;
+        std::unique_ptr<char[]> m_in;
+        std::unique_ptr<char[]> m_out;
+        std::string_view m_pending;
+        bool m_eof{false};
+    };
+
+    class DecompressingStream : public std::istream
+    {
+    public:
+        DecompressingStream(const std::string& path, Compression kind)
+            : std::istream(nullptr)
+            , m_buffer(path, kind)
+        {
+            rdbuf(&m_buffer);
+            // Ошибка распаковки должна дойти до вызывающего с текстом, а не
+            // превратиться в тихий конец потока.
+            exceptions(std::ios::badbit);
+        }
+
+    private:
+        DecompressingBuffer m_buffer;
+    };
+}
+
+Compression compression_of(std::string_view path)
+{
+    if (ends_with(path, ".gz"))
+        return Compression::Gzip;
+    if (ends_with(path, ".zst"))
+        return Compression::Zstd;
+    return Compression::None;
+}
+
+const char* compression_name(Compression kind)
+{
+    switch (kind)
+    {
+    case Compression::Gzip: return "gzip";
+    case Compression::Zstd: return "zstd";
+    default: return "none";
+    }
+}
+
+bool compression_supported(Compression kind)
+{
+    switch (kind)
+    {
+    case Compression::None: return true;
+#if defined(TEXTFREQ_HAVE_ZLIB)
+    case Compression::Gzip: return true;
+#endif
+#if defined(TEXTFREQ_HAVE_ZSTD)
+    case Compression::Zstd: return true;
+#endif
+    default: return false;
+    }
+}
+
+void require_compression_support(const std::string& path, Compression kind)
+{
+    if (!compression_supported(kind))
+        throw std::runtime_error("Не удалось открыть файл " + path + ": " + unsupported_message(kind));
+}
+
+struct Decompressor::Impl
+{
+#if defined(TEXTFREQ_HAVE_ZLIB)
+    z_stream zlib{};
+    bool zlib_ready{false};
+#endif
+#if defined(TEXTFREQ_HAVE_ZSTD)
+    ZSTD_DCtx* zstd{nullptr};
+#endif
+
+    ~Impl()
+    {
+#if defined(TEXTFREQ_HAVE_ZLIB)
+        if (zlib_ready)
+            inflateEnd(&zlib);
+#endif
+#if defined(TEXTFREQ_HAVE_ZSTD)
+        ZSTD_freeDCtx(zstd);
+#endif
+    }
+};
+
+Decompressor::Decompressor(Compression kind)
+    : m_impl(std::make_unique<Impl>())
+    , m_kind(kind)
+{
+    if (!compression_supported(kind) || kind == Compression::None)
+        unsupported(kind);
+#if defined(TEXTFREQ_HAVE_ZLIB)
+    if (kind == Compression::Gzip)
+    {
+        // 15 + 32: окно 32 КБ и автоопределение заголовка gzip/zlib.
+        if (inflateInit2(&m_impl->zlib, 15 + 32) != Z_OK)
+            throw std::runtime_error("Не удалось инициализировать zlib");
+        m_impl->zlib_ready = true;
+    }
+#endif
+#if defined(TEXTFREQ_HAVE_ZSTD)
+    if (kind == Compression::Zstd)
+    {
+        m_impl->zstd = ZSTD_createDCtx();
+        if (!m_impl->zstd)
+            throw std::runtime_error("Не удалось инициализировать libzstd");
+    }
+#endif
+}
+
+Decompressor::~Decompressor() = default;
+
+void Decompressor::reset()
+{
+#if defined(TEXTFREQ_HAVE_ZLIB)
+    if (m_kind == Compression::Gzip)
+        inflateReset(&m_impl->zlib);
+#endif
+#if defined(TEXTFREQ_HAVE_ZSTD)
+    if (m_kind == Compression::Zstd)
+        ZSTD_DCtx_reset(m_impl->zstd, ZSTD_reset_session_only);
+#endif
+    m_complete = true;
+}
+
+size_t Decompressor::run(std::string_view& in, char* out, size_t capacity)
+{
+    size_t produced = 0;
+    while (produced < capacity)
+    {
+        // Следующий поток склейки начинается с новых данных.
+        if (m_complete)
+        {
+            if (in.empty())
+                break;
+#if defined(TEXTFREQ_HAVE_ZLIB)
+            if (m_kind == Compression::Gzip)
+                inflateReset(&m_impl->zlib);
+#endif
+            m_complete = false;
+        }
+
+        size_t consumed = 0;
+        size_t written = 0;
+#if defined(TEXTFREQ_HAVE_ZLIB)
+        if (m_kind == Compression::Gzip)
+        {
+            z_stream& zs = m_impl->zlib;
+            const auto in_size = static_cast<uInt>(std::min<size_t>(in.size(), UINT_MAX));
+            const auto out_size = static_cast<uInt>(std::min<size_t>(capacity - produced, UINT_MAX));
+            zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+            zs.avail_in = in_size;
+            zs.next_out = reinterpret_cast<Bytef*>(out + produced);
+            zs.avail_out = out_size;
+            const int rc = inflate(&zs, Z_NO_FLUSH);
+            consumed = in_size - zs.avail_in;
+            written = out_size - zs.avail_out;
+            if (rc == Z_STREAM_END)
+                m_complete = true;
+            else if (rc != Z_OK && rc != Z_BUF_ERROR)
+                throw std::runtime_error(std::string("Повреждённые данные gzip: ") +
+                                         (zs.msg ? zs.msg : "код " + std::to_string(rc)));
+        }
+#endif
+#if defined(TEXTFREQ_HAVE_ZSTD)
+        if (m_kind == Compression::Zstd)
+        {
+            ZSTD_inBuffer input{in.data(), in.size(), 0};
+            ZSTD_outBuffer output{out + produced, capacity - produced, 0};
+            const size_t rc = ZSTD_decompressStream(m_impl->zstd, &output, &input);
+            if (ZSTD_isError(rc))
+                throw std::runtime_error(std::string("Повреждённые данные zstd: ") + ZSTD_getErrorName(rc));
+            consumed = input.pos;
+            written = output.pos;
+            if (rc == 0)
+                m_complete = true;
+        }
+#endif
+        in.remove_prefix(consumed);
+        produced += written;
+        if (consumed == 0 && written == 0 && !m_complete)
+            break;
+    }
+    return produced;
+}
+
+void decompress(std::string_view data, Compression kind, std::string& out)
+{
+    Decompressor decoder(kind);
+    out.resize(std::max<size_t>(out.capacity(), std::max<size_t>(data.size() * 4, 64 * 1024)));
+    size_t size = 0;
+    for (;;)
+    {
+        if (size == out.size())
+            out.resize(out.size() * 2);
+        const size_t produced = decoder.run(data, out.data() + size, out.size() - size);
+        size += produced;
+        if (produced == 0)
+            break;
+    }
+    out.resize(size);
+    if (!decoder.complete())
+        throw std::runtime_error(std::string("Сжатые данные ") + compression_name(kind) + " обрезаны");
+}
+
+std::string compress(std::string_view data, Compression kind)
+{
+    if (!compression_supported(kind) || kind == Compression::None)
+        unsupported(kind);
+    std::string out;
+#if defined(TEXTFREQ_HAVE_ZLIB)
+    if (kind == Compression::Gzip)
+    {
+        z_stream zs{};
+        // 15 + 16: окно 32 КБ и заголовок gzip.
+        if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error("Не удалось инициализировать zlib");
+        out.resize(deflateBound(&zs, static_cast<uLong>(data.size())));
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        zs.avail_in = static_cast<uInt>(data.size());
+        zs.next_out = reinterpret_cast<Bytef*>(out.data());
+        zs.avail_out = static_cast<uInt>(out.size());
+        const int rc = deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+        if (rc != Z_STREAM_END)
+            throw std::runtime_error("Ошибка сжатия gzip");
+    }
+#endif
+#if defined(TEXTFREQ_HAVE_ZSTD)
+    if (kind == Compression::Zstd)
+    {
+        out.resize(ZSTD_compressBound(data.size()));
+        const size_t rc = ZSTD_compress(out.data(), out.size(), data.data(), data.size(), 3);
+        if (ZSTD_isError(rc))
+            throw std::runtime_error(std::string("Ошибка сжатия zstd: ") + ZSTD_getErrorName(rc));
+        out.resize(rc);
+    }
+#endif
+    return out;
+}
+
+std::unique_ptr<std::istream> open_input_stream(const std::string& path)
+{
+    const Compression kind = compression_of(path);
+    if (kind == Compression::None)
+    {
+        auto file = std::make_unique<std::ifstream>(path, std::ios::binary);
+        if (!*file)
+            throw std::runtime_error("Не удалось открыть файл: " + path);
+        return file;
+    }
+    require_compression_support(path, kind);
+    return std::make_unique<DecompressingStream>(path, kind);
+}
@@ -0,0 +1,458 @@
+#include "external_count.hpp"
+#include "report_writer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr char kMagic[4] = {'T', 'F', 'R', 'N'};
+    constexpr std::uint32_t kVersion = 1;
+    constexpr std::uint32_t kStopBit = 0x80000000u;
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t reserved;
+    };
+
+    struct RunRecord
+    {
+        std::uint64_t count;
+        std::uint32_t size;
+        std::uint32_t length; // старший бит — стоп-слово
+    };
+
+    static_assert(sizeof(Header) == 16 && sizeof(RunRecord) == 16,
+                  "записи прогона должны быть без выравнивающих дыр");
+
+    [[noreturn]] void corrupted(const std::string& path, const char* what)
+    {
+        throw std::runtime_error("Прогон внешнего подсчёта повреждён (" + std::string(what) + "): " + path);
+    }
+
+    // Запись прогона через буфер FdWriter (ExternalCounter::kIoBuffer байт).
+    class RunWriter
+    {
+    public:
+        explicit RunWriter(const std::string& path)
+            : m_out(path)
+        {
+            Header header{};
+            std::memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = kVersion;
+            m_out.write_pod(header);
+            m_bytes = sizeof(Header);
+        }
+
+        void add(std::string_view word, std::uint64_t count, bool stop, std::uint32_t length)
+        {
+            RunRecord record{count, static_cast<std::uint32_t>(word.size()), (length & ~kStopBit) | (stop ? kStopBit : 0)};
+            m_out.write_pod(record);
+            m_out.write(word);
+            m_bytes += sizeof(RunRecord) + word.size();
+            ++m_words;
+        }
+
+        void close() { m_out.close(); }
+
+        std::uint64_t words() const noexcept { return m_words; }
+        std::uint64_t bytes() const noexcept { return m_bytes; }
+
+    private:
+        FdWriter m_out;
+        std::uint64_t m_words{0};
+        std::uint64_t m_bytes{0};
+    };
+
+    // Последовательное чтение прогона кусками по kIoBuffer байт прямо из
+    // дескриптора: у std::ifstream был бы ещё свой буфер сверх бюджета слияния.
+    class RunReader
+    {
+    public:
+        explicit RunReader(const std::string& path)
+            : m_path(path)
+            , m_buffer(new char[ExternalCounter::kIoBuffer])
+        {
+#if defined(_WIN32)
+            m_fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+            m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+            if (m_fd < 0)
+                throw std::runtime_error("Не удалось открыть прогон внешнего подсчёта: " + path);
+            Header header;
+            if (take(&header, sizeof(header)) != sizeof(header) ||
+                std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+                corrupted(path, "нет заголовка");
+            if (header.version != kVersion)
+                corrupted(path, "другая версия формата");
+        }
+
+        // Следующая запись; false — прогон кончился.
+        bool next()
+        {
+            RunRecord record;
+            const size_t got = take(&record, sizeof(record));
+            if (got == 0)
+                return false;
+            if (got != sizeof(record))
+                corrupted(m_path, "обрыв записи");
+            m_word.resize(record.size);
+            if (take(m_word.data(), record.size) != record.size)
+                corrupted(m_path, "обрыв слова");
+            m_count = record.count;
+            m_stop = (record.length & kStopBit) != 0;
+            m_length = record.length & ~kStopBit;
+            return true;
+        }
+
+        ~RunReader()
+        {
+#if defined(_WIN32)
+            _close(m_fd);
+#else
+            ::close(m_fd);
+#endif
+        }
+
+        RunReader(const RunReader&) = delete;
+        RunReader& operator=(const RunReader&) = delete;
+
+        const std::string& word() const noexcept { return m_word; }
+        std::uint64_t count() const noexcept { return m_count; }
+        bool stop() const noexcept { return m_stop; }
+        std::uint32_t length() const noexcept { return m_length; }
+
+    private:
+        std::string m_path;
+        int m_fd{-1};
+        std::unique_ptr<char[]> m_buffer;
+        size_t m_pos{0};
+        size_t m_end{0};
+        std::string m_word;
+        std::uint64_t m_count{0};
+        bool m_stop{false};
+        std::uint32_t m_length{0};
+
+        size_t take(void* out, size_t n)
+        {
+            char* dst = static_cast<char*>(out);
+            size_t done = 0;
+            while (done < n)
+            {
+                if (m_pos == m_end)
+                {
+                    m_pos = 0;
+                    m_end = read_some();
+                    if (m_end == 0)
+                        break;
+                }
+                const size_t step = std::min(n - done, m_end - m_pos);
+                std::memcpy(dst + done, m_buffer.get() + m_pos, step);
+                m_pos += step;
+                done += step;
+            }
+            return done;
+        }
+
+        size_t read_some()
+        {
+            while (true)
+            {
+#if defined(_WIN32)
+                const int n = _read(m_fd, m_buffer.get(), static_cast<unsigned>(ExternalCounter::kIoBuffer));
+#else
+                const ssize_t n = ::read(m_fd, m_buffer.get(), ExternalCounter::kIoBuffer);
+                if (n < 0 && errno == EINTR)
+                    continue;
+#endif
+                if (n < 0)
+                    throw std::runtime_error("Ошибка чтения прогона внешнего подсчёта: " + m_path);
+                return static_cast<size_t>(n);
+            }
+        }
+    };
+
+    // k-путевое слияние прогонов paths: куча читателей по текущему слову,
+    // частоты одинаковых слов суммируются.
+    void merge_runs(const std::vector<std::string>& paths, const ExternalCounter::Visitor& visit)
+    {
+        std::vector<std::unique_ptr<RunReader>> readers;
+        std::vector<size_t> heap;
+        readers.reserve(paths.size());
+        for (const std::string& path : paths)
+        {
+            readers.push_back(std::make_unique<RunReader>(path));
+            if (readers.back()->next())
+                heap.push_back(readers.size() - 1);
+        }
+        // На вершине — читатель с наименьшим словом.
+        auto later = [&readers](size_t a, size_t b) { return readers[a]->word() > readers[b]->word(); };
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        std::string word;
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            RunReader& first = *readers[heap.back()];
+            word = first.word();
+            std::uint64_t count = first.count();
+            const bool stop = first.stop();
+            const std::uint32_t length = first.length();
+            if (first.next())
+                std::push_heap(heap.begin(), heap.end(), later);
+            else
+                heap.pop_back();
+
+            while (!heap.empty() && readers[heap.front()]->word() == word)
+            {
+                std::pop_heap(heap.begin(), heap.end(), later);
+                RunReader& same = *readers[heap.back()];
+                count += same.count();
+                if (same.next())
+                    std::push_heap(heap.begin(), heap.end(), later);
+                else
+                    heap.pop_back();
+            }
+            visit(word, count, stop, length);
+        }
+    }
+
+    // Строка топа со своей копией слова: прогоны читаются в переиспользуемые
+    // буферы, ссылаться в них нельзя.
+    struct TopRow
+    {
+        std::string word;
+        std::uint64_t count;
+        bool stop;
+        std::uint32_t length;
+    };
+
+    // Ограниченная куча k лучших строк в порядке отчёта (частота по убыванию,
+    // затем слово); на вершине — худшая из них.
+    class TopRows
+    {
+    public:
+        explicit TopRows(size_t k) : m_k(k) {}
+
+        void offer(std::string_view word, std::uint64_t count, bool stop, std::uint32_t length)
+        {
+            if (m_k == 0)
+                return;
+            if (m_rows.size() < m_k)
+            {
+                m_rows.push_back({std::string(word), count, stop, length});
+                std::push_heap(m_rows.begin(), m_rows.end(), ranks_higher);
+                return;
+            }
+            const TopRow& worst = m_rows.front();
+            if (count < worst.count || (count == worst.count && word >= worst.word))
+                return;
+            std::pop_heap(m_rows.begin(), m_rows.end(), ranks_higher);
+            TopRow& row = m_rows.back();
+            row.word.assign(word);
+            row.count = count;
+            row.stop = stop;
+            row.length = length;
+            std::push_heap(m_rows.begin(), m_rows.end(), ranks_higher);
+        }
+
+        const std::vector<TopRow>& rows() const noexcept { return m_rows; }
+
+    private:
+        size_t m_k;
+        std::vector<TopRow> m_rows;
+
+        static bool ranks_higher(const TopRow& a, const TopRow& b)
+        {
+            if (a.count != b.count)
+                return a.count > b.count;
+            return a.word < b.word;
+        }
+    };
+}
+
+ExternalCounter::ExternalCounter(size_t memory_limit, const std::string& temp_dir)
+    : m_limit(memory_limit)
+{
+    if (memory_limit < kMinLimit)
+        throw std::runtime_error("Бюджет памяти внешнего подсчёта должен быть не меньше " +
+                                 std::to_string(kMinLimit / 1024) + " КБ.");
+    try
+    {
+        const fs::path base = temp_dir.empty() ? fs::temp_directory_path() : fs::path(temp_dir);
+        fs::create_directories(base);
+        // Имя с отметкой времени: параллельные запуски не делят каталог прогонов.
+        const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        for (unsigned attempt = 0; m_dir.empty(); ++attempt)
+        {
+            const fs::path dir = base / ("textfreq_runs_" + std::to_string(stamp) + "_" + std::to_string(attempt));
+            if (fs::create_directory(dir))
+                m_dir = dir.string();
+        }
+    }
+    catch (const fs::filesystem_error& e)
+    {
+        throw std::runtime_error("Не удалось создать каталог прогонов внешнего подсчёта: " + std::string(e.what()));
+    }
+}
+
+ExternalCounter::~ExternalCounter()
+{
+    std::error_code ignored;
+    fs::remove_all(m_dir, ignored);
+}
+
+size_t ExternalCounter::workers(size_t threads) const
+{
+    const size_t wanted = threads ? threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(wanted, m_limit / kMinLimit));
+}
+
+std::string ExternalCounter::next_run_path()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (fs::path(m_dir) / ("run_" + std::to_string(m_next_run++) + ".bin")).string();
+}
+
+void ExternalCounter::spill(const Vocabulary& vocab, std::vector<Vocabulary::Id>& order)
+{
+    order.clear();
+    for (Vocabulary::Id id = 0; id < vocab.size(); ++id)
+    {
+        if (vocab.count(id) != 0)
+            order.push_back(id);
+    }
+    if (order.empty())
+        return;
+    std::sort(order.begin(), order.end(),
+              [&vocab](Vocabulary::Id a, Vocabulary::Id b) { return vocab.word(a) < vocab.word(b); });
+
+    // Файл пишется без блокировки: потоки сбрасывают свои таблицы одновременно.
+    const std::string path = next_run_path();
+    RunWriter out(path);
+    size_t max_word = 0;
+    for (Vocabulary::Id id : order)
+    {
+        out.add(vocab.word(id), vocab.count(id), vocab.is_stop(id), vocab.length(id));
+        max_word = std::max(max_word, vocab.word(id).size());
+    }
+    out.close();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_word = std::max(m_max_word, max_word);
+    m_runs.push_back(path);
+    ++m_spilled_runs;
+    m_spilled_words += out.words();
+    m_spilled_bytes += out.bytes();
+}
+
+size_t ExternalCounter::runs() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_spilled_runs;
+}
+
+std::uint64_t ExternalCounter::spilled_words() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_spilled_words;
+}
+
+std::uint64_t ExternalCounter::spilled_bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_spilled_bytes;
+}
+
+void ExternalCounter::merge(const Visitor& visit)
+{
+    // На каждый входной прогон — буфер чтения, сам читатель, копия самого
+    // длинного слова и место в куче; общие — буфер записи промежуточного прогона
+    // и текущее слово слияния.
+    const size_t max_word = [this] {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_max_word;
+    }();
+    const size_t per_run = kIoBuffer + sizeof(RunReader) + sizeof(std::unique_ptr<RunReader>) + sizeof(size_t) +
+                           max_word;
+    const size_t shared = kIoBuffer + max_word;
+    const size_t fan_in = std::max<size_t>(2, m_limit > shared ? (m_limit - shared) / per_run : 0);
+    while (m_runs.size() > fan_in)
+    {
+        const std::vector<std::string> inputs(m_runs.begin(), m_runs.begin() + static_cast<std::ptrdiff_t>(fan_in));
+        const std::string path = next_run_path();
+        RunWriter out(path);
+        merge_runs(inputs, [&out](std::string_view word, std::uint64_t count, bool stop, std::uint32_t length) {
+            out.add(word, count, stop, length);
+        });
+        out.close();
+        for (const std::string& input : inputs)
+            fs::remove(input);
+        m_runs.erase(m_runs.begin(), m_runs.begin() + static_cast<std::ptrdiff_t>(fan_in));
+        m_runs.push_back(path);
+        ++m_intermediate_merges;
+    }
+    merge_runs(m_runs, visit);
+}
+
+void ExternalCounter::finish(TextStats& stats, size_t top_n)
+{
+    stats.unique_words = 0;
+    stats.word_freq.clear();
+    stats.word_freq_no_stops.clear();
+    stats.length_distribution.clear();
+
+    TopRows all(top_n);
+    TopRows no_stops(top_n);
+    merge([&](std::string_view word, std::uint64_t count, bool stop, std::uint32_t length) {
+        ++stats.unique_words;
+        stats.length_distribution[length] += count;
+        all.offer(word, count, stop, length);
+        if (!stop)
+            no_stops.offer(word, count, stop, length);
+    });
+
+    Vocabulary vocab;
+    for (const TopRows* top : {&all, &no_stops})
+    {
+        for (const TopRow& row : top->rows())
+        {
+            auto [id, inserted] = vocab.intern(row.word);
+            if (!inserted)
+                continue;
+            vocab.set_count(id, row.count);
+            vocab.set_stop(id, row.stop);
+            vocab.set_length(id, row.length);
+        }
+    }
+    stats.vocab = std::move(vocab);
+}
+
+std::string format_external_summary(const ExternalCounter& counter)
+{
+    std::ostringstream out;
+    out << "Внешний подсчёт (бюджет " << counter.memory_limit() / 1024 << " КБ): прогонов " << counter.runs()
+        << " (слов " << counter.spilled_words() << ", " << counter.spilled_bytes() << " байт), промежуточных слияний "
+        << counter.intermediate_merges() << "\n";
+    return out.str();
+}
@@ -0,0 +1,238 @@
+#include "file_input.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if !defined(_WIN32)
+namespace
+{
+    struct FdGuard
+    {
+        int fd;
+        ~FdGuard() { ::close(fd); }
+    };
+}
+#endif
+
+InputFile::~InputFile()
+{
+    close();
+}
+
+char* InputFile::reserve(size_t size)
+{
+    if (size > m_capacity)
+    {
+        size_t capacity = std::max(size, m_capacity * 2);
+        std::unique_ptr<char[]> grown(new char[capacity]);
+        if (!m_view.empty() && m_view.data() == m_buffer.get())
+            std::memcpy(grown.get(), m_buffer.get(), m_view.size());
+        m_buffer = std::move(grown);
+        m_capacity = capacity;
+    }
+    return m_buffer.get();
+}
+
+void InputFile::close()
+{
+#if !defined(_WIN32)
+    if (m_map)
+    {
+        ::munmap(m_map, m_map_size);
+    }
+#endif
+    m_map = nullptr;
+    m_map_size = 0;
+    m_view = {};
+}
+
+void InputFile::open_compressed(const std::string& path, Compression kind)
+{
+    constexpr size_t kChunk = 256 * 1024;
+
+    require_compression_support(path, kind);
+#if defined(_WIN32)
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("Не удалось открыть файл: " + path);
+    }
+    auto read = [&in](char* data, size_t size) -> size_t {
+        in.read(data, static_cast<std::streamsize>(size));
+        if (in.bad())
+            throw std::runtime_error("ошибка чтения");
+        return static_cast<size_t>(in.gcount());
+    };
+#else
+    // Без std::ifstream: на тысячах мелких файлов его открытие заметно дороже open().
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Не удалось открыть файл: " + path);
+    }
+    FdGuard guard{fd};
+    auto read = [fd](char* data, size_t size) -> size_t {
+        while (true)
+        {
+            const ssize_t n = ::read(fd, data, size);
+            if (n >= 0)
+                return static_cast<size_t>(n);
+            if (errno != EINTR)
+                throw std::runtime_error("ошибка чтения");
+        }
+    };
+#endif
+    // Распаковщик и буфер переиспользуются: в пакетном режиме файлы мелкие.
+    if (m_decoder && m_decoder->kind() == kind)
+        m_decoder->reset();
+    else
+        m_decoder = std::make_unique<Decompressor>(kind);
+    Decompressor& decoder = *m_decoder;
+    if (!m_chunk)
+        m_chunk.reset(new char[kChunk]);
+
+    // Сжатый файл читается кусками и распаковывается сразу в буфер разбора.
+    std::string_view pending;
+    bool eof = false;
+    size_t size = 0;
+    try
+    {
+        while (true)
+        {
+            if (pending.empty() && !eof)
+            {
+                pending = std::string_view(m_chunk.get(), read(m_chunk.get(), kChunk));
+                eof = pending.empty();
+            }
+            char* data = reserve(size + kChunk);
+            const size_t produced = decoder.run(pending, data + size, m_capacity - size);
+            size += produced;
+            m_view = std::string_view(data, size);
+            if (produced == 0 && eof)
+                break;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        m_view = {};
+        throw std::runtime_error("Ошибка чтения файла " + path + ": " + e.what());
+    }
+    if (!decoder.complete())
+    {
+        m_view = {};
+        throw std::runtime_error("Сжатый файл обрезан: " + path);
+    }
+}
+
+#if defined(_WIN32)
+
+void InputFile::open(const std::string& path)
+{
+    close();
+    if (const Compression kind = compression_of(path); kind != Compression::None)
+    {
+        open_compressed(path, kind);
+        return;
+    }
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+    {
+        throw std::runtime_error("Не удалось открыть файл: " + path);
+    }
+    size_t size = static_cast<size_t>(in.tellg());
+    in.seekg(0);
+    char* data = reserve(size);
+    if (!in.read(data, static_cast<std::streamsize>(size)))
+    {
+        throw std::runtime_error("Ошибка чтения файла: " + path);
+    }
+    m_view = std::string_view(data, size);
+}
+
+#else
+
+void InputFile::open(const std::string& path)
+{
+    close();
+    if (const Compression kind = compression_of(path); kind != Compression::None)
+    {
+        open_compressed(path, kind);
+        return;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Не удалось открыть файл: " + path);
+    }
+    FdGuard guard{fd};
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0)
+    {
+        throw std::runtime_error("Не удалось получить размер файла: " + path);
+    }
+
+    if (S_ISREG(st.st_mode))
+    {
+        size_t size = static_cast<size_t>(st.st_size);
+        if (size >= kMmapThreshold)
+        {
+            void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                ::madvise(map, size, MADV_SEQUENTIAL);
+                m_map = map;
+                m_map_size = size;
+                m_view = std::string_view(static_cast<const char*>(map), size);
+                return;
+            }
+            // mmap недоступен (например, на некоторых ФС) — читаем в буфер.
+        }
+
+        char* data = reserve(size);
+        size_t done = 0;
+        while (done < size)
+        {
+            ssize_t n = ::pread(fd, data + done, size - done, static_cast<off_t>(done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                throw std::runtime_error("Ошибка чтения файла: " + path);
+            if (n == 0)
+                break; // файл укоротился во время чтения
+            done += static_cast<size_t>(n);
+        }
+        m_view = std::string_view(data, done);
+        return;
+    }
+
+    // Канал или устройство: размер заранее неизвестен, читаем до конца.
+    size_t done = 0;
+    while (true)
+    {
+        char* data = reserve(done + kMmapThreshold);
+        ssize_t n = ::read(fd, data + done, m_capacity - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            throw std::runtime_error("Ошибка чтения файла: " + path);
+        if (n == 0)
+            break;
+        done += static_cast<size_t>(n);
+        m_view = std::string_view(m_buffer.get(), done);
+    }
+    m_view = std::string_view(m_buffer.get(), done);
+}
+
+#endif
@@ -1,4 +1,7 @@
 #include "json_parser.hpp"
+#include "json_sax.hpp"
+#include "json_scan.hpp"
+#include "json_tape.hpp"
 
 #include <cctype>
 #include <stdexcept>
@@ -12,13 +15,14 @@ namespace json
     {
     }
 
-    Parser::Parser(const std::string& text)
+    Parser::Parser(std::string_view text)
         : m_text(text)
     {
     }
 
     Value Parser::parse()
     {
+        m_depth = 0;
         skip_whitespace();
         Value v = parse_value();
         skip_whitespace();
@@ -29,37 +33,35 @@ namespace json
         return v;
     }
 
-    void Parser::skip_whitespace()
+    void Parser::parse(Tape& tape)
     {
-        while (!eof() && std::isspace(static_cast<unsigned char>(m_text[m_pos])))
-            ++m_pos;
-    }
-
-    bool Parser::match(char c)
-    {
-        if (!eof() && m_text[m_pos] == c)
+        tape.clear();
+        m_pos = 0;
+        m_depth = 0;
+        skip_whitespace();
+        parse_tape_value(tape);
+        skip_whitespace();
+        if (!eof())
         {
-            ++m_pos;
-            return true;
+            error("Unexpected characters after JSON value");
         }
-        return false;
     }
 
-    char Parser::peek() const
+    void Parser::parse(SaxHandler& handler)
     {
-        return eof() ? '\0' : m_text[m_pos];
+        SaxParser(m_text.substr(m_pos)).parse(handler);
+        m_pos = m_text.size();
     }
 
-    char Parser::get()
+    void Parser::enter_container()
     {
-        if (eof())
-            error("Unexpected end of input");
-        return m_text[m_pos++];
+        if (++m_depth > kMaxDepth)
+            error("Nesting deeper than " + std::to_string(kMaxDepth) + " levels");
     }
 
-    bool Parser::eof() const
+    void Parser::skip_whitespace()
     {
-        return m_pos >= m_text.size();
+        m_pos += scan::space_run(m_text.data() + m_pos, m_text.size() - m_pos);
     }
 
     Value Parser::parse_value()
@@ -75,124 +77,121 @@ namespace json
         error("Unexpected character while parsing value");
     }
 
-    Value Parser::parse_null()
+    void Parser::expect_literal(std::string_view literal)
     {
-        const std::string expected = "null";
-        for (char ch : expected)
+        for (char ch : literal)
         {
             if (get() != ch)
-                error("Invalid literal 'null'");
+                error("Invalid literal '" + std::string(literal) + "'");
         }
+    }
+
+    Value Parser::parse_null()
+    {
+        expect_literal("null");
         return Value{std::nullptr_t{}};
     }
 
     Value Parser::parse_true()
     {
-        const std::string expected = "true";
-        for (char ch : expected)
-        {
-            if (get() != ch)
-                error("Invalid literal 'true'");
-        }
+        expect_literal("true");
         return Value{true};
     }
 
     Value Parser::parse_false()
     {
-        const std::string expected = "false";
-        for (char ch : expected)
-        {
-            if (get() != ch)
-                error("Invalid literal 'false'");
-        }
+        expect_literal("false");
         return Value{false};
     }
 
     Value Parser::parse_number()
     {
-        size_t start = m_pos;
-        if (match('-')) {}
-        if (!eof() && peek() == '0')
-        {
-            get();
-        }
-        else
-        {
-            if (!std::isdigit(static_cast<unsigned char>(peek())))
-                error("Invalid number");
-            while (!eof() && std::isdigit(static_cast<unsigned char>(peek())))
-                get();
-        }
+        return Value{parse_number_value()};
+    }
 
-        if (!eof() && peek() == '.')
+    double Parser::parse_number_value()
+    {
+        // Синтаксис проверяется по байтам входа, без get()/peek() на каждую цифру.
+        const char* text = m_text.data();
+        const size_t size = m_text.size();
+        auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+        auto digits = [&]() {
+            const size_t first = m_pos;
+            while (m_pos < size && is_digit(text[m_pos]))
+                ++m_pos;
+            return m_pos != first;
+        };
+
+        const size_t start = m_pos;
+        if (m_pos < size && text[m_pos] == '-')
+            ++m_pos;
+        if (m_pos < size && text[m_pos] == '0')
+            ++m_pos;
+        else if (!digits())
+            error("Invalid number");
+
+        if (m_pos < size && text[m_pos] == '.')
         {
-            get();
-            if (!std::isdigit(static_cast<unsigned char>(peek())))
+            ++m_pos;
+            if (!digits())
                 error("Invalid number after decimal point");
-            while (!eof() && std::isdigit(static_cast<unsigned char>(peek())))
-                get();
         }
 
-        if (!eof() && (peek() == 'e' || peek() == 'E'))
+        if (m_pos < size && (text[m_pos] == 'e' || text[m_pos] == 'E'))
         {
-            get();
-            if (peek() == '+' || peek() == '-')
-                get();
-            if (!std::isdigit(static_cast<unsigned char>(peek())))
+            ++m_pos;
+            if (m_pos < size && (text[m_pos] == '+' || text[m_pos] == '-'))
+                ++m_pos;
+            if (!digits())
                 error("Invalid exponent");
-            while (!eof() && std::isdigit(static_cast<unsigned char>(peek())))
-                get();
         }
 
-        std::string number_str = m_text.substr(start, m_pos - start);
         double value{};
-        try
-        {
-            value = std::stod(number_str);
-        }
-        catch (...)
-        {
+        if (!scan::to_double(m_text.substr(start, m_pos - start), value))
             error("Failed to convert number");
-        }
-        return Value{value};
+        return value;
     }
 
     std::string Parser::parse_raw_string()
+    {
+        std::string result;
+        parse_raw_string_into(result);
+        return result;
+    }
+
+    void Parser::parse_raw_string_into(std::string& result)
     {
         if (!match('"'))
             error("Expected '\"' at beginning of string");
 
-        std::string result;
-        while (!eof())
+        result.clear();
+        for (;;)
         {
-            char c = get();
-            if (c == '"')
+            // Участок без '"' и '\\' копируется целиком.
+            const size_t run = scan::string_run(m_text.data() + m_pos, m_text.size() - m_pos);
+            result.append(m_text.data() + m_pos, run);
+            m_pos += run;
+            if (eof())
+                error("Unterminated string");
+            if (m_text[m_pos++] == '"')
                 break;
-            if (c == '\\')
-            {
-                if (eof())
-                    error("Unfinished escape sequence");
-                char esc = get();
-                switch (esc)
-                {
-                case '"': result.push_back('"'); break;
-                case '\\': result.push_back('\\'); break;
-                case '/': result.push_back('/'); break;
-                case 'b': result.push_back('\b'); break;
-                case 'f': result.push_back('\f'); break;
-                case 'n': result.push_back('\n'); break;
-                case 'r': result.push_back('\r'); break;
-                case 't': result.push_back('\t'); break;
-                default:
-                    error("Unsupported escape sequence");
-                }
-            }
-            else
-            {
-                result.push_back(c);
-            }
+            if (eof())
+                error("Unfinished escape sequence");
+            append_escape(result);
         }
-        return result;
+    }
+
+    void Parser::append_escape(std::string& out)
+    {
+        struct Source
+        {
+            Parser& parser;
+            char get() { return parser.get(); }
+            char peek() const { return parser.peek(); }
+            [[noreturn]] void error(const char* msg) const { parser.error(msg); }
+        } source{*this};
+
+        scan::decode_escape(source, [&out](std::string_view bytes) { out.append(bytes); });
     }
 
     Value Parser::parse_string()
@@ -204,10 +203,14 @@ namespace json
     {
         if (!match('['))
             error("Expected '['");
+        enter_container();
         skip_whitespace();
         Array arr;
         if (match(']'))
+        {
+            --m_depth;
             return Value{arr};
+        }
         while (true)
         {
             skip_whitespace();
@@ -218,6 +221,7 @@ namespace json
             if (!match(','))
                 error("Expected ',' or ']'");
         }
+        --m_depth;
         return Value{arr};
     }
 
@@ -225,10 +229,14 @@ namespace json
     {
         if (!match('{'))
             error("Expected '{'");
+        enter_container();
         skip_whitespace();
         Object obj;
         if (match('}'))
+        {
+            --m_depth;
             return Value{obj};
+        }
         while (true)
         {
             skip_whitespace();
@@ -247,9 +255,120 @@ namespace json
             if (!match(','))
                 error("Expected ',' or '}'");
         }
+        --m_depth;
         return Value{obj};
     }
 
+    std::string_view Parser::parse_tape_string(Tape& tape)
+    {
+        // Быстрый путь: строка без экранирований — срез входного буфера.
+        const size_t start = m_pos + 1;
+        const size_t i = start + scan::string_run(m_text.data() + start, m_text.size() - start);
+        if (i < m_text.size() && m_text[i] == '"')
+        {
+            m_pos = i + 1;
+            return m_text.substr(start, i - start);
+        }
+        parse_raw_string_into(m_scratch);
+        return tape.m_arena.store(m_scratch);
+    }
+
+    void Parser::parse_tape_value(Tape& tape)
+    {
+        auto& nodes = tape.m_nodes;
+        size_t index = nodes.size();
+        nodes.emplace_back();
+        TapeNode& node = nodes.back();
+
+        char c = peek();
+        if (c == 'n')
+        {
+            expect_literal("null");
+            node.type = NodeType::Null;
+        }
+        else if (c == 't' || c == 'f')
+        {
+            expect_literal(c == 't' ? "true" : "false");
+            node.type = NodeType::Bool;
+            node.boolean = (c == 't');
+        }
+        else if (c == '"')
+        {
+            node.type = NodeType::String;
+            node.str = parse_tape_string(tape);
+        }
+        else if (c == '-' || std::isdigit(static_cast<unsigned char>(c)))
+        {
+            node.type = NodeType::Number;
+            node.number = parse_number_value();
+        }
+        else if (c == '[')
+        {
+            node.type = NodeType::Array;
+            get();
+            enter_container();
+            skip_whitespace();
+            std::uint32_t count = 0;
+            if (!match(']'))
+            {
+                while (true)
+                {
+                    skip_whitespace();
+                    parse_tape_value(tape);
+                    ++count;
+                    skip_whitespace();
+                    if (match(']'))
+                        break;
+                    if (!match(','))
+                        error("Expected ',' or ']'");
+                }
+            }
+            --m_depth;
+            nodes[index].count = count;
+        }
+        else if (c == '{')
+        {
+            node.type = NodeType::Object;
+            get();
+            enter_container();
+            skip_whitespace();
+            std::uint32_t count = 0;
+            if (!match('}'))
+            {
+                while (true)
+                {
+                    skip_whitespace();
+                    if (peek() != '"')
+                        error("Expected string key");
+                    TapeNode key;
+                    key.type = NodeType::String;
+                    key.str = parse_tape_string(tape);
+                    key.end = static_cast<std::uint32_t>(nodes.size() + 1);
+                    nodes.push_back(key);
+                    skip_whitespace();
+                    if (!match(':'))
+                        error("Expected ':' after key");
+                    skip_whitespace();
+                    parse_tape_value(tape);
+                    ++count;
+                    skip_whitespace();
+                    if (match('}'))
+                        break;
+                    if (!match(','))
+                        error("Expected ',' or '}'");
+                }
+            }
+            --m_depth;
+            nodes[index].count = count;
+        }
+        else
+        {
+            error("Unexpected character while parsing value");
+        }
+        // Ссылка node могла стать недействительной после вложенных emplace_back.
+        nodes[index].end = static_cast<std::uint32_t>(nodes.size());
+    }
+
     [[noreturn]] void Parser::error(const std::string& msg) const
     {
         std::ostringstream oss;
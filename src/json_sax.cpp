@@ -0,0 +1,310 @@
+#include "json_sax.hpp"
+#include "json_scan.hpp"
+
+#include <cctype>
+#include <sstream>
+
+namespace json
+{
+    SaxParser::SaxParser(std::string_view text)
+        : m_data(text.data())
+        , m_size(text.size())
+    {
+    }
+
+    SaxParser::SaxParser(std::istream& in, size_t buffer_size)
+        : m_in(&in)
+        , m_buffer(new char[buffer_size])
+        , m_capacity(buffer_size)
+        , m_data(m_buffer.get())
+    {
+    }
+
+    void SaxParser::parse(SaxHandler& handler)
+    {
+        skip_whitespace();
+        parse_value(handler);
+        skip_whitespace();
+        if (!eof())
+        {
+            error("Unexpected characters after JSON value");
+        }
+    }
+
+    bool SaxParser::refill()
+    {
+        if (!m_in || !*m_in)
+            return false;
+        m_offset += m_size;
+        m_in->read(m_buffer.get(), static_cast<std::streamsize>(m_capacity));
+        m_size = static_cast<size_t>(m_in->gcount());
+        m_pos = 0;
+        return m_size > 0;
+    }
+
+    bool SaxParser::eof()
+    {
+        return m_pos >= m_size && !refill();
+    }
+
+    char SaxParser::peek()
+    {
+        return eof() ? '\0' : m_data[m_pos];
+    }
+
+    char SaxParser::get()
+    {
+        if (eof())
+            error("Unexpected end of input");
+        return m_data[m_pos++];
+    }
+
+    bool SaxParser::match(char c)
+    {
+        if (!eof() && m_data[m_pos] == c)
+        {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    void SaxParser::skip_whitespace()
+    {
+        // Пробелы пропускаются блоками в пределах окна; окно кончилось — следующее.
+        while (!eof())
+        {
+            m_pos += scan::space_run(m_data + m_pos, m_size - m_pos);
+            if (m_pos < m_size)
+                break;
+        }
+    }
+
+    void SaxParser::parse_value(SaxHandler& handler)
+    {
+        char c = peek();
+        if (c == 'n')
+        {
+            parse_literal("null");
+            handler.on_null();
+        }
+        else if (c == 't')
+        {
+            parse_literal("true");
+            handler.on_bool(true);
+        }
+        else if (c == 'f')
+        {
+            parse_literal("false");
+            handler.on_bool(false);
+        }
+        else if (c == '"')
+        {
+            parse_string(handler, handler.on_string_begin());
+        }
+        else if (c == '-' || std::isdigit(static_cast<unsigned char>(c)))
+        {
+            parse_number(handler);
+        }
+        else if (c == '[')
+        {
+            parse_array(handler);
+        }
+        else if (c == '{')
+        {
+            parse_object(handler);
+        }
+        else
+        {
+            error("Unexpected character while parsing value");
+        }
+    }
+
+    void SaxParser::parse_literal(std::string_view literal)
+    {
+        for (char ch : literal)
+        {
+            if (get() != ch)
+                error("Invalid literal '" + std::string(literal) + "'");
+        }
+    }
+
+    void SaxParser::parse_number(SaxHandler& handler)
+    {
+        auto take_digits = [this]() {
+            if (!std::isdigit(static_cast<unsigned char>(peek())))
+                return false;
+            while (std::isdigit(static_cast<unsigned char>(peek())))
+                m_number.push_back(get());
+            return true;
+        };
+
+        m_number.clear();
+        if (peek() == '-')
+            m_number.push_back(get());
+        if (peek() == '0')
+        {
+            m_number.push_back(get());
+        }
+        else if (!take_digits())
+        {
+            error("Invalid number");
+        }
+
+        if (peek() == '.')
+        {
+            m_number.push_back(get());
+            if (!take_digits())
+                error("Invalid number after decimal point");
+        }
+
+        if (peek() == 'e' || peek() == 'E')
+        {
+            m_number.push_back(get());
+            if (peek() == '+' || peek() == '-')
+                m_number.push_back(get());
+            if (!take_digits())
+                error("Invalid exponent");
+        }
+
+        double value{};
+        if (!scan::to_double(m_number, value))
+            error("Failed to convert number");
+        handler.on_number(value);
+    }
+
+    template <typename Emit>
+    void SaxParser::parse_escape(Emit&& emit)
+    {
+        struct Source
+        {
+            SaxParser& parser;
+            char get() { return parser.get(); }
+            char peek() { return parser.peek(); }
+            [[noreturn]] void error(const char* msg) const { parser.error(msg); }
+        } source{*this};
+
+        scan::decode_escape(source, emit);
+    }
+
+    void SaxParser::parse_string(SaxHandler& handler, bool wanted)
+    {
+        if (!match('"'))
+            error("Expected '\"' at beginning of string");
+
+        while (true)
+        {
+            if (eof())
+                error("Unterminated string");
+
+            // Непрерывный участок без кавычек и экранирований внутри текущего окна.
+            const size_t start = m_pos;
+            m_pos += scan::string_run(m_data + m_pos, m_size - m_pos);
+            if (wanted && m_pos > start)
+                handler.on_string_chunk(std::string_view(m_data + start, m_pos - start));
+            if (m_pos == m_size)
+                continue;
+
+            char c = m_data[m_pos++];
+            if (c == '"')
+                break;
+            if (eof())
+                error("Unfinished escape sequence");
+            parse_escape([&handler, wanted](std::string_view bytes) {
+                if (wanted)
+                    handler.on_string_chunk(bytes);
+            });
+        }
+        if (wanted)
+            handler.on_string_end();
+    }
+
+    void SaxParser::parse_key(SaxHandler& handler)
+    {
+        if (!match('"'))
+            error("Expected string key");
+
+        m_key.clear();
+        while (true)
+        {
+            if (eof())
+                error("Unterminated string");
+            const size_t run = scan::string_run(m_data + m_pos, m_size - m_pos);
+            m_key.append(m_data + m_pos, run);
+            m_pos += run;
+            if (m_pos == m_size)
+                continue;
+
+            if (m_data[m_pos++] == '"')
+                break;
+            if (eof())
+                error("Unfinished escape sequence");
+            parse_escape([this](std::string_view bytes) { m_key.append(bytes); });
+        }
+        handler.on_key(m_key);
+    }
+
+    void SaxParser::parse_array(SaxHandler& handler)
+    {
+        get();
+        if (++m_depth > kMaxDepth)
+            error("Nesting deeper than " + std::to_string(kMaxDepth) + " levels");
+        handler.on_array_begin();
+        skip_whitespace();
+        if (!match(']'))
+        {
+            while (true)
+            {
+                skip_whitespace();
+                parse_value(handler);
+                skip_whitespace();
+                if (match(']'))
+                    break;
+                if (!match(','))
+                    error("Expected ',' or ']'");
+            }
+        }
+        --m_depth;
+        handler.on_array_end();
+    }
+
+    void SaxParser::parse_object(SaxHandler& handler)
+    {
+        get();
+        if (++m_depth > kMaxDepth)
+            error("Nesting deeper than " + std::to_string(kMaxDepth) + " levels");
+        handler.on_object_begin();
+        skip_whitespace();
+        if (!match('}'))
+        {
+            while (true)
+            {
+                skip_whitespace();
+                if (peek() != '"')
+                    error("Expected string key");
+                parse_key(handler);
+                skip_whitespace();
+                if (!match(':'))
+                    error("Expected ':' after key");
+                skip_whitespace();
+                parse_value(handler);
+                skip_whitespace();
+                if (match('}'))
+                    break;
+                if (!match(','))
+                    error("Expected ',' or '}'");
+            }
+        }
+        --m_depth;
+        handler.on_object_end();
+    }
+
+    [[noreturn]] void SaxParser::error(const std::string& msg) const
+    {
+        size_t position = m_offset + m_pos;
+        std::ostringstream oss;
+        oss << "JSON parse error at position " << position << ": " << msg;
+        throw ParseError(oss.str(), position);
+    }
+
+} // namespace json
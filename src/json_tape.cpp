@@ -0,0 +1,27 @@
+#include "json_tape.hpp"
+
+namespace json
+{
+    void Tape::clear()
+    {
+        m_nodes.clear();
+        m_arena.reset();
+    }
+
+    std::optional<size_t> Tape::find(size_t object, std::string_view key) const
+    {
+        const TapeNode& obj = m_nodes[object];
+        if (obj.type != NodeType::Object)
+            return std::nullopt;
+        size_t i = object + 1;
+        for (std::uint32_t pair = 0; pair < obj.count; ++pair)
+        {
+            size_t value = i + 1;
+            if (m_nodes[i].str == key)
+                return value;
+            i = m_nodes[value].end;
+        }
+        return std::nullopt;
+    }
+
+} // namespace json
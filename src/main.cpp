@@ -1,52 +1,803 @@
+#include "approx.hpp"
+#include "batch.hpp"
 #include "cli.hpp"
+#include "compression.hpp"
+#include "external_count.hpp"
+#include "file_input.hpp"
 #include "json_parser.hpp"
+#include "json_sax.hpp"
+#include "json_tape.hpp"
+#include "ndjson.hpp"
+#include "ngram.hpp"
+#include "pack.hpp"
+#include "partial.hpp"
+#include "profile.hpp"
+#include "report_writer.hpp"
+#include "server.hpp"
+#include "snapshot.hpp"
 #include "text_analyzer.hpp"
 
+#include <atomic>
 #include <chrono>
+#include <csignal>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <filesystem>
+#include <optional>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 namespace
 {
-    std::string read_file(const std::string& path)
+    // Запрос подтверждения перезаписи; --force отвечает «да» без вопроса,
+    // чтобы не блокировать запуски без терминала.
+    void confirm_overwrite(const CliOptions& opts, const std::string& path)
+    {
+        if (opts.force || !std::filesystem::exists(path))
+            return;
+
+        std::cout << "Файл \"" << path << "\" уже существует. Перезаписать? [y/n]: ";
+        char answer = 'n';
+        if (!(std::cin >> answer))
+        {
+            throw std::runtime_error("Не удалось прочитать ответ пользователя при подтверждении перезаписи "
+                                     "(для запуска без подтверждения используйте --force).");
+        }
+        if (answer != 'y' && answer != 'Y')
+        {
+            throw std::runtime_error("Перезапись файла отменена пользователем.");
+        }
+    }
+
+    StopwordSet load_stopwords(const CliOptions& opts)
+    {
+        StopwordSet stopwords;
+        if (opts.stops_path)
+        {
+            profile::ScopedTimer timer(profile::Stage::StopwordLoad);
+            stopwords = load_stopword_file(*opts.stops_path);
+            profile::set(profile::Counter::Stopwords, stopwords.size());
+        }
+        if (opts.save_stops_path)
+        {
+            stopwords.save(*opts.save_stops_path);
+            std::cout << "Стоп-слова (" << stopwords.size() << ") сохранены в двоичный файл: "
+                      << *opts.save_stops_path << std::endl;
+        }
+        return stopwords;
+    }
+
+    NgramOptions ngram_options(const CliOptions& opts)
+    {
+        NgramOptions options;
+        options.n = opts.ngram;
+        options.skip_stop_only = !opts.keep_stop_ngrams;
+        return options;
+    }
+
+    std::optional<ApproxOptions> approx_options(const CliOptions& opts)
     {
-        std::ifstream in(path, std::ios::binary);
-        if (!in)
+        if (!opts.approx)
+            return std::nullopt;
+        ApproxOptions options;
+        options.memory_budget = opts.approx_memory_mb << 20;
+        return options;
+    }
+
+    // Внешний подсчёт для --mem-limit; без него — nullptr.
+    std::unique_ptr<ExternalCounter> external_counter(const CliOptions& opts)
+    {
+        if (!opts.mem_limit_mb)
+            return nullptr;
+        return std::make_unique<ExternalCounter>(opts.mem_limit_mb << 20, opts.spill_dir.value_or(""));
+    }
+
+    std::string_view trim_leading_newline(std::string_view text)
+    {
+        if (!text.empty() && text.front() == '\n')
+            text.remove_prefix(1);
+        return text;
+    }
+
+    // Вывод отчёта: текст до и после таблиц (сводка, время этапов) окружает
+    // текстовый отчёт; у машиночитаемых форматов в файл или stdout идёт только
+    // сам отчёт, а сопровождающий текст — в консоль (в stderr, если отчёт в stdout).
+    void emit(const CliOptions& opts, const TextStats& stats, const std::string& before, const std::string& after)
+    {
+        profile::ScopedTimer timer(profile::Stage::OutputWrite);
+        const ReportFormat format = parse_report_format(opts.format);
+        const bool text = format == ReportFormat::Text;
+
+        if (opts.output_path)
+        {
+            confirm_overwrite(opts, *opts.output_path);
+            FdWriter out(*opts.output_path);
+            if (text)
+                out.write(before);
+            write_report(out, stats, opts.top_n, format);
+            if (text)
+                out.write(after);
+            out.close();
+            if (!text)
+                std::cout << before << trim_leading_newline(after);
+            std::cout << "Отчёт сохранён в файл: " << *opts.output_path << std::endl;
+        }
+        else
         {
-            throw std::runtime_error("Не удалось открыть файл: " + path);
+            // Всё, что уже лежит в буфере std::cout, должно выйти раньше отчёта.
+            std::cout.flush();
+            FdWriter out;
+            if (text)
+                out.write(before);
+            write_report(out, stats, opts.top_n, format);
+            if (text)
+            {
+                out.write(after);
+                out.put('\n');
+            }
+            out.close();
+            if (!text)
+                std::cerr << before << trim_leading_newline(after);
         }
-        std::ostringstream ss;
-        ss << in.rdbuf();
-        return ss.str();
     }
 
-    void write_file_with_confirm(const std::string& path, const std::string& content)
+    // Итоговые счётчики профиля берутся из готовой статистики.
+    void profile_totals(const TextStats& stats)
+    {
+        profile::set(profile::Counter::Tokens, stats.total_words);
+        profile::set(profile::Counter::Sentences, stats.total_sentences);
+        profile::set(profile::Counter::UniqueWords, stats.unique_words);
+    }
+
+    std::vector<std::string> collect_batch_files(const CliOptions& opts)
     {
+        std::vector<std::string> files;
+        if (opts.input_dir)
+        {
+            files = opts.input_glob ? list_directory(*opts.input_dir, *opts.input_glob)
+                                    : list_json_files(*opts.input_dir);
+        }
+        else if (opts.input_glob)
+        {
+            files = expand_glob(*opts.input_glob);
+        }
+        if (opts.file_list)
+        {
+            std::vector<std::string> listed = read_file_list(*opts.file_list);
+            files.insert(files.end(), listed.begin(), listed.end());
+        }
+        return files;
+    }
+
+    // Инкрементальное обновление снапшота корпуса: перечитываются только
+    // новые и изменённые файлы, вклад удалённых вычитается.
+    int run_update(const CliOptions& opts, const std::vector<std::string>& files)
+    {
+        namespace fs = std::filesystem;
+
+        if (opts.approx)
+        {
+            std::cerr << "Режим --approx не сочетается с --update: снапшот хранит точные частоты." << std::endl;
+            return 1;
+        }
+
+        StopwordSet stopwords = load_stopwords(opts);
+        const std::string& path = *opts.update_path;
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        CorpusSnapshot snapshot;
+        const bool existed = fs::exists(path);
+        if (existed)
+            snapshot = CorpusSnapshot::load(path);
+        auto t_loaded = std::chrono::high_resolution_clock::now();
+        CorpusSnapshot::UpdateSummary summary = snapshot.update(files, stopwords, opts.threads);
+        auto t_updated = std::chrono::high_resolution_clock::now();
+        snapshot.save(path);
+        auto t_saved = std::chrono::high_resolution_clock::now();
+        BatchResult result = snapshot.result();
+
+        auto ms = [](auto from, auto to) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+        };
+
+        std::ostringstream before;
+        before << format_batch_summary(result) << "\n";
+        before << "Снапшот " << path << (existed ? " обновлён" : " создан") << ": добавлено " << summary.added
+               << ", изменено " << summary.changed << ", удалено " << summary.removed << ", без изменений "
+               << summary.unchanged << " (из них только с новым временем изменения: " << summary.touched << ")\n\n";
+        std::ostringstream after;
+        after << "\nВремя загрузки снапшота: " << ms(t_start, t_loaded) << " мс, обновления: "
+              << ms(t_loaded, t_updated) << " мс, сохранения: " << ms(t_updated, t_saved) << " мс\n";
+
+        profile_totals(result.stats);
+        emit(opts, result.stats, before.str(), after.str());
+        return 0;
+    }
+
+    // Анализ упакованного корпуса: пакет отображается в память один раз,
+    // рабочие потоки берут непрерывные диапазоны документов.
+    int run_pack(const CliOptions& opts)
+    {
+        if (opts.update_path || opts.input_dir || opts.input_glob || opts.file_list)
+        {
+            std::cerr << "--pack не сочетается с --update, --input-dir, --glob и --file-list." << std::endl;
+            return 1;
+        }
+
+        StopwordSet stopwords = load_stopwords(opts);
+
+        std::unique_ptr<ExternalCounter> external = external_counter(opts);
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        PackReader pack(*opts.pack_path);
+        auto t_opened = std::chrono::high_resolution_clock::now();
+        BatchResult result = analyze_pack(pack, stopwords, opts.threads, approx_options(opts), external.get());
+        if (external)
+            external->finish(result.stats, opts.top_n);
+        auto t_end = std::chrono::high_resolution_clock::now();
+
+        auto open_us = std::chrono::duration_cast<std::chrono::microseconds>(t_opened - t_start).count();
+        auto total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_opened).count();
+
+        std::ostringstream after;
+        after << "\nВремя пакетной обработки (разбор, анализ): " << total_ms << " мс\n";
+        after << "Время открытия пакета (" << pack.size_bytes() << " байт, "
+              << (pack.has_text() ? "с извлечённым текстом" : "без извлечённого текста") << "): " << open_us
+              << " мкс\n";
+        if (external)
+            after << format_external_summary(*external);
+
+        profile_totals(result.stats);
+        emit(opts, result.stats, format_batch_summary(result) + "\n", after.str());
+        return result.files_ok > 0 ? 0 : 1;
+    }
+
+    // Анализ файлов пакетного режима в threads потоках, с упреждающим чтением или без.
+    BatchResult analyze_batch(const CliOptions& opts, const std::vector<std::string>& files,
+                              const StopwordSet& stopwords, size_t threads, ExternalCounter* external = nullptr)
+    {
+        if (!opts.read_ahead)
+            return analyze_files(files, stopwords, threads, approx_options(opts), external);
+        ReadAheadOptions read_ahead;
+        read_ahead.queue_depth = opts.read_ahead;
+        read_ahead.max_inflight_bytes = opts.read_ahead_memory_mb << 20;
+        return analyze_files(files, stopwords, threads, read_ahead, approx_options(opts), external);
+    }
+
+    // Локальный map/reduce: процессы map (fork) анализируют шарды набора и пишут
+    // частичные результаты во временный каталог, родитель сливает их в отчёт.
+    int run_processes(const CliOptions& opts, const std::vector<std::string>& files)
+    {
+#if defined(_WIN32)
+        (void)files;
+        std::cerr << "--processes поддерживается только в POSIX-системах (нужен fork)." << std::endl;
+        return 1;
+#else
         namespace fs = std::filesystem;
 
-        bool exists = fs::exists(path);
-        if (exists)
+        if (opts.approx)
         {
-            std::cout << "Файл \"" << path << "\" уже существует. Перезаписать? [y/n]: ";
-            char answer = 'n';
-            if (!(std::cin >> answer))
+            std::cerr << "Режим --approx не сочетается с --processes: частичные результаты хранят точные частоты."
+                      << std::endl;
+            return 1;
+        }
+
+        StopwordSet stopwords = load_stopwords(opts);
+        const size_t count = opts.processes;
+        const size_t threads =
+            opts.threads ? opts.threads : std::max<size_t>(1, std::thread::hardware_concurrency() / count);
+        const fs::path dir = fs::temp_directory_path() / ("textfreq_map_" + std::to_string(::getpid()));
+        fs::create_directories(dir);
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        std::vector<std::string> paths;
+        std::vector<pid_t> children;
+        // Буферы потоков вывода не должны продублироваться в дочерних процессах.
+        std::cout.flush();
+        std::cerr.flush();
+        for (size_t i = 0; i < count; ++i)
+        {
+            paths.push_back((dir / ("partial_" + std::to_string(i) + ".bin")).string());
+            const pid_t pid = ::fork();
+            if (pid < 0)
+            {
+                std::cerr << "Не удалось запустить процесс map " << i << "." << std::endl;
+                break;
+            }
+            if (pid == 0)
+            {
+                int code = 0;
+                try
+                {
+                    const ShardSpec shard{i, count};
+                    BatchResult result = analyze_batch(opts, select_shard(files, shard), stopwords, threads);
+                    write_partial(paths.back(), result, shard, stopwords);
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Ошибка процесса map " << i << ": " << e.what() << std::endl;
+                    code = 1;
+                }
+                ::_exit(code);
+            }
+            children.push_back(pid);
+        }
+
+        bool ok = children.size() == count;
+        for (pid_t pid : children)
+        {
+            int status = 0;
+            while (::waitpid(pid, &status, 0) < 0 && errno == EINTR)
             {
-                throw std::runtime_error("Не удалось прочитать ответ пользователя при подтверждении перезаписи.");
             }
-            if (answer != 'y' && answer != 'Y')
+            ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        if (!ok)
+        {
+            fs::remove_all(dir);
+            std::cerr << "Не все процессы map завершились успешно." << std::endl;
+            return 1;
+        }
+        auto t_mapped = std::chrono::high_resolution_clock::now();
+        BatchResult result = reduce_partials(paths);
+        auto t_end = std::chrono::high_resolution_clock::now();
+        fs::remove_all(dir);
+
+        auto ms = [](auto from, auto to) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+        };
+        std::ostringstream after;
+        after << "\nВремя пакетной обработки (процессов map: " << count << ", потоков в каждом: " << threads
+              << "): " << ms(t_start, t_mapped) << " мс, reduce: " << ms(t_mapped, t_end) << " мс\n";
+
+        profile_totals(result.stats);
+        emit(opts, result.stats, format_batch_summary(result) + "\n", after.str());
+        return result.files_ok > 0 ? 0 : 1;
+#endif
+    }
+
+    int run_batch(const CliOptions& opts)
+    {
+        if (opts.processes && (opts.pack_path || opts.update_path))
+        {
+            std::cerr << "--processes не сочетается с --pack и --update." << std::endl;
+            return 1;
+        }
+        if (opts.pack_path)
+        {
+            return run_pack(opts);
+        }
+        std::vector<std::string> files = collect_batch_files(opts);
+        if (opts.update_path)
+        {
+            return run_update(opts, files);
+        }
+        if (files.empty())
+        {
+            std::cerr << "Не найдено ни одного входного файла для пакетной обработки." << std::endl;
+            return 1;
+        }
+        if (opts.processes)
+        {
+            return run_processes(opts, files);
+        }
+
+        StopwordSet stopwords = load_stopwords(opts);
+        std::unique_ptr<ExternalCounter> external = external_counter(opts);
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        BatchResult result = analyze_batch(opts, files, stopwords, opts.threads, external.get());
+        if (external)
+            external->finish(result.stats, opts.top_n);
+        auto t_end = std::chrono::high_resolution_clock::now();
+
+        auto total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count();
+
+        std::ostringstream after;
+        after << "\nВремя пакетной обработки (чтение, парсинг, анализ): " << total_ms << " мс\n";
+        if (opts.read_ahead)
+        {
+            after << "Упреждающее чтение (" << result.read_ahead_backend << ", очередь " << opts.read_ahead
+                  << ", предел " << opts.read_ahead_memory_mb << " МБ): ожидание готовых файлов ("
+                  << result.bytes_read << " байт, по всем потокам) " << result.read_ns / 1000 << " мкс\n";
+        }
+        else
+        {
+            after << "Суммарное время чтения файлов (" << result.bytes_read << " байт, по всем потокам): "
+                  << result.read_ns / 1000 << " мкс\n";
+        }
+        if (external)
+            after << format_external_summary(*external);
+
+        profile_totals(result.stats);
+        emit(opts, result.stats, format_batch_summary(result) + "\n", after.str());
+        return result.files_ok > 0 ? 0 : 1;
+    }
+
+    // map: анализ шарда набора файлов в частичный результат (partial.hpp).
+    int run_map(const CliOptions& opts)
+    {
+        if (!opts.shard)
+        {
+            std::cerr << "Для map нужен --shard i/N." << std::endl;
+            return 1;
+        }
+        if (opts.pack_path || opts.update_path || opts.approx || opts.processes || opts.ngram)
+        {
+            std::cerr << "map не сочетается с --pack, --update, --approx, --processes и --ngram." << std::endl;
+            return 1;
+        }
+        if (!opts.input_dir && !opts.input_glob && !opts.file_list)
+        {
+            std::cerr << "Для map нужен набор файлов: --input-dir, --glob или --file-list." << std::endl;
+            return 1;
+        }
+
+        const ShardSpec shard = parse_shard(*opts.shard);
+        const std::vector<std::string> files = collect_batch_files(opts);
+        const std::vector<std::string> selected = select_shard(files, shard);
+        StopwordSet stopwords = load_stopwords(opts);
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        BatchResult result = analyze_batch(opts, selected, stopwords, opts.threads);
+        auto t_end = std::chrono::high_resolution_clock::now();
+
+        const std::string path = opts.output_path.value_or("partial_" + std::to_string(shard.index) + ".bin");
+        confirm_overwrite(opts, path);
+        write_partial(path, result, shard, stopwords);
+
+        std::cout << "Шард " << shard.index << "/" << shard.count << ": файлов " << selected.size() << " из "
+                  << files.size() << " (успешно " << result.files_ok << ", с ошибками " << result.failed.size()
+                  << "), время анализа "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << " мс\n";
+        std::cout << "Частичный результат сохранён в файл: " << path << std::endl;
+        profile_totals(result.stats);
+        return 0;
+    }
+
+    // reduce: слияние частичных результатов всех шардов в итоговый отчёт.
+    int run_reduce(const CliOptions& opts)
+    {
+        if (opts.partials.empty())
+        {
+            std::cerr << "Для reduce нужны файлы частичных результатов (partial_*.bin)." << std::endl;
+            return 1;
+        }
+        // Шаблоны раскрываются и здесь: не каждая оболочка делает это сама.
+        std::vector<std::string> paths;
+        for (const std::string& partial : opts.partials)
+        {
+            if (partial.find_first_of("*?") == std::string::npos)
             {
-                throw std::runtime_error("Перезапись файла отменена пользователем.");
+                paths.push_back(partial);
+                continue;
             }
+            std::vector<std::string> expanded = expand_glob(partial);
+            paths.insert(paths.end(), expanded.begin(), expanded.end());
         }
 
-        std::ofstream out(path, std::ios::binary);
-        if (!out)
+        auto t_start = std::chrono::high_resolution_clock::now();
+        BatchResult result = reduce_partials(paths);
+        auto t_end = std::chrono::high_resolution_clock::now();
+
+        std::ostringstream after;
+        after << "\nВремя слияния частичных результатов (" << paths.size() << " файлов): "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count() << " мс\n";
+
+        profile_totals(result.stats);
+        emit(opts, result.stats, format_batch_summary(result) + "\n", after.str());
+        return result.files_ok > 0 ? 0 : 1;
+    }
+
+    // Поток --input: файл (сжатый распаковывается на лету) или стандартный ввод ("-").
+    std::istream& open_input(const CliOptions& opts, std::unique_ptr<std::istream>& file)
+    {
+        if (*opts.input_path == "-")
         {
-            throw std::runtime_error("Не удалось открыть файл для записи: " + path);
+            return std::cin;
         }
-        out << content;
+        file = open_input_stream(*opts.input_path);
+        return *file;
+    }
+
+    int run_stream(const CliOptions& opts)
+    {
+        std::unique_ptr<std::istream> file;
+        std::istream& in = open_input(opts, file);
+
+        StopwordSet stopwords = load_stopwords(opts);
+        std::unique_ptr<ExternalCounter> external = external_counter(opts);
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        TextStats stats;
+        size_t blocks = 0;
+        json::SaxParser parser(in);
+        if (opts.ngram)
+        {
+            NgramAnalyzer analyzer(stopwords, ngram_options(opts));
+            TextBlockExtractor extractor(analyzer);
+            {
+                profile::ScopedTimer timer(profile::Stage::JsonParse);
+                parser.parse(extractor);
+            }
+            stats = analyzer.finish(opts.top_n);
+            blocks = extractor.blocks();
+        }
+        else if (auto approx = approx_options(opts))
+        {
+            ApproxAnalyzer analyzer(stopwords, *approx);
+            TextBlockExtractor extractor(analyzer);
+            {
+                profile::ScopedTimer timer(profile::Stage::JsonParse);
+                parser.parse(extractor);
+            }
+            stats = analyzer.finish();
+            blocks = extractor.blocks();
+        }
+        else
+        {
+            StreamingAnalyzer analyzer(stopwords);
+            if (external)
+                analyzer.spill_to(*external, external->memory_limit());
+            TextBlockExtractor extractor(analyzer);
+            {
+                profile::ScopedTimer timer(profile::Stage::JsonParse);
+                parser.parse(extractor);
+            }
+            stats = analyzer.finish();
+            blocks = extractor.blocks();
+        }
+        if (external)
+            external->finish(stats, opts.top_n);
+        profile::add(profile::Counter::Documents, 1);
+        profile::add(profile::Counter::BytesRead, parser.bytes_read());
+        profile::add(profile::Counter::Blocks, blocks);
+        auto t_end = std::chrono::high_resolution_clock::now();
+
+        if (blocks == 0)
+        {
+            std::cerr << "Во входном JSON не найден текст (\"text\" или массив параграфов)." << std::endl;
+            return 1;
+        }
+
+        auto total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count();
+
+        std::ostringstream after;
+        after << "\nВремя потокового разбора и анализа: " << total_ms << " мс\n";
+        if (external)
+            after << format_external_summary(*external);
+
+        profile_totals(stats);
+        emit(opts, stats, "", after.str());
+        return 0;
+    }
+
+    std::atomic<bool> g_stop_input{false};
+
+    void stop_input(int)
+    {
+        g_stop_input.store(true);
+    }
+
+    // Поток NDJSON (--ndjson): документы по одному на строку, каждый разбирается
+    // и анализируется сразу; ошибочные строки считаются и пропускаются. SIGINT или
+    // SIGTERM завершают чтение бесконечного потока — отчёт строится по прочитанному.
+    int run_ndjson(const CliOptions& opts)
+    {
+        std::unique_ptr<std::istream> file;
+        std::istream& in = open_input(opts, file);
+        StopwordSet stopwords = load_stopwords(opts);
+        std::unique_ptr<ExternalCounter> external = external_counter(opts);
+
+#if defined(_WIN32)
+        std::signal(SIGINT, stop_input);
+        std::signal(SIGTERM, stop_input);
+#else
+        // Без SA_RESTART: сигнал прерывает и чтение, ждущее новых строк.
+        struct sigaction action{};
+        action.sa_handler = stop_input;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+#endif
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        TextStats stats;
+        NdjsonSummary summary;
+        if (opts.ngram)
+        {
+            NgramAnalyzer analyzer(stopwords, ngram_options(opts));
+            summary = analyze_ndjson(in, analyzer, &g_stop_input);
+            stats = analyzer.finish(opts.top_n);
+        }
+        else if (auto approx = approx_options(opts))
+        {
+            ApproxAnalyzer analyzer(stopwords, *approx);
+            summary = analyze_ndjson(in, analyzer, &g_stop_input);
+            stats = analyzer.finish();
+        }
+        else
+        {
+            StreamingAnalyzer analyzer(stopwords);
+            if (external)
+                analyzer.spill_to(*external, external->memory_limit());
+            summary = analyze_ndjson(in, analyzer, &g_stop_input);
+            stats = analyzer.finish();
+        }
+        if (external)
+            external->finish(stats, opts.top_n);
+        auto t_end = std::chrono::high_resolution_clock::now();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+
+        if (summary.records == 0)
+        {
+            std::cerr << format_ndjson_summary(summary)
+                      << "В потоке NDJSON нет ни одного документа с текстом." << std::endl;
+            return 1;
+        }
+
+        auto total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count();
+        std::ostringstream after;
+        after << "\nВремя чтения, разбора и анализа потока: " << total_ms << " мс\n";
+        if (external)
+            after << format_external_summary(*external);
+
+        profile_totals(stats);
+        emit(opts, stats, format_ndjson_summary(summary) + "\n", after.str());
+        return 0;
+    }
+
+    Server* g_server = nullptr;
+
+    void stop_server(int)
+    {
+        if (g_server)
+            g_server->stop();
+    }
+
+    // Долгоживущий режим: стоп-слова и буферы потоков остаются в памяти между запросами.
+    int run_serve(const CliOptions& opts)
+    {
+        if (opts.input_path || opts.batch_mode() || opts.approx || opts.output_path)
+        {
+            std::cerr << "--serve не сочетается с --input, пакетным режимом, --approx и --output." << std::endl;
+            return 1;
+        }
+
+        Server::Options options;
+        options.threads = opts.threads;
+        options.top_n = opts.top_n;
+        options.format = parse_report_format(opts.format);
+        Server server(load_stopwords(opts), options);
+        for (const std::string& item : opts.serve_stops)
+        {
+            const size_t eq = item.find('=');
+            if (eq == 0 || eq == std::string::npos || eq + 1 == item.size())
+            {
+                std::cerr << "--serve-stops ожидает NAME=PATH: " << item << std::endl;
+                return 1;
+            }
+            server.add_stopwords(item.substr(0, eq), load_stopword_file(item.substr(eq + 1)));
+        }
+
+        if (*opts.serve_path == "-")
+        {
+            server.serve_stream(0, 1);
+        }
+        else
+        {
+            g_server = &server;
+            std::signal(SIGINT, stop_server);
+            std::signal(SIGTERM, stop_server);
+            std::cerr << "Сервер слушает " << *opts.serve_path << std::endl;
+            server.serve_unix(*opts.serve_path);
+            g_server = nullptr;
+        }
+        std::cerr << server.format_latency();
+        return 0;
+    }
+
+    // Один документ: разбор в ленту и параллельный анализ блоков.
+    int run_single(const CliOptions& opts)
+    {
+        auto t_start_read = std::chrono::high_resolution_clock::now();
+        InputFile input;
+        {
+            profile::ScopedTimer timer(profile::Stage::FileRead);
+            input.open(*opts.input_path);
+        }
+        auto t_end_read = std::chrono::high_resolution_clock::now();
+
+        auto t_start_parse = std::chrono::high_resolution_clock::now();
+        json::Tape tape;
+        {
+            profile::ScopedTimer timer(profile::Stage::JsonParse);
+            json::Parser parser(input.view());
+            parser.parse(tape);
+        }
+        auto t_end_parse = std::chrono::high_resolution_clock::now();
+
+        std::vector<std::string_view> blocks;
+        {
+            profile::ScopedTimer timer(profile::Stage::BlockExtract);
+            blocks = extract_text_blocks(tape);
+        }
+        profile::add(profile::Counter::Documents, 1);
+        profile::add(profile::Counter::BytesRead, input.view().size());
+        profile::add(profile::Counter::Blocks, blocks.size());
+        if (blocks.empty())
+        {
+            std::cerr << "Во входном JSON не найден текст (\"text\" или массив параграфов)." << std::endl;
+            return 1;
+        }
+
+        StopwordSet stopwords = load_stopwords(opts);
+
+        auto t_start_analyze = std::chrono::high_resolution_clock::now();
+        TextStats stats;
+        std::string external_summary;
+        if (opts.ngram)
+        {
+            // N-граммы не режутся на куски по потокам: куски рвали бы n-граммы на стыках.
+            NgramAnalyzer analyzer(stopwords, ngram_options(opts));
+            for (std::string_view block : blocks)
+            {
+                analyzer.feed(block);
+                analyzer.end_block();
+            }
+            stats = analyzer.finish(opts.top_n);
+        }
+        else if (auto approx = approx_options(opts))
+        {
+            ApproxAnalyzer analyzer(stopwords, *approx);
+            for (std::string_view block : blocks)
+            {
+                analyzer.feed(block);
+                analyzer.end_block();
+            }
+            stats = analyzer.finish();
+        }
+        else if (std::unique_ptr<ExternalCounter> counter = external_counter(opts))
+        {
+            // Таблица одна на весь бюджет, поэтому документ анализируется в одном потоке.
+            StreamingAnalyzer analyzer(stopwords);
+            analyzer.spill_to(*counter, counter->memory_limit());
+            for (std::string_view block : blocks)
+            {
+                analyzer.feed(block);
+                analyzer.end_block();
+            }
+            stats = analyzer.finish();
+            counter->finish(stats, opts.top_n);
+            external_summary = format_external_summary(*counter);
+        }
+        else
+        {
+            stats = analyze_text_parallel(blocks, stopwords, opts.threads);
+        }
+        auto t_end_analyze = std::chrono::high_resolution_clock::now();
+
+        auto read_us = std::chrono::duration_cast<std::chrono::microseconds>(t_end_read - t_start_read).count();
+        auto parse_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end_parse - t_start_parse).count();
+        auto analyze_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end_analyze - t_start_analyze).count();
+
+        std::ostringstream after;
+        after << "\nВремя чтения файла (" << input.view().size() << " байт, "
+              << (input.mapped() ? "mmap" : "read") << "): " << read_us << " мкс\n";
+        after << "Время парсинга JSON: " << parse_ms << " мс\n";
+        after << "Время анализа текста: " << analyze_ms << " мс\n";
+        after << external_summary;
+
+        profile_totals(stats);
+        emit(opts, stats, "", after.str());
+        return 0;
     }
 }
 
@@ -56,7 +807,14 @@ int main(int argc, char** argv)
     {
         CliOptions opts = parse_arguments(argc, argv);
 
-        if (opts.show_help || !opts.input_path)
+        if (opts.save_stops_path && opts.command.empty() && !opts.input_path && !opts.batch_mode())
+        {
+            load_stopwords(opts);
+            return 0;
+        }
+
+        if (opts.show_help ||
+            (opts.command.empty() && !opts.input_path && !opts.batch_mode() && !opts.serve_path))
         {
             std::cout << make_help_text() << std::endl;
             return 0;
@@ -68,54 +826,96 @@ int main(int argc, char** argv)
             return 1;
         }
 
-        std::string input_json = read_file(*opts.input_path);
+        if (opts.ngram && (opts.batch_mode() || opts.serve_path || opts.approx || !opts.command.empty()))
+        {
+            std::cerr << "--ngram поддерживается только для --input (в том числе с --stream), без --approx."
+                      << std::endl;
+            return 1;
+        }
 
-        auto t_start_parse = std::chrono::high_resolution_clock::now();
-        json::Parser parser(input_json);
-        json::Value root = parser.parse();
-        auto t_end_parse = std::chrono::high_resolution_clock::now();
+        if (opts.ndjson && (!opts.input_path || opts.batch_mode() || opts.stream || !opts.command.empty()))
+        {
+            std::cerr << "--ndjson читает только --input (файл или -), без --stream и пакетного режима." << std::endl;
+            return 1;
+        }
 
-        std::vector<std::string> blocks = extract_text_blocks(root);
-        if (blocks.empty())
+        if (opts.mem_limit_mb && (opts.approx || opts.ngram || opts.update_path || opts.processes ||
+                                  opts.serve_path || !opts.command.empty()))
         {
-            std::cerr << "Во входном JSON не найден текст (\"text\" или массив параграфов)." << std::endl;
+            std::cerr << "--mem-limit не сочетается с --approx, --ngram, --update, --processes, map/reduce и --serve."
+                      << std::endl;
             return 1;
         }
 
-        std::vector<std::string> stopwords;
-        if (opts.stops_path)
+        if (opts.mem_limit_mb && parse_report_format(opts.format) != ReportFormat::Text)
         {
-            std::string stops_json = read_file(*opts.stops_path);
-            json::Parser sp(stops_json);
-            json::Value sroot = sp.parse();
-            stopwords = extract_stopwords(sroot);
+            std::cerr << "С --mem-limit выводится только текстовый отчёт: машиночитаемые форматы содержат "
+                         "весь словарь, который не держится в памяти."
+                      << std::endl;
+            return 1;
         }
 
-        auto t_start_analyze = std::chrono::high_resolution_clock::now();
-        TextStats stats = analyze_text(blocks, stopwords);
-        auto t_end_analyze = std::chrono::high_resolution_clock::now();
+        if (opts.spill_dir && !opts.mem_limit_mb)
+        {
+            std::cerr << "--spill-dir используется только с --mem-limit." << std::endl;
+            return 1;
+        }
 
-        std::string report = format_report(stats, opts.top_n);
+        if (!opts.serve_stops.empty() && !opts.serve_path)
+        {
+            std::cerr << "--serve-stops используется только с --serve." << std::endl;
+            return 1;
+        }
 
-        auto parse_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end_parse - t_start_parse).count();
-        auto analyze_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end_analyze - t_start_analyze).count();
+        if (opts.shard && opts.command != "map")
+        {
+            std::cerr << "--shard используется только с подкомандой map." << std::endl;
+            return 1;
+        }
 
-        std::ostringstream with_timing;
-        with_timing << report << "\n";
-        with_timing << "Время парсинга JSON: " << parse_ms << " мс\n";
-        with_timing << "Время анализа текста: " << analyze_ms << " мс\n";
+        if (opts.serve_path)
+        {
+            return run_serve(opts);
+        }
 
-        if (opts.output_path)
+        if (opts.profile)
         {
-            write_file_with_confirm(*opts.output_path, with_timing.str());
-            std::cout << "Отчёт сохранён в файл: " << *opts.output_path << std::endl;
+            profile::enable();
+        }
+        auto t_start = std::chrono::steady_clock::now();
+        int code = 0;
+        if (opts.command == "map")
+        {
+            code = run_map(opts);
+        }
+        else if (opts.command == "reduce")
+        {
+            code = run_reduce(opts);
+        }
+        else if (opts.batch_mode())
+        {
+            code = run_batch(opts);
+        }
+        else if (opts.ndjson)
+        {
+            code = run_ndjson(opts);
+        }
+        else if (opts.stream || *opts.input_path == "-")
+        {
+            code = run_stream(opts);
         }
         else
         {
-            std::cout << with_timing.str() << std::endl;
+            code = run_single(opts);
         }
-
-        return 0;
+        if (opts.profile)
+        {
+            auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t_start).count();
+            std::cerr << (opts.profile_format == "json" ? profile::format_json(wall_ns)
+                                                        : profile::format_table(wall_ns));
+        }
+        return code;
     }
     catch (const json::ParseError& e)
     {
@@ -0,0 +1,173 @@
+#include "ndjson.hpp"
+#include "json_parser.hpp"
+#include "profile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+LineReader::LineReader(std::istream& in, size_t max_line, size_t window)
+    : m_in(in)
+    , m_max_line(std::max<size_t>(max_line, 1))
+    , m_window(std::max<size_t>(window, 1))
+{
+}
+
+void LineReader::refill()
+{
+    // Незавершённая строка переезжает в начало; места всегда хватает на окно.
+    const size_t pending = m_end - m_begin;
+    if (m_begin != 0 && pending != 0)
+        std::memmove(m_buffer.get(), m_buffer.get() + m_begin, pending);
+    m_begin = 0;
+    m_end = pending;
+    if (m_capacity < pending + m_window)
+    {
+        const size_t capacity = std::max(pending + m_window, m_capacity * 2);
+        std::unique_ptr<char[]> grown(new char[capacity]);
+        if (pending != 0)
+            std::memcpy(grown.get(), m_buffer.get(), pending);
+        m_buffer = std::move(grown);
+        m_capacity = capacity;
+    }
+
+    m_in.read(m_buffer.get() + m_end, static_cast<std::streamsize>(m_window));
+    const size_t got = static_cast<size_t>(m_in.gcount());
+    m_end += got;
+    m_bytes += got;
+    if (got == 0 || !m_in)
+        m_eof = true;
+}
+
+bool LineReader::next(std::string_view& line, bool may_read)
+{
+    for (;;)
+    {
+        const char* begin = m_buffer.get() + m_begin;
+        const size_t available = m_end - m_begin;
+        const void* newline = available ? std::memchr(begin, '\n', available) : nullptr;
+        // Вход кончился посреди пропускаемой длинной строки: она всё равно
+        // отдаётся (как oversized), чтобы попасть в счёт строк и ошибок.
+        if (newline || (m_eof && (available != 0 || m_skipping)))
+        {
+            const char* end = newline ? static_cast<const char*>(newline) : begin + available;
+            m_begin += static_cast<size_t>(end - begin) + (newline ? 1 : 0);
+            ++m_line;
+            m_oversized = m_skipping || static_cast<size_t>(end - begin) > m_max_line;
+            m_skipping = false;
+            if (m_oversized)
+            {
+                line = {};
+                return true;
+            }
+            if (end != begin && end[-1] == '\r')
+                --end;
+            line = std::string_view(begin, static_cast<size_t>(end - begin));
+            return true;
+        }
+        if (m_eof || !may_read)
+            return false;
+
+        // Строка без конца длиннее предела: копить её дальше незачем.
+        if (available > m_max_line)
+        {
+            m_skipping = true;
+            m_begin = m_end;
+        }
+        refill();
+    }
+}
+
+NdjsonSummary analyze_ndjson(std::istream& in, TextSink& sink, const std::atomic<bool>* stop, size_t max_line)
+{
+    NdjsonSummary summary;
+    LineReader reader(in, max_line);
+    json::Tape tape;
+    std::vector<std::string_view> blocks;
+    size_t fed_blocks = 0;
+
+    auto fail = [&summary](size_t line, std::string message) {
+        ++summary.errors;
+        if (summary.first_errors.size() < NdjsonSummary::kReportedErrors)
+            summary.first_errors.push_back({line, std::move(message)});
+    };
+
+    std::string_view line;
+    for (;;)
+    {
+        {
+            // После stop дочитываются только строки, уже лежащие в буфере.
+            profile::ScopedTimer timer(profile::Stage::FileRead);
+            if (!reader.next(line, !(stop && stop->load(std::memory_order_relaxed))))
+                break;
+        }
+        const size_t number = reader.line_number();
+        if (reader.oversized())
+        {
+            fail(number, "строка длиннее " + std::to_string(max_line) + " байт");
+            continue;
+        }
+        if (line.find_first_not_of(" \t") == std::string_view::npos)
+        {
+            ++summary.empty;
+            continue;
+        }
+        try
+        {
+            {
+                profile::ScopedTimer timer(profile::Stage::JsonParse);
+                json::Parser parser(line);
+                parser.parse(tape);
+            }
+            {
+                profile::ScopedTimer timer(profile::Stage::BlockExtract);
+                blocks = extract_text_blocks(tape);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            fail(number, e.what());
+            continue;
+        }
+        if (blocks.empty())
+        {
+            fail(number, "не найден текст (\"text\" или массив параграфов)");
+            continue;
+        }
+        for (std::string_view block : blocks)
+        {
+            sink.feed(block);
+            sink.end_block();
+        }
+        fed_blocks += blocks.size();
+        ++summary.records;
+    }
+
+    summary.lines = reader.line_number();
+    summary.bytes = reader.bytes() - reader.buffered();
+    profile::add(profile::Counter::Documents, summary.records);
+    profile::add(profile::Counter::BytesRead, summary.bytes);
+    profile::add(profile::Counter::Blocks, fed_blocks);
+    return summary;
+}
+
+std::string format_ndjson_summary(const NdjsonSummary& summary)
+{
+    std::ostringstream out;
+    out << "=== Поток NDJSON ===\n";
+    out << "Строк: " << summary.lines << " (" << summary.bytes << " байт)\n";
+    out << "Документов с текстом: " << summary.records << "\n";
+    out << "Пустых строк: " << summary.empty << "\n";
+    out << "Строк с ошибками: " << summary.errors << "\n";
+    if (!summary.first_errors.empty())
+    {
+        out << "\nСтроки с ошибками"
+            << (summary.errors > summary.first_errors.size() ? " (первые " +
+                                                                   std::to_string(summary.first_errors.size()) + ")"
+                                                             : std::string())
+            << ":\n";
+        for (const auto& err : summary.first_errors)
+            out << "  " << err.line << ": " << err.message << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,275 @@
+#include "ngram.hpp"
+#include "profile.hpp"
+#include "unicode.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    constexpr size_t kInitialSlots = 1024;
+
+    std::uint64_t key_hash(const NgramTable::Id* ids) noexcept
+    {
+        std::uint64_t h = (std::uint64_t{ids[0]} | std::uint64_t{ids[1]} << 32) * 0x9e3779b97f4a7c15ULL;
+        h ^= (h >> 32) ^ (std::uint64_t{ids[2]} * 0xbf58476d1ce4e5b9ULL);
+        h ^= h >> 29;
+        return h * 0x94d049bb133111ebULL;
+    }
+
+    bool same_key(const NgramTable::Entry& e, const NgramTable::Id* ids) noexcept
+    {
+        return e.ids[0] == ids[0] && e.ids[1] == ids[1] && e.ids[2] == ids[2];
+    }
+
+    // Строка топа: слот таблицы и его частота.
+    struct Candidate
+    {
+        const NgramTable::Entry* entry;
+        std::uint64_t count;
+    };
+
+    // Порядок отчёта: частота по убыванию, затем n-грамма по алфавиту. Слова
+    // сравниваются по очереди — это тот же порядок, что у строк "слово слово",
+    // потому что пробел меньше любого байта слова.
+    class Ranking
+    {
+    public:
+        Ranking(const Vocabulary& words, size_t n) : m_words(words), m_n(n) {}
+
+        bool operator()(const Candidate& a, const Candidate& b) const
+        {
+            if (a.count != b.count)
+                return a.count > b.count;
+            for (size_t i = 0; i < m_n; ++i)
+            {
+                if (a.entry->ids[i] == b.entry->ids[i])
+                    continue;
+                return m_words.word(a.entry->ids[i]) < m_words.word(b.entry->ids[i]);
+            }
+            return false;
+        }
+
+    private:
+        const Vocabulary& m_words;
+        size_t m_n;
+    };
+
+    // Ограниченная куча из k лучших n-грамм (как TopKHeap в text_analyzer.cpp).
+    class TopNgrams
+    {
+    public:
+        TopNgrams(size_t k, const Ranking& rank) : m_k(k), m_rank(rank) {}
+
+        void offer(const NgramTable::Entry& entry)
+        {
+            Candidate candidate{ &entry, entry.count };
+            if (m_items.size() < m_k)
+            {
+                m_items.push_back(candidate);
+                std::push_heap(m_items.begin(), m_items.end(), m_rank);
+                return;
+            }
+            if (m_k == 0 || candidate.count < m_items.front().count || !m_rank(candidate, m_items.front()))
+                return;
+            std::pop_heap(m_items.begin(), m_items.end(), m_rank);
+            m_items.back() = candidate;
+            std::push_heap(m_items.begin(), m_items.end(), m_rank);
+        }
+
+        const std::vector<Candidate>& items() const noexcept { return m_items; }
+
+    private:
+        size_t m_k;
+        Ranking m_rank;
+        std::vector<Candidate> m_items;
+    };
+}
+
+NgramTable::NgramTable()
+{
+    rehash(kInitialSlots);
+}
+
+void NgramTable::rehash(size_t capacity)
+{
+    std::vector<Entry> old = std::move(m_slots);
+    m_slots.assign(capacity, Entry{});
+    m_mask = capacity - 1;
+    for (const Entry& e : old)
+    {
+        if (e.count == 0)
+            continue;
+        size_t slot = key_hash(e.ids) & m_mask;
+        while (m_slots[slot].count != 0)
+            slot = (slot + 1) & m_mask;
+        m_slots[slot] = e;
+    }
+}
+
+void NgramTable::add(const Id* ids, std::uint64_t n)
+{
+    size_t slot = key_hash(ids) & m_mask;
+    for (;;)
+    {
+        Entry& e = m_slots[slot];
+        if (e.count == 0)
+            break;
+        if (same_key(e, ids))
+        {
+            e.count += n;
+            return;
+        }
+        slot = (slot + 1) & m_mask;
+    }
+
+    if ((m_size + 1) * 10 > m_slots.size() * 7)
+    {
+        rehash(m_slots.size() * 2);
+        slot = key_hash(ids) & m_mask;
+        while (m_slots[slot].count != 0)
+            slot = (slot + 1) & m_mask;
+    }
+    Entry& e = m_slots[slot];
+    e.ids[0] = ids[0];
+    e.ids[1] = ids[1];
+    e.ids[2] = ids[2];
+    e.count = n;
+    ++m_size;
+}
+
+NgramAnalyzer::NgramAnalyzer(const StopwordSet& stopwords, const NgramOptions& options)
+    : m_stops(&stopwords)
+    , m_options(options)
+{
+    if (options.n < 2 || options.n > 3)
+        throw std::runtime_error("Длина n-грамм должна быть 2 или 3.");
+}
+
+void NgramAnalyzer::on_word(std::string_view word, size_t length)
+{
+    auto [id, inserted] = m_words.intern(word);
+    if (inserted)
+    {
+        m_words.set_stop(id, m_stops->contains(word));
+        m_words.set_length(id, static_cast<std::uint32_t>(length));
+    }
+    m_words.add(id);
+    ++m_word_count;
+
+    const size_t n = m_options.n;
+    if (m_window_size == n)
+    {
+        m_window[0] = m_window[1];
+        m_window[1] = m_window[2];
+        m_window[n - 1] = id;
+    }
+    else
+    {
+        m_window[m_window_size++] = id;
+        if (m_window_size < n)
+            return;
+    }
+
+    if (m_options.skip_stop_only)
+    {
+        bool all_stop = true;
+        for (size_t i = 0; i < n && all_stop; ++i)
+            all_stop = m_words.is_stop(m_window[i]);
+        if (all_stop)
+        {
+            ++m_skipped;
+            return;
+        }
+    }
+    const NgramTable::Id key[3] = { m_window[0], m_window[1], n == 3 ? m_window[2] : 0 };
+    m_table.add(key);
+    ++m_total;
+}
+
+void NgramAnalyzer::feed(std::string_view chunk)
+{
+    if (profile::enabled())
+        profile::thread_word_buffer().feed(m_tokenizer, chunk, *this);
+    else
+        m_tokenizer.feed(chunk, *this);
+}
+
+void NgramAnalyzer::end_block()
+{
+    if (profile::enabled())
+        profile::thread_word_buffer().end_block(m_tokenizer, *this);
+    else
+        m_tokenizer.end_block(*this);
+    m_window_size = 0;
+}
+
+TextStats NgramAnalyzer::finish(size_t top_n)
+{
+    end_block();
+    const size_t n = m_options.n;
+
+    TopNgrams all(top_n, Ranking(m_words, n));
+    TopNgrams no_stops(top_n, Ranking(m_words, n));
+    {
+        profile::ScopedTimer timer(profile::Stage::TopK);
+        for (const NgramTable::Entry& entry : m_table.slots())
+        {
+            if (entry.count == 0)
+                continue;
+            all.offer(entry);
+            bool all_stop = true;
+            for (size_t i = 0; i < n && all_stop; ++i)
+                all_stop = m_words.is_stop(entry.ids[i]);
+            if (!all_stop)
+                no_stops.offer(entry);
+        }
+    }
+
+    TextStats stats;
+    std::string phrase;
+    for (const TopNgrams* top : { &all, &no_stops })
+    {
+        for (const Candidate& c : top->items())
+        {
+            phrase.clear();
+            bool all_stop = true;
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (i != 0)
+                    phrase += ' ';
+                phrase += m_words.word(c.entry->ids[i]);
+                all_stop = all_stop && m_words.is_stop(c.entry->ids[i]);
+            }
+            auto [id, inserted] = stats.vocab.intern(phrase);
+            if (!inserted)
+                continue;
+            stats.vocab.set_count(id, c.count);
+            stats.vocab.set_stop(id, all_stop);
+            stats.vocab.set_length(id, static_cast<std::uint32_t>(unicode::code_points(phrase)));
+        }
+    }
+    build_ordered_views(stats);
+
+    // Итоги и распределение длин — по словам, как в обычном отчёте.
+    stats.total_words = m_word_count;
+    stats.total_sentences = m_sentences;
+    stats.unique_words = 0;
+    stats.length_distribution.clear();
+    for (Vocabulary::Id id = 0; id < m_words.size(); ++id)
+    {
+        ++stats.unique_words;
+        stats.length_distribution[m_words.length(id)] += m_words.count(id);
+    }
+
+    NgramSummary summary;
+    summary.n = n;
+    summary.total = m_total;
+    summary.distinct = m_table.size();
+    summary.skipped = m_skipped;
+    summary.skip_stop_only = m_options.skip_stop_only;
+    summary.memory_bytes = m_table.memory_bytes();
+    stats.ngrams = summary;
+    return stats;
+}
@@ -0,0 +1,280 @@
+#include "pack.hpp"
+#include "json_parser.hpp"
+#include "json_tape.hpp"
+#include "text_analyzer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr char kMagic[4] = {'T', 'F', 'P', 'K'};
+    constexpr std::uint32_t kVersion = 1;
+    constexpr std::uint32_t kHasText = 1;
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t doc_count;
+        std::uint64_t text_offset;
+        std::uint64_t text_size;
+        std::uint64_t names_offset;
+        std::uint64_t names_size;
+        std::uint64_t index_offset;
+        std::uint32_t flags;
+        std::uint32_t reserved;
+    };
+
+    struct IndexRecord
+    {
+        std::uint64_t doc_offset;
+        std::uint64_t name_offset;
+        std::uint64_t text_offset;
+        std::uint32_t doc_length;
+        std::uint32_t name_length;
+        std::uint32_t text_length; // байт блоков вместе с их длинами
+        std::uint32_t block_count; // 0 — текст не извлечён
+    };
+
+    static_assert(sizeof(Header) == 64 && sizeof(IndexRecord) == 40,
+                  "записи пакета должны быть без выравнивающих дыр");
+
+    IndexRecord read_entry(const char* index, size_t i)
+    {
+        IndexRecord record;
+        std::memcpy(&record, index + i * sizeof(IndexRecord), sizeof(IndexRecord));
+        return record;
+    }
+
+    [[noreturn]] void corrupted(const std::string& path, const char* what)
+    {
+        throw std::runtime_error("Пакет повреждён (" + std::string(what) + "): " + path);
+    }
+
+    bool fits(std::uint64_t offset, std::uint64_t length, std::uint64_t size)
+    {
+        return offset <= size && length <= size - offset;
+    }
+}
+
+PackReader::PackReader(const std::string& path)
+    : m_file(path)
+{
+    m_data = m_file.view();
+    if (m_data.size() < sizeof(Header))
+        corrupted(path, "нет заголовка");
+    Header header;
+    std::memcpy(&header, m_data.data(), sizeof(Header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        corrupted(path, "неверная сигнатура");
+    if (header.version != kVersion)
+        throw std::runtime_error("Пакет записан несовместимой версией (" + std::to_string(header.version) +
+                                 "): " + path);
+
+    if (!fits(header.text_offset, header.text_size, m_data.size()) ||
+        !fits(header.names_offset, header.names_size, m_data.size()) ||
+        header.doc_count > m_data.size() / sizeof(IndexRecord) ||
+        !fits(header.index_offset, header.doc_count * sizeof(IndexRecord), m_data.size()))
+        corrupted(path, "размеры секций");
+
+    m_text = m_data.substr(header.text_offset, header.text_size);
+    m_names = m_data.substr(header.names_offset, header.names_size);
+    m_index = m_data.data() + header.index_offset;
+    m_count = header.doc_count;
+    m_has_text = (header.flags & kHasText) != 0;
+
+    // Границы проверяются один раз здесь, а не при каждом обращении к документу.
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        IndexRecord record = read_entry(m_index, i);
+        if (!fits(record.doc_offset, record.doc_length, m_data.size()) ||
+            !fits(record.name_offset, record.name_length, m_names.size()) ||
+            !fits(record.text_offset, record.text_length, m_text.size()))
+            corrupted(path, "документ за пределами данных");
+    }
+}
+
+std::string_view PackReader::name(size_t i) const
+{
+    IndexRecord record = read_entry(m_index, i);
+    return m_names.substr(record.name_offset, record.name_length);
+}
+
+std::string_view PackReader::document(size_t i) const
+{
+    IndexRecord record = read_entry(m_index, i);
+    return m_data.substr(record.doc_offset, record.doc_length);
+}
+
+bool PackReader::text_blocks(size_t i, std::vector<std::string_view>& blocks) const
+{
+    blocks.clear();
+    IndexRecord record = read_entry(m_index, i);
+    if (record.block_count == 0)
+        return false;
+
+    std::string_view text = m_text.substr(record.text_offset, record.text_length);
+    size_t pos = 0;
+    for (std::uint32_t b = 0; b < record.block_count; ++b)
+    {
+        std::uint32_t length = 0;
+        if (text.size() - pos < sizeof(length))
+            throw std::runtime_error("Пакет повреждён: блок текста за пределами документа.");
+        std::memcpy(&length, text.data() + pos, sizeof(length));
+        pos += sizeof(length);
+        if (text.size() - pos < length)
+            throw std::runtime_error("Пакет повреждён: блок текста за пределами документа.");
+        blocks.push_back(text.substr(pos, length));
+        pos += length;
+    }
+    return true;
+}
+
+std::vector<PackReader::Range> PackReader::ranges(size_t parts) const
+{
+    std::vector<Range> result;
+    if (m_count == 0)
+        return result;
+    parts = std::max<size_t>(std::min(parts, m_count), 1);
+
+    std::uint64_t total = 0;
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        IndexRecord record = read_entry(m_index, i);
+        total += record.doc_length + record.text_length;
+    }
+
+    // Диапазон закрывается, как только набрал свою долю объёма.
+    const std::uint64_t share = total / parts + 1;
+    std::uint64_t filled = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        IndexRecord record = read_entry(m_index, i);
+        filled += record.doc_length + record.text_length;
+        if (filled >= share && result.size() + 1 < parts)
+        {
+            result.push_back(Range{begin, i + 1});
+            begin = i + 1;
+            filled = 0;
+        }
+    }
+    if (begin < m_count)
+        result.push_back(Range{begin, m_count});
+    return result;
+}
+
+PackSummary write_pack(const std::vector<std::string>& files, const std::string& path, const PackOptions& options)
+{
+    constexpr std::uint64_t kMaxLength = std::numeric_limits<std::uint32_t>::max();
+
+    PackSummary summary;
+    std::vector<IndexRecord> index;
+    index.reserve(files.size());
+    std::string text;
+    std::string names;
+
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        throw std::runtime_error("Не удалось открыть файл для записи: " + tmp_path);
+
+    // Заголовок пишется в конце, когда известны размеры секций.
+    Header header{};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::uint64_t offset = sizeof(header);
+
+    InputFile input;
+    json::Tape tape;
+    for (const std::string& file : files)
+    {
+        std::string_view content;
+        try
+        {
+            input.open(file);
+            content = input.view();
+            if (content.size() > kMaxLength)
+                throw std::runtime_error("документ больше 4 ГБ");
+        }
+        catch (const std::exception& e)
+        {
+            summary.skipped.push_back({file, e.what()});
+            continue;
+        }
+
+        IndexRecord record{};
+        record.doc_offset = offset;
+        record.doc_length = static_cast<std::uint32_t>(content.size());
+        record.name_offset = names.size();
+        record.name_length = static_cast<std::uint32_t>(file.size());
+        record.text_offset = text.size();
+        names.append(file);
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        offset += content.size();
+
+        if (options.extract_text)
+        {
+            try
+            {
+                json::Parser parser(content);
+                parser.parse(tape);
+                std::vector<std::string_view> blocks = extract_text_blocks(tape);
+                for (std::string_view block : blocks)
+                {
+                    const auto length = static_cast<std::uint32_t>(block.size());
+                    text.append(reinterpret_cast<const char*>(&length), sizeof(length));
+                    text.append(block);
+                }
+                record.block_count = static_cast<std::uint32_t>(blocks.size());
+                record.text_length = static_cast<std::uint32_t>(text.size() - record.text_offset);
+            }
+            catch (const std::exception&)
+            {
+                // Текст не извлекается: при анализе документ будет разобран заново
+                // и даст ту же ошибку, что и исходный файл.
+                text.resize(record.text_offset);
+            }
+            summary.with_text += record.block_count != 0;
+        }
+        index.push_back(record);
+    }
+
+    header = Header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.doc_count = index.size();
+    header.flags = options.extract_text ? kHasText : 0;
+    header.text_offset = offset;
+    header.text_size = text.size();
+    header.names_offset = header.text_offset + header.text_size;
+    header.names_size = names.size();
+    header.index_offset = (header.names_offset + header.names_size + 7) & ~std::uint64_t{7};
+
+    static const char kPadding[8] = {};
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+    out.write(kPadding, static_cast<std::streamsize>(header.index_offset - header.names_offset - header.names_size));
+    out.write(reinterpret_cast<const char*>(index.data()),
+              static_cast<std::streamsize>(index.size() * sizeof(IndexRecord)));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out.flush())
+        throw std::runtime_error("Не удалось записать пакет: " + tmp_path);
+    out.close();
+
+    std::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    if (ec)
+        throw std::runtime_error("Не удалось заменить пакет " + path + ": " + ec.message());
+
+    summary.documents = index.size();
+    summary.bytes = header.index_offset + index.size() * sizeof(IndexRecord);
+    return summary;
+}
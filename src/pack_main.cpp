@@ -0,0 +1,144 @@
+#include "batch.hpp"
+#include "pack.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// textfreq_pack: упаковка корпуса JSON-файлов в один файл для textfreq_cli --pack.
+
+namespace
+{
+    struct PackCliOptions
+    {
+        bool show_help{false};
+        std::optional<std::string> output_path;
+        std::optional<std::string> input_dir;
+        std::optional<std::string> input_glob;
+        std::optional<std::string> file_list;
+        bool extract_text{true};
+    };
+
+    PackCliOptions parse_pack_arguments(int argc, char** argv)
+    {
+        PackCliOptions opts;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h")
+            {
+                opts.show_help = true;
+            }
+            else if (arg == "--output" && i + 1 < argc)
+            {
+                opts.output_path = argv[++i];
+            }
+            else if (arg == "--input-dir" && i + 1 < argc)
+            {
+                opts.input_dir = argv[++i];
+            }
+            else if (arg == "--glob" && i + 1 < argc)
+            {
+                opts.input_glob = argv[++i];
+            }
+            else if (arg == "--file-list" && i + 1 < argc)
+            {
+                opts.file_list = argv[++i];
+            }
+            else if (arg == "--no-text")
+            {
+                opts.extract_text = false;
+            }
+            else
+            {
+                std::ostringstream oss;
+                oss << "Неизвестный или некорректный аргумент: " << arg
+                    << "\nИспользуйте --help для справки.";
+                throw std::runtime_error(oss.str());
+            }
+        }
+        return opts;
+    }
+
+    std::string make_pack_help_text()
+    {
+        std::ostringstream out;
+        out << "Упаковка корпуса JSON-файлов в один файл (для textfreq_cli --pack)\n\n";
+        out << "Использование:\n";
+        out << "  textfreq_pack --output <corpus.pack> --input-dir <dir> [--glob PATTERN] [--no-text]\n";
+        out << "  textfreq_pack --output <corpus.pack> --file-list <files.txt> [--no-text]\n\n";
+        out << "Параметры:\n";
+        out << "  --help, -h        Показать эту справку.\n";
+        out << "  --output PATH     Файл пакета (перезаписывается).\n";
+        out << "  --input-dir DIR   Каталог с JSON-файлами (по умолчанию *.json, *.json.gz, *.json.zst).\n";
+        out << "  --glob PATTERN    Шаблон имён файлов в --input-dir или путь с шаблоном.\n";
+        out << "  --file-list PATH  Текстовый файл со списком путей, по одному на строку.\n";
+        out << "  --no-text         Не сохранять извлечённый текст: пакет меньше, но при анализе\n";
+        out << "                    каждый документ разбирается как JSON.\n";
+        return out.str();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        PackCliOptions opts = parse_pack_arguments(argc, argv);
+        if (opts.show_help || !opts.output_path || (!opts.input_dir && !opts.input_glob && !opts.file_list))
+        {
+            std::cout << make_pack_help_text() << std::endl;
+            return opts.show_help ? 0 : 1;
+        }
+
+        std::vector<std::string> files;
+        if (opts.input_dir)
+        {
+            files = opts.input_glob ? list_directory(*opts.input_dir, *opts.input_glob)
+                                    : list_json_files(*opts.input_dir);
+        }
+        else if (opts.input_glob)
+        {
+            files = expand_glob(*opts.input_glob);
+        }
+        if (opts.file_list)
+        {
+            std::vector<std::string> listed = read_file_list(*opts.file_list);
+            files.insert(files.end(), listed.begin(), listed.end());
+        }
+        if (files.empty())
+        {
+            std::cerr << "Не найдено ни одного входного файла для упаковки." << std::endl;
+            return 1;
+        }
+
+        PackOptions options;
+        options.extract_text = opts.extract_text;
+
+        auto t_start = std::chrono::high_resolution_clock::now();
+        PackSummary summary = write_pack(files, *opts.output_path, options);
+        auto t_end = std::chrono::high_resolution_clock::now();
+        auto total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count();
+
+        std::cout << "Упаковано документов: " << summary.documents << " (с извлечённым текстом: "
+                  << summary.with_text << ") в " << *opts.output_path << ", " << summary.bytes << " байт\n";
+        if (!summary.skipped.empty())
+        {
+            std::cout << "Пропущено нечитаемых файлов: " << summary.skipped.size() << "\n";
+            for (const auto& err : summary.skipped)
+            {
+                std::cout << "  " << err.path << ": " << err.message << "\n";
+            }
+        }
+        std::cout << "Время упаковки: " << total_ms << " мс" << std::endl;
+        return summary.documents > 0 ? 0 : 1;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Ошибка: " << ex.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,297 @@
+#include "partial.hpp"
+#include "file_input.hpp"
+#include "vocabulary.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr char kMagic[4] = {'T', 'F', 'P', 'T'};
+    constexpr std::uint32_t kVersion = 1;
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t shard_index;
+        std::uint32_t shard_count;
+        std::uint64_t stopwords_fingerprint;
+        std::uint64_t total_words;
+        std::uint64_t total_sentences;
+        std::uint64_t files_total;
+        std::uint64_t files_ok;
+        std::uint64_t bytes_read;
+        std::uint64_t word_count;
+        std::uint64_t failed_count;
+        std::uint64_t strings_size;
+        std::uint64_t reserved;
+    };
+
+    struct WordRecord
+    {
+        std::uint64_t count;
+        std::uint64_t name_offset;
+        std::uint32_t name_length;
+        std::uint32_t length;
+        std::uint32_t stop;
+        std::uint32_t reserved;
+    };
+
+    struct FailedRecord
+    {
+        std::uint64_t path_offset;
+        std::uint64_t message_offset;
+        std::uint32_t path_length;
+        std::uint32_t message_length;
+    };
+
+    static_assert(sizeof(Header) == 96 && sizeof(WordRecord) == 32 && sizeof(FailedRecord) == 24,
+                  "записи частичного результата должны быть без выравнивающих дыр");
+
+    [[noreturn]] void corrupted(const std::string& path, const char* what)
+    {
+        throw std::runtime_error("Частичный результат повреждён (" + std::string(what) + "): " + path);
+    }
+
+    template <typename T>
+    T read_record(std::string_view data, std::uint64_t offset)
+    {
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    std::string_view string_at(const std::string& path, std::string_view strings, std::uint64_t offset,
+                               std::uint64_t length)
+    {
+        if (offset > strings.size() || length > strings.size() - offset)
+            corrupted(path, "строка за пределами данных");
+        return strings.substr(offset, length);
+    }
+}
+
+ShardSpec parse_shard(const std::string& text)
+{
+    const size_t slash = text.find('/');
+    ShardSpec shard;
+    try
+    {
+        if (slash == std::string::npos || slash == 0 || slash + 1 == text.size())
+            throw std::invalid_argument(text);
+        size_t used = 0;
+        shard.index = static_cast<size_t>(std::stoul(text.substr(0, slash), &used));
+        if (used != slash)
+            throw std::invalid_argument(text);
+        shard.count = static_cast<size_t>(std::stoul(text.substr(slash + 1), &used));
+        if (used != text.size() - slash - 1)
+            throw std::invalid_argument(text);
+    }
+    catch (const std::logic_error&)
+    {
+        throw std::runtime_error("Шард задаётся как i/N, например 0/4: " + text);
+    }
+    if (shard.count == 0 || shard.count > 0xFFFFFFFFu || shard.index >= shard.count)
+        throw std::runtime_error("Номер шарда должен быть меньше числа шардов: " + text);
+    return shard;
+}
+
+std::vector<std::string> select_shard(const std::vector<std::string>& files, const ShardSpec& shard)
+{
+    std::vector<std::string> selected;
+    for (const std::string& file : files)
+    {
+        if (Vocabulary::hash(file) % shard.count == shard.index)
+            selected.push_back(file);
+    }
+    return selected;
+}
+
+void write_partial(const std::string& path, const BatchResult& result, const ShardSpec& shard,
+                   const StopwordSet& stopwords)
+{
+    if (result.stats.approx || result.stats.ngrams)
+        throw std::runtime_error("Частичный результат хранит только точные частоты слов.");
+
+    std::string strings;
+    std::vector<WordRecord> words;
+    const Vocabulary& vocab = result.stats.vocab;
+    words.reserve(vocab.size());
+    for (Vocabulary::Id id = 0; id < vocab.size(); ++id)
+    {
+        if (vocab.count(id) == 0)
+            continue;
+        const std::string_view word = vocab.word(id);
+        WordRecord record{};
+        record.count = vocab.count(id);
+        record.name_offset = strings.size();
+        record.name_length = static_cast<std::uint32_t>(word.size());
+        record.length = vocab.length(id);
+        record.stop = vocab.is_stop(id) ? 1 : 0;
+        strings.append(word);
+        words.push_back(record);
+    }
+
+    std::vector<FailedRecord> failed;
+    failed.reserve(result.failed.size());
+    for (const FileError& error : result.failed)
+    {
+        FailedRecord record{};
+        record.path_offset = strings.size();
+        record.path_length = static_cast<std::uint32_t>(error.path.size());
+        strings.append(error.path);
+        record.message_offset = strings.size();
+        record.message_length = static_cast<std::uint32_t>(error.message.size());
+        strings.append(error.message);
+        failed.push_back(record);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.shard_index = static_cast<std::uint32_t>(shard.index);
+    header.shard_count = static_cast<std::uint32_t>(shard.count);
+    header.stopwords_fingerprint = stopwords.fingerprint();
+    header.total_words = result.stats.total_words;
+    header.total_sentences = result.stats.total_sentences;
+    header.files_total = result.files_total;
+    header.files_ok = result.files_ok;
+    header.bytes_read = result.bytes_read;
+    header.word_count = words.size();
+    header.failed_count = failed.size();
+    header.strings_size = strings.size();
+
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("Не удалось открыть файл для записи: " + tmp_path);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(words.data()),
+                  static_cast<std::streamsize>(words.size() * sizeof(WordRecord)));
+        out.write(reinterpret_cast<const char*>(failed.data()),
+                  static_cast<std::streamsize>(failed.size() * sizeof(FailedRecord)));
+        out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        if (!out.flush())
+            throw std::runtime_error("Не удалось записать частичный результат: " + tmp_path);
+    }
+    std::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    if (ec)
+        throw std::runtime_error("Не удалось сохранить частичный результат " + path + ": " + ec.message());
+}
+
+PartialResult read_partial(const std::string& path)
+{
+    InputFile input(path);
+    std::string_view data = input.view();
+
+    if (data.size() < sizeof(Header))
+        corrupted(path, "нет заголовка");
+    Header header = read_record<Header>(data, 0);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        corrupted(path, "неверная сигнатура");
+    if (header.version != kVersion)
+        throw std::runtime_error("Частичный результат записан несовместимой версией (" +
+                                 std::to_string(header.version) + "): " + path);
+    if (header.shard_count == 0 || header.shard_index >= header.shard_count)
+        corrupted(path, "номер шарда");
+
+    const std::uint64_t words_at = sizeof(Header);
+    const std::uint64_t failed_at = words_at + header.word_count * sizeof(WordRecord);
+    const std::uint64_t strings_at = failed_at + header.failed_count * sizeof(FailedRecord);
+    if (header.word_count > data.size() || header.failed_count > data.size() ||
+        strings_at + header.strings_size > data.size())
+        corrupted(path, "размеры секций");
+    const std::string_view strings = data.substr(strings_at, header.strings_size);
+
+    PartialResult partial;
+    partial.shard.index = header.shard_index;
+    partial.shard.count = header.shard_count;
+    partial.stopwords_fingerprint = header.stopwords_fingerprint;
+
+    BatchResult& result = partial.result;
+    result.files_total = header.files_total;
+    result.files_ok = header.files_ok;
+    result.bytes_read = header.bytes_read;
+    result.stats.total_words = header.total_words;
+    result.stats.total_sentences = header.total_sentences;
+
+    Vocabulary& vocab = result.stats.vocab;
+    for (std::uint64_t i = 0; i < header.word_count; ++i)
+    {
+        const WordRecord record = read_record<WordRecord>(data, words_at + i * sizeof(WordRecord));
+        auto [id, inserted] = vocab.intern(string_at(path, strings, record.name_offset, record.name_length));
+        if (!inserted)
+            corrupted(path, "повтор слова");
+        vocab.set_count(id, record.count);
+        vocab.set_length(id, record.length);
+        vocab.set_stop(id, record.stop != 0);
+    }
+    for (std::uint64_t i = 0; i < header.failed_count; ++i)
+    {
+        const FailedRecord record = read_record<FailedRecord>(data, failed_at + i * sizeof(FailedRecord));
+        result.failed.push_back({std::string(string_at(path, strings, record.path_offset, record.path_length)),
+                                 std::string(string_at(path, strings, record.message_offset, record.message_length))});
+    }
+    return partial;
+}
+
+BatchResult reduce_partials(const std::vector<std::string>& paths)
+{
+    if (paths.empty())
+        throw std::runtime_error("Не передано ни одного частичного результата.");
+
+    BatchResult total;
+    std::vector<std::string> seen; // путь частичного файла по номеру шарда
+    std::uint64_t fingerprint = 0;
+    for (const std::string& path : paths)
+    {
+        PartialResult partial = read_partial(path);
+        if (seen.empty())
+        {
+            seen.resize(partial.shard.count);
+            fingerprint = partial.stopwords_fingerprint;
+        }
+        else if (partial.shard.count != seen.size())
+        {
+            throw std::runtime_error("Частичные результаты разбиты на разное число шардов: " + paths.front() +
+                                     " и " + path);
+        }
+        if (partial.stopwords_fingerprint != fingerprint)
+            throw std::runtime_error("Частичные результаты посчитаны с разными стоп-словами: " + paths.front() +
+                                     " и " + path);
+        if (!seen[partial.shard.index].empty())
+            throw std::runtime_error("Шард " + std::to_string(partial.shard.index) + " передан дважды: " +
+                                     seen[partial.shard.index] + " и " + path);
+        seen[partial.shard.index] = path;
+
+        BatchResult& part = partial.result;
+        merge_stats(total.stats, part.stats, false);
+        total.files_total += part.files_total;
+        total.files_ok += part.files_ok;
+        total.bytes_read += part.bytes_read;
+        for (FileError& error : part.failed)
+            total.failed.push_back(std::move(error));
+    }
+
+    std::string missing;
+    for (size_t i = 0; i < seen.size(); ++i)
+    {
+        if (seen[i].empty())
+            missing += (missing.empty() ? "" : ", ") + std::to_string(i);
+    }
+    if (!missing.empty())
+        throw std::runtime_error("Не хватает частичных результатов шардов " + missing + " из " +
+                                 std::to_string(seen.size()) + ".");
+
+    build_ordered_views(total.stats);
+    std::sort(total.failed.begin(), total.failed.end(),
+              [](const FileError& a, const FileError& b) { return a.path < b.path; });
+    return total;
+}
@@ -0,0 +1,187 @@
+#include "profile.hpp"
+#include "unicode.hpp"
+
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+namespace profile
+{
+    namespace detail
+    {
+        bool g_enabled = false;
+    }
+
+    namespace
+    {
+        constexpr size_t kStages = static_cast<size_t>(Stage::StageCount);
+        constexpr size_t kCounters = static_cast<size_t>(Counter::CounterCount);
+
+        std::atomic<std::uint64_t> g_stage_ns[kStages];
+        std::atomic<std::uint64_t> g_counters[kCounters];
+
+        // Текущий таймер потока — родитель для вложенных.
+        thread_local ScopedTimer* t_current = nullptr;
+    }
+
+    WordBuffer& thread_word_buffer()
+    {
+        thread_local WordBuffer buffer;
+        return buffer;
+    }
+
+    void enable()
+    {
+        detail::g_enabled = true;
+    }
+
+    void add_time(Stage stage, std::uint64_t ns) noexcept
+    {
+        g_stage_ns[static_cast<size_t>(stage)].fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void add(Counter counter, std::uint64_t value) noexcept
+    {
+        if (enabled())
+            g_counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void set(Counter counter, std::uint64_t value) noexcept
+    {
+        if (enabled())
+            g_counters[static_cast<size_t>(counter)].store(value, std::memory_order_relaxed);
+    }
+
+    void ScopedTimer::start() noexcept
+    {
+        m_parent = t_current;
+        t_current = this;
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    void ScopedTimer::stop() noexcept
+    {
+        const auto elapsed = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+        add_time(m_stage, elapsed > m_child_ns ? elapsed - m_child_ns : 0);
+        if (m_parent)
+            m_parent->m_child_ns += elapsed;
+        t_current = m_parent;
+    }
+
+    const char* stage_name(Stage stage) noexcept
+    {
+        switch (stage)
+        {
+        case Stage::StopwordLoad: return "stopword_load";
+        case Stage::FileRead: return "file_read";
+        case Stage::JsonParse: return "json_parse";
+        case Stage::BlockExtract: return "block_extract";
+        case Stage::Tokenize: return "tokenize";
+        case Stage::Count: return "count";
+        case Stage::Merge: return "merge";
+        case Stage::Views: return "ordered_views";
+        case Stage::TopK: return "top_k";
+        case Stage::ReportFormat: return "report_format";
+        case Stage::OutputWrite: return "output_write";
+        case Stage::StageCount: break;
+        }
+        return "?";
+    }
+
+    const char* stage_title(Stage stage) noexcept
+    {
+        switch (stage)
+        {
+        case Stage::StopwordLoad: return "Загрузка стоп-слов";
+        case Stage::FileRead: return "Чтение файлов";
+        case Stage::JsonParse: return "Разбор JSON";
+        case Stage::BlockExtract: return "Извлечение блоков текста";
+        case Stage::Tokenize: return "Токенизация";
+        case Stage::Count: return "Подсчёт частот";
+        case Stage::Merge: return "Слияние таблиц";
+        case Stage::Views: return "Упорядоченные представления";
+        case Stage::TopK: return "Выбор топа";
+        case Stage::ReportFormat: return "Форматирование отчёта";
+        case Stage::OutputWrite: return "Вывод отчёта";
+        case Stage::StageCount: break;
+        }
+        return "?";
+    }
+
+    const char* counter_name(Counter counter) noexcept
+    {
+        switch (counter)
+        {
+        case Counter::BytesRead: return "bytes_read";
+        case Counter::Documents: return "documents";
+        case Counter::Blocks: return "blocks";
+        case Counter::Tokens: return "tokens";
+        case Counter::Sentences: return "sentences";
+        case Counter::UniqueWords: return "unique_words";
+        case Counter::HashProbes: return "hash_probes";
+        case Counter::Stopwords: return "stopwords";
+        case Counter::CounterCount: break;
+        }
+        return "?";
+    }
+
+    const char* counter_title(Counter counter) noexcept
+    {
+        switch (counter)
+        {
+        case Counter::BytesRead: return "Прочитано байт";
+        case Counter::Documents: return "Документов";
+        case Counter::Blocks: return "Блоков текста";
+        case Counter::Tokens: return "Слов";
+        case Counter::Sentences: return "Предложений";
+        case Counter::UniqueWords: return "Уникальных слов";
+        case Counter::HashProbes: return "Проб хеш-таблиц";
+        case Counter::Stopwords: return "Стоп-слов";
+        case Counter::CounterCount: break;
+        }
+        return "?";
+    }
+
+    std::string format_table(std::uint64_t wall_ns)
+    {
+        std::ostringstream out;
+        out << "=== Профиль ===\n";
+        out << "Этап" << std::string(26, ' ') << std::string(7, ' ') << "Время, нс" << std::string(5, ' ')
+            << "Доля" << "\n";
+        out << std::fixed << std::setprecision(1);
+        std::uint64_t total = 0;
+        for (size_t i = 0; i < kStages; ++i)
+        {
+            const std::uint64_t ns = g_stage_ns[i].load(std::memory_order_relaxed);
+            total += ns;
+            // setw считает байты, а подписи кириллические: выравниваем по символам.
+            std::string_view title = stage_title(static_cast<Stage>(i));
+            const size_t chars = unicode::code_points(title);
+            out << title << std::string(chars < 30 ? 30 - chars : 1, ' ') << std::setw(16) << ns << std::setw(8)
+                << (wall_ns ? 100.0 * ns / wall_ns : 0.0) << "%\n";
+        }
+        out << "Сумма этапов: " << total << " нс, общее время: " << wall_ns << " нс\n";
+        out << "(этапы рабочих потоков суммируются по потокам)\n\n";
+        out << "Счётчики:\n";
+        for (size_t i = 0; i < kCounters; ++i)
+            out << "  " << counter_title(static_cast<Counter>(i)) << ": " << g_counters[i].load(std::memory_order_relaxed)
+                << "\n";
+        return out.str();
+    }
+
+    std::string format_json(std::uint64_t wall_ns)
+    {
+        std::ostringstream out;
+        out << "{\"wall_ns\": " << wall_ns << ", \"stages\": {";
+        for (size_t i = 0; i < kStages; ++i)
+            out << (i ? ", " : "") << "\"" << stage_name(static_cast<Stage>(i))
+                << "\": " << g_stage_ns[i].load(std::memory_order_relaxed);
+        out << "}, \"counters\": {";
+        for (size_t i = 0; i < kCounters; ++i)
+            out << (i ? ", " : "") << "\"" << counter_name(static_cast<Counter>(i))
+                << "\": " << g_counters[i].load(std::memory_order_relaxed);
+        out << "}}\n";
+        return out.str();
+    }
+}
@@ -0,0 +1,641 @@
+#include "read_ahead.hpp"
+#include "file_input.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define TEXTFREQ_HAVE_URING 1
+#endif
+#endif
+#endif
+
+namespace
+{
+    constexpr size_t kPage = 4096;
+
+    size_t round_capacity(size_t size)
+    {
+        return std::max(kPage, (size + kPage - 1) / kPage * kPage);
+    }
+}
+
+// Файл, ожидающий чтения или читаемый сейчас.
+struct ReadAhead::Pending
+{
+    File file;
+    int fd{-1};
+    size_t size{0};
+    size_t done{0};
+    std::unique_ptr<InputFile> stream; // канал или устройство, уже прочитанное целиком
+};
+
+#if defined(TEXTFREQ_HAVE_URING)
+
+// Минимальная обёртка над io_uring через системные вызовы (без liburing):
+// кольца отправки и завершения отображаются в память, синхронизация с ядром —
+// acquire/release на головах и хвостах колец.
+class ReadAhead::Uring
+{
+public:
+    static std::unique_ptr<Uring> create(unsigned entries)
+    {
+        std::unique_ptr<Uring> ring(new Uring);
+        io_uring_params params{};
+        ring->m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ring->m_fd < 0)
+            return nullptr; // ядро без io_uring или запрещено политикой
+        if (!ring->map(params))
+            return nullptr;
+        return ring;
+    }
+
+    ~Uring()
+    {
+        if (m_sqes)
+            ::munmap(m_sqes, m_sqes_size);
+        if (m_cq_ptr && m_cq_ptr != m_sq_ptr)
+            ::munmap(m_cq_ptr, m_cq_size);
+        if (m_sq_ptr)
+            ::munmap(m_sq_ptr, m_sq_size);
+        if (m_fd >= 0)
+            ::close(m_fd);
+    }
+
+    // Чтение length байт с offset в buffer; user_data возвращается в завершении.
+    void prep_read(int fd, char* buffer, size_t length, size_t offset, std::uint64_t user_data)
+    {
+        const unsigned tail = *m_sq_tail;
+        const unsigned index = tail & *m_sq_mask;
+        io_uring_sqe& sqe = m_sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(buffer);
+        sqe.len = static_cast<unsigned>(std::min<size_t>(length, 1u << 30));
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        m_sq_array[index] = index;
+        __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++m_unsubmitted;
+    }
+
+    // Отправляет подготовленные чтения и ждёт хотя бы wait завершений.
+    void enter(unsigned wait)
+    {
+        for (;;)
+        {
+            const long n = ::syscall(__NR_io_uring_enter, m_fd, m_unsubmitted, wait,
+                                     wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (n >= 0)
+            {
+                m_unsubmitted -= static_cast<unsigned>(n);
+                return;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                throw std::runtime_error(std::string("Ошибка io_uring: ") + std::strerror(errno));
+        }
+    }
+
+    bool pop(std::uint64_t& user_data, int& result)
+    {
+        const unsigned head = *m_cq_head;
+        if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE))
+            return false;
+        const io_uring_cqe& cqe = m_cqes[head & *m_cq_mask];
+        user_data = cqe.user_data;
+        result = cqe.res;
+        __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    int m_fd{-1};
+    void* m_sq_ptr{nullptr};
+    void* m_cq_ptr{nullptr};
+    size_t m_sq_size{0};
+    size_t m_cq_size{0};
+    io_uring_sqe* m_sqes{nullptr};
+    size_t m_sqes_size{0};
+
+    unsigned* m_sq_tail{nullptr};
+    unsigned* m_sq_mask{nullptr};
+    unsigned* m_sq_array{nullptr};
+    unsigned* m_cq_head{nullptr};
+    unsigned* m_cq_tail{nullptr};
+    unsigned* m_cq_mask{nullptr};
+    io_uring_cqe* m_cqes{nullptr};
+    unsigned m_unsubmitted{0};
+
+    Uring() = default;
+
+    bool map(const io_uring_params& p)
+    {
+        m_sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        m_cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+
+        m_sq_ptr = ::mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                          IORING_OFF_SQ_RING);
+        if (m_sq_ptr == MAP_FAILED)
+        {
+            m_sq_ptr = nullptr;
+            return false;
+        }
+        m_cq_ptr = m_sq_ptr;
+        if (!single)
+        {
+            m_cq_ptr = ::mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                              IORING_OFF_CQ_RING);
+            if (m_cq_ptr == MAP_FAILED)
+            {
+                m_cq_ptr = nullptr;
+                return false;
+            }
+        }
+        m_sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return false;
+        m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(m_sq_ptr);
+        char* cq = static_cast<char*>(m_cq_ptr);
+        m_sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        m_sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        m_sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        m_cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        m_cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        m_cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return true;
+    }
+};
+
+#else
+
+class ReadAhead::Uring
+{
+public:
+    static std::unique_ptr<Uring> create(unsigned) { return nullptr; }
+};
+
+#endif
+
+ReadAhead::ReadAhead(const std::vector<std::string>& files, const ReadAheadOptions& options)
+    : m_files(files)
+    , m_options(options)
+{
+    m_options.queue_depth = std::clamp<size_t>(m_options.queue_depth, 1, 4096);
+    if (m_options.use_uring)
+        m_uring = Uring::create(static_cast<unsigned>(m_options.queue_depth));
+
+    if (m_uring)
+    {
+        m_threads.emplace_back([this] { run_uring(); });
+    }
+    else
+    {
+        const size_t readers = std::min<size_t>({ m_options.queue_depth, 64, std::max<size_t>(files.size(), 1) });
+        for (size_t i = 0; i < readers; ++i)
+            m_threads.emplace_back([this] { run_threads(); });
+    }
+}
+
+ReadAhead::~ReadAhead()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+    }
+    m_space_cv.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+bool ReadAhead::next(File& file)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_ready_cv.wait(lock, [this] { return !m_ready.empty() || m_delivered == m_files.size(); });
+    if (m_ready.empty())
+        return false;
+    file = std::move(m_ready.front());
+    m_ready.pop_front();
+    ++m_delivered;
+    return true;
+}
+
+void ReadAhead::release(File& file)
+{
+    if (!file.buffer)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_inflight_bytes -= file.capacity;
+        // Буфер остаётся в пуле, пока пул вместе с чтениями укладывается в предел.
+        if (m_free_bytes + m_inflight_bytes + file.capacity <= m_options.max_inflight_bytes)
+        {
+            m_free_bytes += file.capacity;
+            m_free.emplace(file.capacity, std::move(file.buffer));
+        }
+    }
+    file.buffer.reset();
+    file.capacity = 0;
+    file.data = {};
+    m_space_cv.notify_all();
+}
+
+bool ReadAhead::acquire(size_t size, File& file, bool wait)
+{
+    const size_t capacity = round_capacity(size);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto fits = [&] {
+        return m_inflight_bytes == 0 || m_inflight_bytes + capacity <= m_options.max_inflight_bytes;
+    };
+    if (wait)
+        m_space_cv.wait(lock, [&] { return m_cancelled || fits(); });
+    if (m_cancelled || !fits())
+        return false;
+
+    // Подходящий свободный буфер — не больше чем вдвое крупнее нужного.
+    auto it = m_free.lower_bound(capacity);
+    if (it != m_free.end() && it->first <= capacity * 2)
+    {
+        file.capacity = it->first;
+        file.buffer = std::move(it->second);
+        m_free_bytes -= it->first;
+        m_free.erase(it);
+    }
+    else
+    {
+        // Новый буфер: лишние свободные уступают ему место в пределе памяти.
+        while (!m_free.empty() && m_free_bytes + m_inflight_bytes + capacity > m_options.max_inflight_bytes)
+        {
+            auto largest = std::prev(m_free.end());
+            m_free_bytes -= largest->first;
+            m_free.erase(largest);
+        }
+        file.capacity = capacity;
+        file.buffer.reset(new char[capacity]);
+    }
+    m_inflight_bytes += file.capacity;
+    return true;
+}
+
+void ReadAhead::complete(File&& file)
+{
+    if (!file.error.empty())
+        release(file);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.push_back(std::move(file));
+    }
+    m_ready_cv.notify_one();
+}
+
+#if defined(_WIN32)
+
+void ReadAhead::run_uring()
+{
+}
+
+void ReadAhead::run_threads()
+{
+    // Без POSIX-вызовов: файлы читаются InputFile по одному.
+    for (;;)
+    {
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_cancelled || m_next_file >= m_files.size())
+                return;
+            index = m_next_file++;
+        }
+        File file;
+        file.index = index;
+        try
+        {
+            InputFile input(m_files[index]);
+            if (!acquire(input.view().size(), file, true))
+                return;
+            std::memcpy(file.buffer.get(), input.view().data(), input.view().size());
+            file.data = std::string_view(file.buffer.get(), input.view().size());
+        }
+        catch (const std::exception& e)
+        {
+            file.error = e.what();
+        }
+        complete(std::move(file));
+    }
+}
+
+#else
+
+namespace
+{
+    // Открывает файл для чтения целиком: false и текст ошибки, если не вышло.
+    bool open_for_read(const std::string& path, int& fd, size_t& size, bool& regular, std::string& error)
+    {
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            error = "Не удалось открыть файл: " + path;
+            return false;
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            fd = -1;
+            error = "Не удалось получить размер файла: " + path;
+            return false;
+        }
+        regular = S_ISREG(st.st_mode);
+        size = regular ? static_cast<size_t>(st.st_size) : 0;
+        return true;
+    }
+}
+
+void ReadAhead::run_threads()
+{
+    for (;;)
+    {
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_cancelled || m_next_file >= m_files.size())
+                return;
+            index = m_next_file++;
+        }
+        const std::string& path = m_files[index];
+        File file;
+        file.index = index;
+        int fd = -1;
+        size_t size = 0;
+        bool regular = true;
+        if (!open_for_read(path, fd, size, regular, file.error))
+        {
+            complete(std::move(file));
+            continue;
+        }
+        if (!regular)
+        {
+            // Канал или устройство: размер заранее неизвестен.
+            ::close(fd);
+            try
+            {
+                InputFile input(path);
+                if (!acquire(input.view().size(), file, true))
+                    return;
+                std::memcpy(file.buffer.get(), input.view().data(), input.view().size());
+                file.data = std::string_view(file.buffer.get(), input.view().size());
+            }
+            catch (const std::exception& e)
+            {
+                file.error = e.what();
+            }
+            complete(std::move(file));
+            continue;
+        }
+        if (!acquire(size, file, true))
+        {
+            ::close(fd);
+            return;
+        }
+        size_t done = 0;
+        while (done < size)
+        {
+            const ssize_t n = ::pread(fd, file.buffer.get() + done, size - done, static_cast<off_t>(done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+            {
+                file.error = "Ошибка чтения файла: " + path;
+                break;
+            }
+            if (n == 0)
+                break; // файл укоротился во время чтения
+            done += static_cast<size_t>(n);
+        }
+        ::close(fd);
+        file.data = std::string_view(file.buffer.get(), done);
+        complete(std::move(file));
+    }
+}
+
+#if defined(TEXTFREQ_HAVE_URING)
+
+void ReadAhead::run_uring()
+{
+    Uring& ring = *m_uring;
+    const size_t depth = m_options.queue_depth;
+    std::vector<Pending> slots(depth);
+    std::vector<size_t> free_slots;
+    for (size_t i = depth; i-- > 0;)
+        free_slots.push_back(i);
+
+    size_t next = 0;
+    size_t active = 0;
+    std::optional<Pending> opened; // открыт, но ждёт места в пределе памяти
+
+    auto finish = [&](Pending& op) {
+        ::close(op.fd);
+        op.fd = -1;
+        op.file.data = std::string_view(op.file.buffer.get(), op.done);
+        complete(std::move(op.file));
+        op = Pending{};
+    };
+
+    // Сбой io_uring_enter не должен уходить из потока в std::terminate.
+    try
+    {
+        for (;;)
+        {
+            bool cancelled;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                cancelled = m_cancelled;
+            }
+            if (cancelled)
+            {
+                next = m_files.size();
+                if (opened && opened->fd >= 0)
+                    ::close(opened->fd);
+                opened.reset();
+            }
+
+            while (active < depth)
+            {
+                if (!opened)
+                {
+                    if (next == m_files.size())
+                        break;
+                    Pending op;
+                    op.file.index = next;
+                    const std::string& path = m_files[next++];
+                    bool regular = true;
+                    if (!open_for_read(path, op.fd, op.size, regular, op.file.error))
+                    {
+                        complete(std::move(op.file));
+                        continue;
+                    }
+                    if (!regular)
+                    {
+                        // Канал или устройство: читается сразу, а место под копию
+                        // ждёт вместе с обычными файлами.
+                        ::close(op.fd);
+                        op.fd = -1;
+                        try
+                        {
+                            op.stream = std::make_unique<InputFile>(path);
+                            op.size = op.stream->view().size();
+                        }
+                        catch (const std::exception& e)
+                        {
+                            op.file.error = e.what();
+                            complete(std::move(op.file));
+                            continue;
+                        }
+                    }
+                    if (op.size == 0)
+                    {
+                        if (op.fd >= 0)
+                            ::close(op.fd);
+                        complete(std::move(op.file));
+                        continue;
+                    }
+                    opened = std::move(op);
+                }
+                // Пока есть чтения в полёте, ждать места нельзя: его освободят только
+                // их завершения, которые надо сначала забрать из кольца.
+                if (!acquire(opened->size, opened->file, active == 0))
+                {
+                    if (active == 0 && opened->stream)
+                    {
+                        // Отмена: канал уже вычитан, отдаём его ошибкой, а не пустым.
+                        opened->file.error = "Чтение отменено: " + m_files[opened->file.index];
+                        complete(std::move(opened->file));
+                        opened.reset();
+                    }
+                    break;
+                }
+                if (opened->stream)
+                {
+                    std::memcpy(opened->file.buffer.get(), opened->stream->view().data(), opened->size);
+                    opened->file.data = std::string_view(opened->file.buffer.get(), opened->size);
+                    complete(std::move(opened->file));
+                    opened.reset();
+                    continue;
+                }
+                const size_t slot = free_slots.back();
+                free_slots.pop_back();
+                slots[slot] = std::move(*opened);
+                opened.reset();
+                ring.prep_read(slots[slot].fd, slots[slot].file.buffer.get(), slots[slot].size, 0, slot);
+                ++active;
+            }
+
+            if (active == 0)
+            {
+                if (!opened && next == m_files.size())
+                    return;
+                if (cancelled)
+                    return;
+                continue;
+            }
+
+            ring.enter(1);
+            std::uint64_t slot = 0;
+            int result = 0;
+            while (ring.pop(slot, result))
+            {
+                Pending& op = slots[slot];
+                if (result == -EINTR || result == -EAGAIN)
+                {
+                    ring.prep_read(op.fd, op.file.buffer.get() + op.done, op.size - op.done, op.done, slot);
+                    continue;
+                }
+                if (result < 0)
+                {
+                    op.file.error = "Ошибка чтения файла: " + m_files[op.file.index] + " (" + std::strerror(-result) + ")";
+                }
+                else
+                {
+                    op.done += static_cast<size_t>(result);
+                    if (result > 0 && op.done < op.size)
+                    {
+                        // Короткое чтение: дочитываем остаток тем же слотом.
+                        ring.prep_read(op.fd, op.file.buffer.get() + op.done, op.size - op.done, op.done, slot);
+                        continue;
+                    }
+                }
+                finish(op);
+                free_slots.push_back(static_cast<size_t>(slot));
+                --active;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        if (opened)
+        {
+            ::close(opened->fd);
+            next = opened->file.index; // ещё не отправлен — дочитает pread
+            opened.reset();
+        }
+        abandon_uring(slots, next, e.what());
+    }
+}
+
+void ReadAhead::abandon_uring(std::vector<Pending>& slots, size_t next, const std::string& reason)
+{
+    for (Pending& op : slots)
+    {
+        if (op.fd < 0)
+            continue;
+        ::close(op.fd);
+        op.fd = -1;
+        {
+            // Буфер остаётся за ядром до уничтожения кольца и выходит из предела памяти.
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_inflight_bytes -= op.file.capacity;
+            m_stranded.push_back(std::move(op.file.buffer));
+        }
+        op.file.capacity = 0;
+        op.file.error = "Ошибка чтения файла: " + m_files[op.file.index] + " (" + reason + ")";
+        complete(std::move(op.file));
+    }
+    m_space_cv.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_next_file = next;
+    }
+    run_threads();
+}
+
+#else
+
+void ReadAhead::run_uring()
+{
+}
+
+#endif
+
+#endif
@@ -0,0 +1,544 @@
+#include "report_writer.hpp"
+#include "file_input.hpp"
+#include "profile.hpp"
+#include "unicode.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char kMagic[4] = {'T', 'F', 'R', 'P'};
+    constexpr std::uint32_t kVersion = 1;
+    constexpr std::uint32_t kApprox = 1;
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t total_words;
+        std::uint64_t total_sentences;
+        std::uint64_t unique_words;
+        std::uint64_t word_count;
+        std::uint64_t length_count;
+        std::uint64_t names_size;
+        // Границы ошибок, если flags & kApprox.
+        std::uint64_t memory_budget;
+        std::uint64_t counters;
+        std::uint64_t max_overcount;
+        std::uint64_t missing_bound;
+        double unique_error;
+        std::uint32_t flags;
+        std::uint32_t reserved;
+        std::uint64_t reserved2[3];
+    };
+
+    struct WordRecord
+    {
+        std::uint64_t count;
+        std::uint64_t name_offset;
+        std::uint32_t name_length;
+        std::uint32_t length;
+        std::uint32_t stop;
+        std::uint32_t reserved;
+    };
+
+    struct LengthRecord
+    {
+        std::uint64_t length;
+        std::uint64_t words;
+    };
+
+    static_assert(sizeof(Header) == 128 && sizeof(WordRecord) == 32 && sizeof(LengthRecord) == 16,
+                  "записи отчёта должны быть без выравнивающих дыр");
+
+    [[noreturn]] void corrupted(const std::string& path, const char* what)
+    {
+        throw std::runtime_error("Двоичный отчёт повреждён (" + std::string(what) + "): " + path);
+    }
+
+    struct Row
+    {
+        std::string_view word;
+        std::uint64_t count;
+        std::uint32_t length;
+        bool stop;
+    };
+
+    // Все слова в порядке отчёта: частота по убыванию, затем слово по возрастанию.
+    std::vector<Row> ranked_rows(const TextStats& stats)
+    {
+        std::vector<Row> rows;
+        if (!stats.vocab.empty() || stats.word_freq.empty())
+        {
+            const Vocabulary& vocab = stats.vocab;
+            rows.reserve(vocab.size());
+            for (Vocabulary::Id id = 0; id < vocab.size(); ++id)
+            {
+                if (vocab.count(id) != 0)
+                    rows.push_back({ vocab.word(id), vocab.count(id), vocab.length(id), vocab.is_stop(id) });
+            }
+        }
+        else
+        {
+            // Статистика, собранная вручную только в упорядоченных представлениях.
+            rows.reserve(stats.word_freq.size());
+            for (const auto& [word, count] : stats.word_freq)
+            {
+                rows.push_back({ word, count, static_cast<std::uint32_t>(unicode::code_points(word)),
+                                 stats.word_freq_no_stops.count(word) == 0 });
+            }
+        }
+        std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+            if (a.count != b.count)
+                return a.count > b.count;
+            return a.word < b.word;
+        });
+        return rows;
+    }
+
+    void write_json_string(FdWriter& out, std::string_view s)
+    {
+        out.put('"');
+        size_t start = 0;
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            const unsigned char c = static_cast<unsigned char>(s[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            out.write(s.substr(start, i - start));
+            if (c == '"' || c == '\\')
+            {
+                out.put('\\');
+                out.put(static_cast<char>(c));
+            }
+            else if (c == '\n' || c == '\t' || c == '\r')
+            {
+                out.put('\\');
+                out.put(c == '\n' ? 'n' : c == '\t' ? 't' : 'r');
+            }
+            else
+            {
+                static const char hex[] = "0123456789abcdef";
+                const char escaped[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                out.write(std::string_view(escaped, sizeof(escaped)));
+            }
+            start = i + 1;
+        }
+        out.write(s.substr(start));
+        out.put('"');
+    }
+
+    void write_json(FdWriter& out, const TextStats& stats)
+    {
+        out.write("{\"total_words\": ");
+        out.write_uint(stats.total_words);
+        out.write(", \"total_sentences\": ");
+        out.write_uint(stats.total_sentences);
+        out.write(", \"unique_words\": ");
+        out.write_uint(stats.unique_words);
+        out.write(", \"approx\": ");
+        if (stats.approx)
+        {
+            const ApproxBounds& b = *stats.approx;
+            out.write("{\"memory_budget\": ");
+            out.write_uint(b.memory_budget);
+            out.write(", \"counters\": ");
+            out.write_uint(b.counters);
+            out.write(", \"max_overcount\": ");
+            out.write_uint(b.max_overcount);
+            out.write(", \"missing_bound\": ");
+            out.write_uint(b.missing_bound);
+            out.write(", \"unique_error\": ");
+            out.write_double(b.unique_error);
+            out.put('}');
+        }
+        else
+        {
+            out.write("null");
+        }
+
+        if (stats.ngrams)
+        {
+            const NgramSummary& g = *stats.ngrams;
+            out.write(", \"ngrams\": {\"n\": ");
+            out.write_uint(g.n);
+            out.write(", \"total\": ");
+            out.write_uint(g.total);
+            out.write(", \"distinct\": ");
+            out.write_uint(g.distinct);
+            out.write(", \"skipped_stop_only\": ");
+            out.write_uint(g.skipped);
+            out.put('}');
+        }
+        out.write(",\n\"length_distribution\": {");
+        bool first = true;
+        for (const auto& [length, words] : stats.length_distribution)
+        {
+            out.write(first ? "\"" : ", \"");
+            out.write_uint(length);
+            out.write("\": ");
+            out.write_uint(words);
+            first = false;
+        }
+
+        out.write("},\n\"words\": [");
+        first = true;
+        for (const Row& row : ranked_rows(stats))
+        {
+            out.write(first ? "\n{\"word\": " : ",\n{\"word\": ");
+            write_json_string(out, row.word);
+            out.write(", \"count\": ");
+            out.write_uint(row.count);
+            out.write(row.stop ? ", \"stop\": true, \"length\": " : ", \"stop\": false, \"length\": ");
+            out.write_uint(row.length);
+            out.put('}');
+            first = false;
+        }
+        out.write("\n]}\n");
+    }
+
+    void write_csv(FdWriter& out, const TextStats& stats)
+    {
+        out.write("word,count,stop,length\n");
+        for (const Row& row : ranked_rows(stats))
+        {
+            // Кавычки по RFC 4180 — только если слово их требует.
+            if (row.word.find_first_of(",\"\r\n") == std::string_view::npos)
+            {
+                out.write(row.word);
+            }
+            else
+            {
+                out.put('"');
+                for (char c : row.word)
+                {
+                    if (c == '"')
+                        out.put('"');
+                    out.put(c);
+                }
+                out.put('"');
+            }
+            out.put(',');
+            out.write_uint(row.count);
+            out.write(row.stop ? ",1," : ",0,");
+            out.write_uint(row.length);
+            out.put('\n');
+        }
+    }
+
+    void write_binary(FdWriter& out, const TextStats& stats)
+    {
+        const std::vector<Row> rows = ranked_rows(stats);
+
+        Header header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.total_words = stats.total_words;
+        header.total_sentences = stats.total_sentences;
+        header.unique_words = stats.unique_words;
+        header.word_count = rows.size();
+        header.length_count = stats.length_distribution.size();
+        for (const Row& row : rows)
+            header.names_size += row.word.size();
+        if (stats.approx)
+        {
+            header.flags |= kApprox;
+            header.memory_budget = stats.approx->memory_budget;
+            header.counters = stats.approx->counters;
+            header.max_overcount = stats.approx->max_overcount;
+            header.missing_bound = stats.approx->missing_bound;
+            header.unique_error = stats.approx->unique_error;
+        }
+        out.write_pod(header);
+
+        std::uint64_t offset = 0;
+        for (const Row& row : rows)
+        {
+            WordRecord record{};
+            record.count = row.count;
+            record.name_offset = offset;
+            record.name_length = static_cast<std::uint32_t>(row.word.size());
+            record.length = row.length;
+            record.stop = row.stop ? 1 : 0;
+            out.write_pod(record);
+            offset += row.word.size();
+        }
+        for (const auto& [length, words] : stats.length_distribution)
+            out.write_pod(LengthRecord{ length, words });
+        for (const Row& row : rows)
+            out.write(row.word);
+    }
+}
+
+#if defined(_WIN32)
+
+FdWriter::FdWriter()
+    : m_fd(1), m_name("stdout"), m_buffer(new char[kBufferSize])
+{
+    _setmode(m_fd, _O_BINARY);
+}
+
+FdWriter::FdWriter(const std::string& path)
+    : m_name(path), m_buffer(new char[kBufferSize])
+{
+    m_fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    if (m_fd < 0)
+        throw std::runtime_error("Не удалось открыть файл для записи: " + path);
+    m_owned = true;
+}
+
+void FdWriter::write_direct(const char* data, size_t size)
+{
+    profile::ScopedTimer timer(profile::Stage::OutputWrite);
+    while (size > 0)
+    {
+        const unsigned part = static_cast<unsigned>(std::min<size_t>(size, 1u << 30));
+        const int n = _write(m_fd, data, part);
+        if (n <= 0)
+            throw std::runtime_error("Ошибка записи в " + m_name);
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+void FdWriter::close()
+{
+    flush();
+    if (m_owned)
+    {
+        m_owned = false;
+        if (_close(m_fd) != 0)
+            throw std::runtime_error("Ошибка закрытия файла: " + m_name);
+    }
+}
+
+#else
+
+FdWriter::FdWriter()
+    : m_fd(STDOUT_FILENO), m_name("stdout"), m_buffer(new char[kBufferSize])
+{
+}
+
+FdWriter::FdWriter(const std::string& path)
+    : m_name(path), m_buffer(new char[kBufferSize])
+{
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0)
+        throw std::runtime_error("Не удалось открыть файл для записи: " + path);
+    m_owned = true;
+}
+
+void FdWriter::write_direct(const char* data, size_t size)
+{
+    profile::ScopedTimer timer(profile::Stage::OutputWrite);
+    while (size > 0)
+    {
+        const ssize_t n = ::write(m_fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            throw std::runtime_error("Ошибка записи в " + m_name + ": " + std::strerror(errno));
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+void FdWriter::close()
+{
+    flush();
+    if (m_owned)
+    {
+        m_owned = false;
+        if (::close(m_fd) != 0)
+            throw std::runtime_error("Ошибка закрытия файла: " + m_name);
+    }
+}
+
+#endif
+
+FdWriter::FdWriter(std::string* target)
+    : m_target(target), m_name("memory"), m_buffer(new char[kBufferSize])
+{
+}
+
+FdWriter::~FdWriter()
+{
+    // Ошибки здесь уже некому сообщить: кто хочет их видеть, вызывает close().
+    try
+    {
+        close();
+    }
+    catch (const std::exception&)
+    {
+    }
+}
+
+void FdWriter::write(std::string_view bytes)
+{
+    if (bytes.size() <= kBufferSize - m_used)
+    {
+        std::memcpy(m_buffer.get() + m_used, bytes.data(), bytes.size());
+        m_used += bytes.size();
+        return;
+    }
+    flush();
+    if (bytes.size() >= kBufferSize)
+    {
+        if (m_target)
+            m_target->append(bytes.data(), bytes.size());
+        else
+            write_direct(bytes.data(), bytes.size());
+        return;
+    }
+    std::memcpy(m_buffer.get(), bytes.data(), bytes.size());
+    m_used = bytes.size();
+}
+
+void FdWriter::put(char c)
+{
+    if (m_used == kBufferSize)
+        flush();
+    m_buffer[m_used++] = c;
+}
+
+void FdWriter::write_uint(std::uint64_t value)
+{
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    write(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+}
+
+void FdWriter::write_double(double value)
+{
+    char digits[32];
+    const int n = std::snprintf(digits, sizeof(digits), "%.17g", value);
+    write(std::string_view(digits, static_cast<size_t>(n)));
+}
+
+void FdWriter::flush()
+{
+    if (m_used == 0)
+        return;
+    const size_t used = m_used;
+    m_used = 0;
+    if (m_target)
+        m_target->append(m_buffer.get(), used);
+    else
+        write_direct(m_buffer.get(), used);
+}
+
+ReportFormat parse_report_format(const std::string& name)
+{
+    if (name == "text")
+        return ReportFormat::Text;
+    if (name == "json")
+        return ReportFormat::Json;
+    if (name == "csv")
+        return ReportFormat::Csv;
+    if (name == "bin")
+        return ReportFormat::Binary;
+    throw std::runtime_error("Неизвестный формат отчёта '" + name + "' (допустимы text, json, csv, bin).");
+}
+
+void write_report(FdWriter& out, const TextStats& stats, size_t top_n, ReportFormat format)
+{
+    profile::ScopedTimer timer(profile::Stage::ReportFormat);
+    switch (format)
+    {
+    case ReportFormat::Text:
+        out.write(format_report(stats, top_n));
+        break;
+    case ReportFormat::Json:
+        write_json(out, stats);
+        break;
+    case ReportFormat::Csv:
+        write_csv(out, stats);
+        break;
+    case ReportFormat::Binary:
+        write_binary(out, stats);
+        break;
+    }
+}
+
+TextStats read_binary_report(const std::string& path)
+{
+    InputFile file(path);
+    std::string_view data = file.view();
+    if (data.size() < sizeof(Header))
+        corrupted(path, "нет заголовка");
+    Header header;
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        corrupted(path, "неверная сигнатура");
+    if (header.version != kVersion)
+        throw std::runtime_error("Двоичный отчёт записан несовместимой версией (" +
+                                 std::to_string(header.version) + "): " + path);
+
+    const std::uint64_t body = data.size() - sizeof(Header);
+    if (header.word_count > body / sizeof(WordRecord) ||
+        header.length_count > body / sizeof(LengthRecord) ||
+        header.word_count * sizeof(WordRecord) + header.length_count * sizeof(LengthRecord) + header.names_size !=
+            body)
+        corrupted(path, "размеры секций");
+
+    const char* records = data.data() + sizeof(Header);
+    const char* lengths = records + header.word_count * sizeof(WordRecord);
+    std::string_view names(lengths + header.length_count * sizeof(LengthRecord), header.names_size);
+
+    TextStats stats;
+    stats.total_words = header.total_words;
+    stats.total_sentences = header.total_sentences;
+    stats.vocab.reserve(header.word_count);
+    for (std::uint64_t i = 0; i < header.word_count; ++i)
+    {
+        WordRecord record;
+        std::memcpy(&record, records + i * sizeof(WordRecord), sizeof(WordRecord));
+        if (record.name_offset > names.size() || record.name_length > names.size() - record.name_offset)
+            corrupted(path, "слово за пределами данных");
+        auto [id, inserted] = stats.vocab.intern(names.substr(record.name_offset, record.name_length));
+        if (!inserted)
+            corrupted(path, "повторяющееся слово");
+        stats.vocab.set_count(id, record.count);
+        stats.vocab.set_length(id, record.length);
+        stats.vocab.set_stop(id, record.stop != 0);
+    }
+    build_ordered_views(stats);
+
+    // Распределение по длине и число уникальных слов берутся из файла: в режиме
+    // --approx они не выводятся из словаря.
+    stats.unique_words = header.unique_words;
+    stats.length_distribution.clear();
+    for (std::uint64_t i = 0; i < header.length_count; ++i)
+    {
+        LengthRecord record;
+        std::memcpy(&record, lengths + i * sizeof(LengthRecord), sizeof(LengthRecord));
+        stats.length_distribution[record.length] = record.words;
+    }
+    if (header.flags & kApprox)
+    {
+        ApproxBounds bounds;
+        bounds.memory_budget = header.memory_budget;
+        bounds.counters = header.counters;
+        bounds.max_overcount = header.max_overcount;
+        bounds.missing_bound = header.missing_bound;
+        bounds.unique_error = header.unique_error;
+        stats.approx = bounds;
+    }
+    return stats;
+}
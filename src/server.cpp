@@ -0,0 +1,635 @@
+#include "server.hpp"
+#include "text_analyzer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Очередь задач с постоянными потоками: в отличие от WorkStealingPool, задачи
+    // приходят по одной, пока сервер работает. Ожидающих задач не больше
+    // max_pending (0 — вдвое больше потоков): push ждёт, пока потоки не разберут
+    // очередь, и так останавливает чтение новых запросов.
+    class TaskQueue
+    {
+    public:
+        TaskQueue(size_t threads, size_t max_pending)
+        {
+            if (threads == 0)
+                threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+            m_capacity = max_pending != 0 ? max_pending : 2 * threads;
+            for (size_t i = 0; i < threads; ++i)
+                m_threads.emplace_back([this] { work(); });
+        }
+
+        ~TaskQueue() { finish(); }
+
+        void push(std::function<void()> task)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_space.wait(lock, [this] { return m_tasks.size() < m_capacity; });
+                m_tasks.push_back(std::move(task));
+            }
+            m_ready.notify_one();
+        }
+
+        // Дожидается выполнения всех поставленных задач и останавливает потоки.
+        void finish()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_closing = true;
+            }
+            m_ready.notify_all();
+            for (std::thread& thread : m_threads)
+            {
+                if (thread.joinable())
+                    thread.join();
+            }
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_ready;
+        std::condition_variable m_space;
+        std::deque<std::function<void()>> m_tasks;
+        std::vector<std::thread> m_threads;
+        size_t m_capacity{0};
+        bool m_closing{false};
+
+        void work()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_ready.wait(lock, [this] { return m_closing || !m_tasks.empty(); });
+                    if (m_tasks.empty())
+                        return;
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+                m_space.notify_one();
+                task();
+            }
+        }
+    };
+
+    std::uint32_t read_u32(const char* p)
+    {
+        const auto* b = reinterpret_cast<const unsigned char*>(p);
+        return std::uint32_t{b[0]} | std::uint32_t{b[1]} << 8 | std::uint32_t{b[2]} << 16 |
+               std::uint32_t{b[3]} << 24;
+    }
+
+    void append_u32(std::string& out, std::uint32_t value)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+            out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+
+    // Рамка ответа: [u32 длина][u32 id][u8 статус][тело].
+    std::string make_frame(std::uint32_t id, Server::Status status, std::string_view body)
+    {
+        std::string frame;
+        frame.reserve(9 + body.size());
+        append_u32(frame, static_cast<std::uint32_t>(body.size() + 1));
+        append_u32(frame, id);
+        frame.push_back(static_cast<char>(status));
+        frame.append(body);
+        return frame;
+    }
+
+    // Параметры запроса поверх значений сервера по умолчанию.
+    struct RequestOptions
+    {
+        size_t top_n;
+        ReportFormat format;
+        std::string stops;
+    };
+
+    void parse_request_options(std::string_view line, RequestOptions& options)
+    {
+        std::istringstream in{std::string(line)};
+        std::string item;
+        while (in >> item)
+        {
+            const size_t eq = item.find('=');
+            const std::string key = item.substr(0, eq);
+            const std::string value = eq == std::string::npos ? std::string() : item.substr(eq + 1);
+            if (key == "top" && !value.empty() && value.find_first_not_of("0123456789") == std::string::npos)
+                options.top_n = static_cast<size_t>(std::stoul(value));
+            else if (key == "format")
+                options.format = parse_report_format(value);
+            else if (key == "stops" && !value.empty())
+                options.stops = value;
+            else
+                throw std::runtime_error("Неизвестный параметр запроса: " + item);
+        }
+    }
+
+#if !defined(_WIN32)
+    // Читает ровно size байт. false — конец потока до первого байта; обрыв
+    // посреди рамки — исключение.
+    bool read_exact(int fd, char* data, size_t size)
+    {
+        size_t done = 0;
+        while (done < size)
+        {
+            const ssize_t n = ::read(fd, data + done, size - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                throw std::runtime_error(std::string("Ошибка чтения запроса: ") + std::strerror(errno));
+            if (n == 0)
+            {
+                if (done == 0)
+                    return false;
+                throw std::runtime_error("Запрос оборван посреди рамки.");
+            }
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void write_all(int fd, std::string_view data)
+    {
+        while (!data.empty())
+        {
+            const ssize_t n = ::write(fd, data.data(), data.size());
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw std::runtime_error(std::string("Ошибка записи ответа: ") + std::strerror(errno));
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+    }
+
+    // Читает одну рамку запроса; false — клиент закрыл поток. Слишком длинный
+    // запрос вычитывается и отбрасывается, а too_long сообщает об этом.
+    bool read_frame(int fd, size_t max_request, std::uint32_t& id, std::string& payload, bool& too_long)
+    {
+        char header[8];
+        if (!read_exact(fd, header, sizeof(header)))
+            return false;
+        const std::uint32_t length = read_u32(header);
+        id = read_u32(header + 4);
+        too_long = length > max_request;
+        if (too_long)
+        {
+            char sink[4096];
+            for (std::uint32_t left = length; left > 0;)
+            {
+                const size_t part = std::min<size_t>(left, sizeof(sink));
+                if (!read_exact(fd, sink, part))
+                    throw std::runtime_error("Запрос оборван посреди рамки.");
+                left -= static_cast<std::uint32_t>(part);
+            }
+            payload.clear();
+            return true;
+        }
+        payload.resize(length);
+        if (length > 0 && !read_exact(fd, payload.data(), length))
+            throw std::runtime_error("Запрос оборван посреди рамки.");
+        return true;
+    }
+
+    // Соединение Unix-сокета. Сокет неблокирующий, читает и пишет только поток
+    // опроса; в пул уходит уже разобранный запрос.
+    struct Connection
+    {
+        int fd{-1};
+        std::string in;        // прочитано, но ещё не разобрано в рамки
+        std::string out;       // ответы, ещё не отправленные клиенту
+        std::uint64_t skip{0}; // остаток отбрасываемого слишком длинного запроса
+        bool busy{false};      // запрос соединения в работе: следующий ждёт его ответа
+        bool eof{false};       // клиент закрыл запись или соединение сломалось
+    };
+#endif
+}
+
+Server::Server(StopwordSet stopwords, const Options& options)
+    : m_stopwords(std::move(stopwords))
+    , m_options(options)
+{
+    m_latency.reserve(kLatencySamples);
+}
+
+Server::~Server() = default;
+
+void Server::add_stopwords(const std::string& name, StopwordSet stopwords)
+{
+    if (!m_named_stops.emplace(name, std::move(stopwords)).second)
+        throw std::runtime_error("Набор стоп-слов указан дважды: " + name);
+}
+
+const StopwordSet& Server::stopwords_for(const std::string& name) const
+{
+    if (name.empty())
+        return m_stopwords;
+    auto it = m_named_stops.find(name);
+    if (it == m_named_stops.end())
+        throw std::runtime_error("Неизвестный набор стоп-слов: " + name + " (наборы задаются --serve-stops при запуске).");
+    return it->second;
+}
+
+Server::Status Server::handle(std::string_view request, std::string& response)
+{
+    const auto t_start = std::chrono::steady_clock::now();
+    response.clear();
+    Status status = Ok;
+
+    // Буферы потока переживают запрос: лента и её арена не выделяются заново.
+    thread_local json::Tape tape;
+    thread_local std::vector<std::string_view> blocks;
+    try
+    {
+        if (request == "stats")
+        {
+            response = format_latency();
+        }
+        else if (request == "shutdown")
+        {
+            stop();
+            response = "Сервер останавливается.\n";
+        }
+        else
+        {
+            RequestOptions options{m_options.top_n, m_options.format, {}};
+            std::string_view document = request;
+            const size_t first = request.find_first_not_of(" \t\r\n");
+            if (first != std::string_view::npos && request[first] != '{' && request[first] != '[')
+            {
+                const size_t newline = request.find('\n');
+                parse_request_options(request.substr(0, newline), options);
+                document = newline == std::string_view::npos ? std::string_view() : request.substr(newline + 1);
+            }
+
+            json::Parser parser(document);
+            parser.parse(tape);
+            blocks = extract_text_blocks(tape);
+            if (blocks.empty())
+                throw std::runtime_error("Во входном JSON не найден текст (\"text\" или массив параграфов).");
+
+            StreamingAnalyzer analyzer(stopwords_for(options.stops));
+            for (std::string_view block : blocks)
+            {
+                analyzer.feed(block);
+                analyzer.end_block();
+            }
+            TextStats stats = analyzer.finish();
+
+            FdWriter out(&response);
+            write_report(out, stats, options.top_n, options.format);
+            out.close();
+        }
+    }
+    catch (const json::ParseError& e)
+    {
+        status = Error;
+        response = std::string("Ошибка парсинга JSON: ") + e.what();
+    }
+    catch (const std::exception& e)
+    {
+        status = Error;
+        response = std::string("Ошибка: ") + e.what();
+    }
+
+    record_latency(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t_start).count()));
+    return status;
+}
+
+void Server::record_latency(std::uint64_t ns)
+{
+    std::lock_guard<std::mutex> lock(m_latency_mutex);
+    if (m_latency.size() < kLatencySamples)
+        m_latency.push_back(ns);
+    else
+        m_latency[m_requests % kLatencySamples] = ns;
+    ++m_requests;
+}
+
+Server::Latency Server::latency() const
+{
+    std::vector<std::uint64_t> samples;
+    Latency result;
+    {
+        std::lock_guard<std::mutex> lock(m_latency_mutex);
+        samples = m_latency;
+        result.requests = m_requests;
+    }
+    if (samples.empty())
+        return result;
+
+    std::sort(samples.begin(), samples.end());
+    // Перцентиль по рангу: наименьшее значение, не меньше доли p выборки.
+    auto at = [&](double p) {
+        size_t rank = static_cast<size_t>(p * static_cast<double>(samples.size()) + 0.999999);
+        return samples[std::min(samples.size(), std::max<size_t>(rank, 1)) - 1];
+    };
+    result.p50 = at(0.50);
+    result.p90 = at(0.90);
+    result.p99 = at(0.99);
+    result.p999 = at(0.999);
+    result.max = samples.back();
+    return result;
+}
+
+std::string Server::format_latency() const
+{
+    const Latency l = latency();
+    std::ostringstream out;
+    out << "Запросов: " << l.requests << "\n";
+    out << "Задержка, мкс (по последним " << std::min<std::uint64_t>(l.requests, kLatencySamples)
+        << " запросам): p50 " << l.p50 / 1000 << ", p90 " << l.p90 / 1000 << ", p99 " << l.p99 / 1000
+        << ", p99.9 " << l.p999 / 1000 << ", max " << l.max / 1000 << "\n";
+    return out.str();
+}
+
+void Server::stop()
+{
+    m_stopping.store(true);
+}
+
+#if defined(_WIN32)
+
+void Server::serve_stream(int, int)
+{
+    throw std::runtime_error("Режим --serve поддерживается только в POSIX-системах.");
+}
+
+void Server::serve_unix(const std::string&)
+{
+    throw std::runtime_error("Режим --serve поддерживается только в POSIX-системах.");
+}
+
+#else
+
+void Server::serve_stream(int in_fd, int out_fd)
+{
+    // Клиент, закрывший чтение, не должен убивать сервер сигналом.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::mutex out_mutex;
+    std::string write_error;
+    {
+        // Очередь ограничена: пока она полна, следующая рамка не читается, и
+        // быстрый писатель упирается в буфер канала, а не раздувает память.
+        TaskQueue queue(m_options.threads, m_options.max_pending);
+        for (;;)
+        {
+            auto payload = std::make_shared<std::string>();
+            std::uint32_t id = 0;
+            bool too_long = false;
+            if (!read_frame(in_fd, m_options.max_request, id, *payload, too_long))
+                break;
+
+            queue.push([this, payload, id, too_long, out_fd, &out_mutex, &write_error] {
+                thread_local std::string response;
+                Status status = Error;
+                if (too_long)
+                    response = "Ошибка: запрос длиннее " + std::to_string(m_options.max_request) + " байт.";
+                else
+                    status = handle(*payload, response);
+                const std::string frame = make_frame(id, status, response);
+                std::lock_guard<std::mutex> lock(out_mutex);
+                try
+                {
+                    write_all(out_fd, frame);
+                }
+                catch (const std::exception& e)
+                {
+                    if (write_error.empty())
+                        write_error = e.what();
+                }
+            });
+        }
+    }
+    if (!write_error.empty())
+        throw std::runtime_error(write_error);
+}
+
+void Server::serve_unix(const std::string& path)
+{
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Слишком длинный путь сокета: " + path);
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // Сокет, оставшийся от прошлого запуска, заменяется; обычный файл — нет.
+    struct stat st{};
+    if (::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+        ::unlink(path.c_str());
+
+    m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (m_listen_fd < 0)
+        throw std::runtime_error(std::string("Не удалось создать сокет: ") + std::strerror(errno));
+    if (::bind(m_listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(m_listen_fd, 128) != 0)
+    {
+        const std::string reason = std::strerror(errno);
+        ::close(m_listen_fd);
+        m_listen_fd = -1;
+        throw std::runtime_error("Не удалось открыть сокет " + path + ": " + reason);
+    }
+
+    int wake[2];
+    if (::pipe2(wake, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+        const std::string reason = std::strerror(errno);
+        ::close(m_listen_fd);
+        m_listen_fd = -1;
+        throw std::runtime_error("Не удалось создать канал пробуждения сервера: " + reason);
+    }
+
+    std::map<int, Connection> connections;
+    std::mutex done_mutex;
+    std::vector<std::pair<int, std::string>> done; // готовые рамки ответов по fd соединения
+    {
+        // Пул занят только запросами: простаивающее соединение не держит поток.
+        // Запросы одного соединения идут по порядку (следующий разбирается после
+        // ответа на предыдущий), разные соединения — параллельно.
+        TaskQueue queue(m_options.threads, m_options.max_pending);
+
+        // Разбирает рамки из буфера соединения и отдаёт запрос пулу.
+        auto dispatch = [&](Connection& c) {
+            while (!c.busy)
+            {
+                if (c.skip > 0)
+                {
+                    const size_t part = static_cast<size_t>(std::min<std::uint64_t>(c.skip, c.in.size()));
+                    c.in.erase(0, part);
+                    c.skip -= part;
+                    if (c.skip > 0)
+                        return;
+                }
+                if (c.in.size() < 8)
+                    return;
+                const std::uint32_t length = read_u32(c.in.data());
+                const std::uint32_t id = read_u32(c.in.data() + 4);
+                if (length > m_options.max_request)
+                {
+                    c.out += make_frame(id, Error,
+                                        "Ошибка: запрос длиннее " + std::to_string(m_options.max_request) + " байт.");
+                    c.in.erase(0, 8);
+                    c.skip = length;
+                    continue;
+                }
+                if (c.in.size() < 8 + size_t{length})
+                    return;
+                auto payload = std::make_shared<std::string>(c.in, 8, length);
+                c.in.erase(0, 8 + size_t{length});
+                c.busy = true;
+                const int fd = c.fd;
+                queue.push([this, payload, id, fd, &done_mutex, &done, &wake] {
+                    thread_local std::string response;
+                    const Status status = handle(*payload, response);
+                    {
+                        std::lock_guard<std::mutex> lock(done_mutex);
+                        done.emplace_back(fd, make_frame(id, status, response));
+                    }
+                    const char byte = 0;
+                    [[maybe_unused]] const ssize_t n = ::write(wake[1], &byte, 1); // полный канал и так разбудит
+                });
+            }
+        };
+
+        std::vector<pollfd> polled;
+        std::vector<char> chunk(64 * 1024);
+        // После остановки недоставленные ответы дописываются не дольше секунды.
+        std::chrono::steady_clock::time_point flush_deadline{};
+        for (;;)
+        {
+            const bool stopping = m_stopping.load();
+            if (stopping)
+            {
+                const bool busy = std::any_of(connections.begin(), connections.end(),
+                                              [](const auto& item) { return item.second.busy; });
+                const bool pending = std::any_of(connections.begin(), connections.end(),
+                                                 [](const auto& item) { return !item.second.out.empty(); });
+                if (!busy && flush_deadline == std::chrono::steady_clock::time_point{})
+                    flush_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+                if (!busy && (!pending || std::chrono::steady_clock::now() >= flush_deadline))
+                    break;
+            }
+
+            polled.clear();
+            polled.push_back({wake[0], POLLIN, 0});
+            polled.push_back({stopping ? -1 : m_listen_fd, POLLIN, 0});
+            for (const auto& [fd, c] : connections)
+            {
+                short events = 0;
+                if (!c.busy && !c.eof && !stopping)
+                    events |= POLLIN;
+                if (!c.out.empty())
+                    events |= POLLOUT;
+                // Занятое соединение без ответов не опрашивается: иначе его POLLHUP
+                // будил бы цикл вхолостую до конца запроса.
+                if (events != 0)
+                    polled.push_back({fd, events, 0});
+            }
+            if (::poll(polled.data(), polled.size(), 200) <= 0)
+                continue;
+
+            if (polled[0].revents != 0)
+            {
+                char sink[256];
+                while (::read(wake[0], sink, sizeof(sink)) > 0)
+                {
+                }
+                std::vector<std::pair<int, std::string>> ready;
+                {
+                    std::lock_guard<std::mutex> lock(done_mutex);
+                    ready.swap(done);
+                }
+                for (auto& [fd, frame] : ready)
+                {
+                    Connection& c = connections[fd];
+                    c.out += frame;
+                    c.busy = false;
+                    if (!stopping)
+                        dispatch(c);
+                }
+            }
+            if (polled[1].revents & POLLIN)
+            {
+                int client;
+                while ((client = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0)
+                    connections[client].fd = client;
+            }
+            for (size_t i = 2; i < polled.size(); ++i)
+            {
+                if (polled[i].revents == 0)
+                    continue;
+                Connection& c = connections[polled[i].fd];
+                if ((polled[i].revents & POLLOUT) && !c.out.empty())
+                {
+                    const ssize_t n = ::write(c.fd, c.out.data(), c.out.size());
+                    if (n > 0)
+                        c.out.erase(0, static_cast<size_t>(n));
+                    else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    {
+                        // Клиент ушёл, не дочитав: ответы ему больше не нужны.
+                        c.out.clear();
+                        c.eof = true;
+                    }
+                }
+                if ((polled[i].revents & (POLLIN | POLLHUP | POLLERR)) && !c.busy && !c.eof)
+                {
+                    const ssize_t n = ::read(c.fd, chunk.data(), chunk.size());
+                    if (n > 0)
+                        c.in.append(chunk.data(), static_cast<size_t>(n));
+                    else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                        c.eof = true;
+                }
+                if (!stopping)
+                    dispatch(c);
+            }
+            for (auto it = connections.begin(); it != connections.end();)
+            {
+                const Connection& c = it->second;
+                if (c.eof && !c.busy && c.out.empty())
+                {
+                    ::close(c.fd);
+                    it = connections.erase(it);
+                }
+                else
+                    ++it;
+            }
+        }
+    }
+    for (const auto& item : connections)
+        ::close(item.first);
+    ::close(wake[0]);
+    ::close(wake[1]);
+    ::close(m_listen_fd);
+    m_listen_fd = -1;
+    ::unlink(path.c_str());
+}
+
+#endif
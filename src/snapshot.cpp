@@ -0,0 +1,498 @@
+#include "snapshot.hpp"
+#include "file_input.hpp"
+#include "json_parser.hpp"
+#include "json_tape.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr char kMagic[4] = {'T', 'F', 'S', 'N'};
+    constexpr std::uint32_t kVersion = 1;
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t total_words;
+        std::uint64_t total_sentences;
+        std::uint64_t word_count;
+        std::uint64_t file_count;
+        std::uint64_t contribution_count;
+        std::uint64_t strings_size;
+        std::uint64_t stopwords_hash; // с каким набором стоп-слов проставлены флаги
+    };
+
+    struct WordRecord
+    {
+        std::uint64_t count;
+        std::uint64_t name_offset;
+        std::uint32_t name_length;
+        std::uint32_t length;
+        std::uint32_t stop;
+        std::uint32_t reserved;
+    };
+
+    struct FileRecord
+    {
+        std::uint64_t size;
+        std::int64_t mtime;
+        std::uint64_t content_hash;
+        std::uint64_t total_words;
+        std::uint64_t total_sentences;
+        std::uint64_t contribution_offset;
+        std::uint64_t path_offset;
+        std::uint64_t error_offset;
+        std::uint32_t contribution_count;
+        std::uint32_t path_length;
+        std::uint32_t error_length;
+        std::uint32_t ok;
+    };
+
+    struct ContributionRecord
+    {
+        std::uint32_t word;
+        std::uint32_t count;
+    };
+
+    static_assert(sizeof(Header) == 64 && sizeof(WordRecord) == 32 && sizeof(FileRecord) == 80 &&
+                  sizeof(ContributionRecord) == 8, "записи снапшота должны быть без выравнивающих дыр");
+
+    [[noreturn]] void corrupted(const std::string& path, const char* what)
+    {
+        throw std::runtime_error("Снапшот повреждён (" + std::string(what) + "): " + path);
+    }
+
+    template <typename T>
+    T read_record(std::string_view data, std::uint64_t offset)
+    {
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    // Размер и время изменения (нс) одним системным вызовом; false, если файла нет.
+    bool file_metadata(const std::string& path, std::uint64_t& size, std::int64_t& mtime)
+    {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0)
+            return false;
+        size = static_cast<std::uint64_t>(st.st_size);
+        mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        return true;
+    }
+
+    // Итог разбора одного нового или изменённого файла.
+    struct Outcome
+    {
+        enum class Kind { Touched, Analyzed, Failed };
+
+        Kind kind{Kind::Failed};
+        std::uint64_t size{0};
+        std::int64_t mtime{0};
+        std::uint64_t content_hash{0};
+        TextStats stats;
+        std::string error;
+    };
+}
+
+CorpusSnapshot CorpusSnapshot::load(const std::string& path)
+{
+    InputFile input(path);
+    std::string_view data = input.view();
+
+    if (data.size() < sizeof(Header))
+        corrupted(path, "нет заголовка");
+    Header header = read_record<Header>(data, 0);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        corrupted(path, "неверная сигнатура");
+    if (header.version != kVersion)
+        throw std::runtime_error("Снапшот записан несовместимой версией (" + std::to_string(header.version) +
+                                 "): " + path);
+
+    const std::uint64_t words_at = sizeof(Header);
+    const std::uint64_t files_at = words_at + header.word_count * sizeof(WordRecord);
+    const std::uint64_t contributions_at = files_at + header.file_count * sizeof(FileRecord);
+    const std::uint64_t strings_at = contributions_at + header.contribution_count * sizeof(ContributionRecord);
+    if (header.word_count > data.size() || header.file_count > data.size() ||
+        header.contribution_count > data.size() || strings_at + header.strings_size > data.size())
+        corrupted(path, "размеры секций");
+    const std::string_view strings = data.substr(strings_at, header.strings_size);
+
+    auto string_at = [&](std::uint64_t offset, std::uint32_t length) {
+        if (offset + length > strings.size())
+            corrupted(path, "строка за пределами данных");
+        return strings.substr(offset, length);
+    };
+
+    CorpusSnapshot snapshot;
+    snapshot.m_stats.total_words = header.total_words;
+    snapshot.m_stats.total_sentences = header.total_sentences;
+    snapshot.m_stopwords_hash = header.stopwords_hash;
+
+    Vocabulary& vocab = snapshot.m_stats.vocab;
+    vocab.reserve(header.word_count);
+    for (std::uint64_t i = 0; i < header.word_count; ++i)
+    {
+        WordRecord record = read_record<WordRecord>(data, words_at + i * sizeof(WordRecord));
+        auto [id, inserted] = vocab.intern(string_at(record.name_offset, record.name_length));
+        if (!inserted)
+            corrupted(path, "повтор слова");
+        vocab.set_count(id, record.count);
+        vocab.set_length(id, record.length);
+        vocab.set_stop(id, record.stop != 0);
+    }
+
+    static_assert(sizeof(Contribution) == sizeof(ContributionRecord), "вклады копируются в память как есть");
+    snapshot.m_contributions.resize(header.contribution_count);
+    if (header.contribution_count != 0)
+        std::memcpy(snapshot.m_contributions.data(), data.data() + contributions_at,
+                    header.contribution_count * sizeof(ContributionRecord));
+    for (const Contribution& c : snapshot.m_contributions)
+    {
+        if (c.word >= header.word_count)
+            corrupted(path, "неизвестное слово во вкладе");
+    }
+
+    snapshot.m_files.resize(header.file_count);
+    for (std::uint64_t i = 0; i < header.file_count; ++i)
+    {
+        FileRecord record = read_record<FileRecord>(data, files_at + i * sizeof(FileRecord));
+        if (record.contribution_offset + record.contribution_count > header.contribution_count)
+            corrupted(path, "вклад файла за пределами данных");
+
+        FileEntry& file = snapshot.m_files[i];
+        file.path = string_at(record.path_offset, record.path_length);
+        file.error = string_at(record.error_offset, record.error_length);
+        file.size = record.size;
+        file.mtime = record.mtime;
+        file.content_hash = record.content_hash;
+        file.ok = record.ok != 0;
+        file.total_words = record.total_words;
+        file.total_sentences = record.total_sentences;
+        file.contribution_offset = record.contribution_offset;
+        file.contribution_count = record.contribution_count;
+    }
+    return snapshot;
+}
+
+void CorpusSnapshot::save(const std::string& path) const
+{
+    const Vocabulary& vocab = m_stats.vocab;
+    std::string strings;
+    std::vector<WordRecord> words(vocab.size());
+    for (Vocabulary::Id id = 0; id < vocab.size(); ++id)
+    {
+        std::string_view word = vocab.word(id);
+        words[id] = WordRecord{vocab.count(id), strings.size(), static_cast<std::uint32_t>(word.size()),
+                               vocab.length(id), vocab.is_stop(id) ? 1u : 0u, 0};
+        strings.append(word);
+    }
+
+    std::vector<FileRecord> files(m_files.size());
+    std::vector<ContributionRecord> contributions;
+    contributions.reserve(m_contributions.size());
+    for (size_t i = 0; i < m_files.size(); ++i)
+    {
+        const FileEntry& file = m_files[i];
+        FileRecord& record = files[i];
+        record = FileRecord{};
+        record.size = file.size;
+        record.mtime = file.mtime;
+        record.content_hash = file.content_hash;
+        record.total_words = file.total_words;
+        record.total_sentences = file.total_sentences;
+        record.ok = file.ok ? 1 : 0;
+        record.contribution_offset = contributions.size();
+        record.contribution_count = file.contribution_count;
+        for (std::uint32_t k = 0; k < file.contribution_count; ++k)
+        {
+            const Contribution& c = m_contributions[file.contribution_offset + k];
+            contributions.push_back(ContributionRecord{c.word, c.count});
+        }
+        record.path_offset = strings.size();
+        record.path_length = static_cast<std::uint32_t>(file.path.size());
+        strings.append(file.path);
+        record.error_offset = strings.size();
+        record.error_length = static_cast<std::uint32_t>(file.error.size());
+        strings.append(file.error);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.total_words = m_stats.total_words;
+    header.total_sentences = m_stats.total_sentences;
+    header.word_count = words.size();
+    header.file_count = files.size();
+    header.contribution_count = contributions.size();
+    header.strings_size = strings.size();
+    header.stopwords_hash = m_stopwords_hash;
+
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("Не удалось открыть файл для записи: " + tmp_path);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(words.data()),
+                  static_cast<std::streamsize>(words.size() * sizeof(WordRecord)));
+        out.write(reinterpret_cast<const char*>(files.data()),
+                  static_cast<std::streamsize>(files.size() * sizeof(FileRecord)));
+        out.write(reinterpret_cast<const char*>(contributions.data()),
+                  static_cast<std::streamsize>(contributions.size() * sizeof(ContributionRecord)));
+        out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        if (!out.flush())
+            throw std::runtime_error("Не удалось записать снапшот: " + tmp_path);
+    }
+    std::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    if (ec)
+        throw std::runtime_error("Не удалось заменить снапшот " + path + ": " + ec.message());
+}
+
+void CorpusSnapshot::subtract(const FileEntry& file)
+{
+    Vocabulary& vocab = m_stats.vocab;
+    for (std::uint32_t k = 0; k < file.contribution_count; ++k)
+    {
+        const Contribution& c = m_contributions[file.contribution_offset + k];
+        vocab.set_count(c.word, vocab.count(c.word) - c.count);
+    }
+    m_stats.total_words -= file.total_words;
+    m_stats.total_sentences -= file.total_sentences;
+}
+
+void CorpusSnapshot::add(FileEntry& file, const TextStats& stats)
+{
+    Vocabulary& vocab = m_stats.vocab;
+    file.contribution_offset = m_contributions.size();
+    for (Vocabulary::Id local = 0; local < stats.vocab.size(); ++local)
+    {
+        const std::uint64_t count = stats.vocab.count(local);
+        if (count == 0)
+            continue;
+        auto [id, inserted] = vocab.intern(stats.vocab.word(local));
+        if (inserted)
+        {
+            vocab.set_length(id, stats.vocab.length(local));
+            vocab.set_stop(id, stats.vocab.is_stop(local));
+        }
+        vocab.add(id, count);
+        m_contributions.push_back(Contribution{id, static_cast<std::uint32_t>(count)});
+    }
+    file.contribution_count = static_cast<std::uint32_t>(m_contributions.size() - file.contribution_offset);
+    file.total_words = stats.total_words;
+    file.total_sentences = stats.total_sentences;
+    m_stats.total_words += stats.total_words;
+    m_stats.total_sentences += stats.total_sentences;
+}
+
+CorpusSnapshot::UpdateSummary CorpusSnapshot::update(const std::vector<std::string>& files,
+                                                     const StopwordSet& stopwords,
+                                                     size_t threads)
+{
+    UpdateSummary summary;
+
+    std::unordered_map<std::string_view, size_t> known;
+    known.reserve(m_files.size());
+    for (size_t i = 0; i < m_files.size(); ++i)
+        known.emplace(m_files[i].path, i);
+
+    // Быстрая проверка по метаданным: читать нужно только новые файлы и те,
+    // у которых сменились размер или время изменения.
+    std::vector<bool> seen(m_files.size(), false);
+    std::vector<std::string> pending;
+    std::vector<size_t> pending_entry; // индекс в m_files или npos для новых
+    constexpr size_t npos = static_cast<size_t>(-1);
+    for (const std::string& path : files)
+    {
+        auto it = known.find(path);
+        if (it != known.end() && it->second == npos)
+            continue; // новый путь указан повторно
+        size_t entry = it == known.end() ? npos : it->second;
+        if (entry != npos)
+        {
+            if (seen[entry])
+                continue; // путь указан повторно
+            seen[entry] = true;
+            std::uint64_t size = 0;
+            std::int64_t mtime = 0;
+            if (file_metadata(path, size, mtime) && size == m_files[entry].size && mtime == m_files[entry].mtime)
+            {
+                ++summary.unchanged;
+                continue;
+            }
+        }
+        else
+        {
+            known.emplace(path, npos);
+        }
+        pending.push_back(path);
+        pending_entry.push_back(entry);
+    }
+
+    std::vector<Outcome> outcomes(pending.size());
+    WorkStealingPool pool(threads);
+    struct WorkerState
+    {
+        explicit WorkerState(const StopwordSet& stopwords) : analyzer(stopwords) {}
+
+        StreamingAnalyzer analyzer;
+        json::Tape tape;
+        InputFile input;
+    };
+    std::vector<std::unique_ptr<WorkerState>> workers;
+    for (size_t i = 0; i < pool.thread_count(); ++i)
+        workers.push_back(std::make_unique<WorkerState>(stopwords));
+
+    pool.run(pending.size(), [&](size_t worker, size_t task) {
+        WorkerState& state = *workers[worker];
+        Outcome& outcome = outcomes[task];
+        const std::string& path = pending[task];
+        try
+        {
+            std::uint64_t size = 0;
+            file_metadata(path, size, outcome.mtime);
+            state.input.open(path);
+            std::string_view content = state.input.view();
+            outcome.size = content.size();
+            outcome.content_hash = Vocabulary::hash(content);
+
+            const size_t entry = pending_entry[task];
+            if (entry != npos && m_files[entry].content_hash == outcome.content_hash &&
+                m_files[entry].size == outcome.size)
+            {
+                outcome.kind = Outcome::Kind::Touched;
+                return;
+            }
+
+            json::Parser parser(content);
+            parser.parse(state.tape);
+            std::vector<std::string_view> blocks = extract_text_blocks(state.tape);
+            if (blocks.empty())
+            {
+                outcome.error = "не найден текст (\"text\" или массив параграфов)";
+                return;
+            }
+            for (std::string_view block : blocks)
+            {
+                state.analyzer.feed(block);
+                state.analyzer.end_block();
+            }
+            outcome.stats = state.analyzer.finish(false);
+            outcome.kind = Outcome::Kind::Analyzed;
+        }
+        catch (const std::exception& e)
+        {
+            // Разбор мог оборваться посреди файла: частичный вклад отбрасывается.
+            state.analyzer.finish(false);
+            outcome.kind = Outcome::Kind::Failed;
+            outcome.error = e.what();
+        }
+    });
+
+    // Вклады сливаются последовательно: id слов общего словаря не зависят от потоков.
+    for (size_t i = 0; i < m_files.size(); ++i)
+    {
+        if (!seen[i])
+        {
+            subtract(m_files[i]);
+            ++summary.removed;
+        }
+    }
+    for (size_t task = 0; task < pending.size(); ++task)
+    {
+        Outcome& outcome = outcomes[task];
+        const size_t entry = pending_entry[task];
+        if (entry == npos)
+        {
+            m_files.push_back(FileEntry{});
+            m_files.back().path = pending[task];
+            seen.push_back(true);
+            ++summary.added;
+        }
+        else if (outcome.kind == Outcome::Kind::Touched)
+        {
+            ++summary.touched;
+            ++summary.unchanged;
+        }
+        else
+        {
+            subtract(m_files[entry]);
+            ++summary.changed;
+        }
+
+        FileEntry& file = m_files[entry == npos ? m_files.size() - 1 : entry];
+        file.mtime = outcome.mtime;
+        file.size = outcome.size;
+        file.content_hash = outcome.content_hash;
+        if (outcome.kind == Outcome::Kind::Touched)
+            continue;
+
+        file.ok = outcome.kind == Outcome::Kind::Analyzed;
+        file.error = outcome.error;
+        if (file.ok)
+        {
+            add(file, outcome.stats);
+        }
+        else
+        {
+            file.contribution_count = 0;
+            file.total_words = 0;
+            file.total_sentences = 0;
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < m_files.size(); ++i)
+    {
+        if (!seen[i])
+            continue;
+        if (kept != i)
+            m_files[kept] = std::move(m_files[i]);
+        ++kept;
+    }
+    m_files.resize(kept);
+    std::sort(m_files.begin(), m_files.end(),
+              [](const FileEntry& a, const FileEntry& b) { return a.path < b.path; });
+
+    // Новые слова получили флаги от анализатора; весь словарь пересматривается,
+    // только если сменился набор стоп-слов.
+    const std::uint64_t stopwords_hash = stopwords.fingerprint();
+    if (stopwords_hash != m_stopwords_hash)
+    {
+        Vocabulary& vocab = m_stats.vocab;
+        for (Vocabulary::Id id = 0; id < vocab.size(); ++id)
+            vocab.set_stop(id, stopwords.contains(vocab.word(id)));
+        m_stopwords_hash = stopwords_hash;
+    }
+
+    return summary;
+}
+
+BatchResult CorpusSnapshot::result() const
+{
+    BatchResult result;
+    result.stats = m_stats;
+    build_ordered_views(result.stats);
+    result.files_total = m_files.size();
+    for (const FileEntry& file : m_files)
+    {
+        if (file.ok)
+            ++result.files_ok;
+        else
+            result.failed.push_back(FileError{file.path, file.error});
+    }
+    return result;
+}
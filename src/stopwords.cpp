@@ -0,0 +1,173 @@
+#include "stopwords.hpp"
+#include "vocabulary.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr char kMagic[4] = {'T', 'F', 'S', 'W'};
+    // Версия меняется вместе с форматом или хеш-функцией (Vocabulary::hash).
+    constexpr std::uint32_t kVersion = 1;
+
+    size_t align4(size_t n)
+    {
+        return (n + 3) & ~size_t{3};
+    }
+}
+
+StopwordSet::StopwordSet()
+    : StopwordSet(std::vector<std::string>{})
+{
+}
+
+StopwordSet::StopwordSet(const std::vector<std::string>& words)
+{
+    std::vector<std::string_view> unique(words.begin(), words.end());
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    unique.erase(std::remove(unique.begin(), unique.end(), std::string_view{}), unique.end());
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.count = static_cast<std::uint32_t>(unique.size());
+    header.slot_count = 4;
+    while (header.slot_count < 2 * unique.size())
+        header.slot_count *= 2;
+
+    std::vector<Slot> slots(header.slot_count, Slot{0, 0, 0});
+    std::string bytes;
+    const size_t mask = header.slot_count - 1;
+    for (std::string_view word : unique)
+    {
+        const std::uint64_t h = Vocabulary::hash(word);
+        size_t i = h & mask;
+        while (slots[i].length != 0)
+            i = (i + 1) & mask;
+        slots[i] = Slot{static_cast<std::uint32_t>(h >> 32), static_cast<std::uint32_t>(bytes.size()),
+                        static_cast<std::uint32_t>(word.size())};
+        bytes.append(word);
+
+        header.length_mask |= std::uint64_t{1} << std::min<size_t>(word.size(), 63);
+        const auto first = static_cast<unsigned char>(word[0]);
+        header.first_bytes[first >> 6] |= std::uint64_t{1} << (first & 63);
+    }
+    header.bytes_size = bytes.size();
+
+    const size_t slots_size = slots.size() * sizeof(Slot);
+    m_owned.resize(sizeof(Header) + slots_size + align4(bytes.size()), 0);
+    std::memcpy(m_owned.data(), &header, sizeof(Header));
+    std::memcpy(m_owned.data() + sizeof(Header), slots.data(), slots_size);
+    if (!bytes.empty())
+        std::memcpy(m_owned.data() + sizeof(Header) + slots_size, bytes.data(), bytes.size());
+    attach(std::string_view(m_owned.data(), m_owned.size()));
+}
+
+StopwordSet::StopwordSet(StopwordSet&&) noexcept = default;
+StopwordSet& StopwordSet::operator=(StopwordSet&&) noexcept = default;
+StopwordSet::~StopwordSet() = default;
+
+void StopwordSet::attach(std::string_view data)
+{
+    if (data.size() < sizeof(Header) || !is_binary(data))
+        throw std::runtime_error("Файл стоп-слов повреждён: неверная сигнатура.");
+
+    Header header;
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (header.version != kVersion)
+        throw std::runtime_error("Файл стоп-слов записан несовместимой версией (" +
+                                 std::to_string(header.version) + ").");
+
+    const std::uint64_t slots_size = std::uint64_t{header.slot_count} * sizeof(Slot);
+    const bool power_of_two = header.slot_count != 0 && (header.slot_count & (header.slot_count - 1)) == 0;
+    if (!power_of_two || header.count > header.slot_count / 2 ||
+        sizeof(Header) + slots_size + header.bytes_size > data.size())
+        throw std::runtime_error("Файл стоп-слов повреждён: размеры таблиц не сходятся.");
+
+    const auto* slots = reinterpret_cast<const Slot*>(data.data() + sizeof(Header));
+    std::uint32_t occupied = 0;
+    for (std::uint32_t i = 0; i < header.slot_count; ++i)
+    {
+        if (std::uint64_t{slots[i].offset} + slots[i].length > header.bytes_size)
+            throw std::runtime_error("Файл стоп-слов повреждён: слово за пределами данных.");
+        occupied += slots[i].length != 0;
+    }
+    // Свободные слоты обязательны: на них останавливается поиск.
+    if (occupied != header.count)
+        throw std::runtime_error("Файл стоп-слов повреждён: число слов не сходится.");
+
+    m_header = header;
+    m_slots = slots;
+    m_bytes = data.data() + sizeof(Header) + slots_size;
+    m_data = data;
+}
+
+bool StopwordSet::is_binary(std::string_view data) noexcept
+{
+    return data.size() >= sizeof(kMagic) && std::memcmp(data.data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+StopwordSet StopwordSet::load(const std::string& path)
+{
+    StopwordSet set;
+    set.m_file = std::make_unique<InputFile>(path);
+    set.m_owned.clear();
+    set.m_owned.shrink_to_fit();
+    set.attach(set.m_file->view());
+    return set;
+}
+
+void StopwordSet::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        throw std::runtime_error("Не удалось открыть файл для записи: " + path);
+    out.write(m_data.data(), static_cast<std::streamsize>(m_data.size()));
+    if (!out)
+        throw std::runtime_error("Не удалось записать файл стоп-слов: " + path);
+}
+
+bool StopwordSet::lookup(std::string_view word) const noexcept
+{
+    const std::uint64_t h = Vocabulary::hash(word);
+    const std::uint32_t tag = static_cast<std::uint32_t>(h >> 32);
+    const size_t mask = m_header.slot_count - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask)
+    {
+        const Slot& slot = m_slots[i];
+        if (slot.length == 0)
+            return false;
+        if (slot.tag == tag && slot.length == word.size() &&
+            std::memcmp(m_bytes + slot.offset, word.data(), word.size()) == 0)
+            return true;
+    }
+}
+
+std::vector<std::string> StopwordSet::words() const
+{
+    std::vector<std::string> result;
+    result.reserve(m_header.count);
+    for (std::uint32_t i = 0; i < m_header.slot_count; ++i)
+    {
+        if (m_slots[i].length != 0)
+            result.emplace_back(m_bytes + m_slots[i].offset, m_slots[i].length);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::uint64_t StopwordSet::fingerprint() const
+{
+    std::string joined;
+    for (const std::string& word : words())
+        joined.append(word).push_back('\n');
+    return Vocabulary::hash(joined);
+}
+
+bool StopwordSet::mapped() const noexcept
+{
+    return m_file && m_file->mapped();
+}
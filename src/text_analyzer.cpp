@@ -1,69 +1,14 @@
 #include "text_analyzer.hpp"
+#include "external_count.hpp"
+#include "profile.hpp"
+#include "unicode.hpp"
+#include "work_stealing_pool.hpp"
 
 #include <algorithm>
-#include <cctype>
-#include <set>
+#include <iomanip>
+#include <memory>
 #include <sstream>
-
-namespace
-{
-    std::string to_lower(const std::string& s)
-    {
-        std::string res;
-        res.reserve(s.size());
-        for (unsigned char c : s)
-        {
-            res.push_back(static_cast<char>(std::tolower(c)));
-        }
-        return res;
-    }
-
-    bool is_word_char(char c)
-    {
-        return std::isalpha(static_cast<unsigned char>(c)) || std::isdigit(static_cast<unsigned char>(c)) || c == '\'';
-    }
-
-    bool is_sentence_end(char c)
-    {
-        return c == '.' || c == '!' || c == '?';
-    }
-
-    void collect_words_and_sentences(const std::vector<std::string>& blocks,
-                                     std::vector<std::string>& words,
-                                     size_t& sentence_count)
-    {
-        for (const auto& block : blocks)
-        {
-            bool in_word = false;
-            std::string current;
-            for (char ch : block)
-            {
-                if (is_word_char(ch))
-                {
-                    in_word = true;
-                    current.push_back(ch);
-                }
-                else
-                {
-                    if (in_word)
-                    {
-                        words.push_back(to_lower(current));
-                        current.clear();
-                        in_word = false;
-                    }
-                    if (is_sentence_end(ch))
-                    {
-                        ++sentence_count;
-                    }
-                }
-            }
-            if (in_word && !current.empty())
-            {
-                words.push_back(to_lower(current));
-            }
-        }
-    }
-}
+#include <stdexcept>
 
 std::vector<std::string> extract_text_blocks(const json::Value& root)
 {
@@ -100,6 +45,71 @@ std::vector<std::string> extract_text_blocks(const json::Value& root)
     return blocks;
 }
 
+std::vector<std::string_view> extract_text_blocks(const json::Tape& tape)
+{
+    using json::NodeType;
+
+    std::vector<std::string_view> blocks;
+    if (tape.empty())
+        return blocks;
+
+    const size_t root = json::Tape::root();
+    if (tape[root].type == NodeType::Object)
+    {
+        auto it = tape.find(root, "text");
+        if (it && tape[*it].type == NodeType::String)
+        {
+            blocks.push_back(tape[*it].str);
+        }
+    }
+    else if (tape[root].type == NodeType::Array)
+    {
+        for (size_t i = root + 1; i < tape.next(root); i = tape.next(i))
+        {
+            if (tape[i].type == NodeType::String)
+            {
+                blocks.push_back(tape[i].str);
+            }
+            else if (tape[i].type == NodeType::Object)
+            {
+                auto it = tape.find(i, "paragraph");
+                if (it && tape[*it].type == NodeType::String)
+                {
+                    blocks.push_back(tape[*it].str);
+                }
+            }
+        }
+    }
+    return blocks;
+}
+
+std::vector<std::string> extract_stopwords(const json::Tape& tape)
+{
+    using json::NodeType;
+
+    std::vector<std::string> stops;
+    const size_t root = json::Tape::root();
+    if (tape.empty() || tape[root].type != NodeType::Array)
+        return stops;
+
+    for (size_t i = root + 1; i < tape.next(root); i = tape.next(i))
+    {
+        if (tape[i].type == NodeType::String)
+        {
+            stops.push_back(unicode::to_lower(tape[i].str));
+        }
+        else if (tape[i].type == NodeType::Object)
+        {
+            auto it = tape.find(i, "stop");
+            if (it && tape[*it].type == NodeType::String)
+            {
+                stops.push_back(unicode::to_lower(tape[*it].str));
+            }
+        }
+    }
+    return stops;
+}
+
 std::vector<std::string> extract_stopwords(const json::Value& root)
 {
     std::vector<std::string> stops;
@@ -110,7 +120,7 @@ std::vector<std::string> extract_stopwords(const json::Value& root)
         {
             if (std::holds_alternative<std::string>(v.data))
             {
-                stops.push_back(to_lower(std::get<std::string>(v.data)));
+                stops.push_back(unicode::to_lower(std::get<std::string>(v.data)));
             }
             else if (std::holds_alternative<json::Object>(v.data))
             {
@@ -118,7 +128,7 @@ std::vector<std::string> extract_stopwords(const json::Value& root)
                 auto it = obj.find("stop");
                 if (it != obj.end() && std::holds_alternative<std::string>(it->second.data))
                 {
-                    stops.push_back(to_lower(std::get<std::string>(it->second.data)));
+                    stops.push_back(unicode::to_lower(std::get<std::string>(it->second.data)));
                 }
             }
         }
@@ -126,86 +136,506 @@ std::vector<std::string> extract_stopwords(const json::Value& root)
     return stops;
 }
 
+StopwordSet load_stopword_file(const std::string& path)
+{
+    InputFile file(path);
+    if (StopwordSet::is_binary(file.view()))
+    {
+        file.close();
+        return StopwordSet::load(path);
+    }
+    json::Parser parser(file.view());
+    json::Tape tape;
+    parser.parse(tape);
+    return StopwordSet(extract_stopwords(tape));
+}
+
 TextStats analyze_text(const std::vector<std::string>& blocks,
                        const std::vector<std::string>& stopwords)
 {
-    TextStats stats;
+    return analyze_text(std::vector<std::string_view>(blocks.begin(), blocks.end()), stopwords);
+}
+
+TextStats analyze_text(const std::vector<std::string_view>& blocks,
+                       const std::vector<std::string>& stopwords)
+{
+    return analyze_text(blocks, StopwordSet(stopwords));
+}
 
-    std::vector<std::string> words;
-    collect_words_and_sentences(blocks, words, stats.total_sentences);
-    stats.total_words = words.size();
+TextStats analyze_text(const std::vector<std::string>& blocks, const StopwordSet& stopwords)
+{
+    return analyze_text(std::vector<std::string_view>(blocks.begin(), blocks.end()), stopwords);
+}
 
-    std::set<std::string> stopset(stopwords.begin(), stopwords.end());
-    std::set<std::string> uniq;
+TextStats analyze_text(const std::vector<std::string_view>& blocks, const StopwordSet& stopwords)
+{
+    StreamingAnalyzer analyzer(stopwords);
+    for (std::string_view block : blocks)
+    {
+        analyzer.feed(block);
+        analyzer.end_block();
+    }
+    return analyzer.finish();
+}
 
-    for (const auto& w : words)
+std::vector<std::string_view> split_at_word_boundaries(std::string_view block, size_t chunk_bytes)
+{
+    std::vector<std::string_view> chunks;
+    chunk_bytes = std::max<size_t>(chunk_bytes, 1);
+    size_t begin = 0;
+    while (block.size() - begin > chunk_bytes)
     {
-        ++stats.word_freq[w];
-        if (!stopset.count(w))
+        size_t cut = begin + chunk_bytes;
+        // Режем после байта, который сам по себе завершает слово: это ASCII
+        // не из класса слов, значит и символ UTF-8 на границе не разрезан.
+        while (cut < block.size())
         {
-            ++stats.word_freq_no_stops[w];
+            unsigned char prev = static_cast<unsigned char>(block[cut - 1]);
+            if (prev < 0x80 && tokenizer::kTables.cls[prev] != tokenizer::Word)
+                break;
+            ++cut;
         }
-        ++stats.length_distribution[w.size()];
-        uniq.insert(w);
+        chunks.push_back(block.substr(begin, cut - begin));
+        begin = cut;
     }
+    if (begin < block.size() || chunks.empty())
+        chunks.push_back(block.substr(begin));
+    return chunks;
+}
 
-    stats.unique_words = uniq.size();
-    return stats;
+TextStats analyze_text_parallel(const std::vector<std::string_view>& blocks,
+                                const std::vector<std::string>& stopwords,
+                                size_t threads,
+                                size_t chunk_bytes)
+{
+    return analyze_text_parallel(blocks, StopwordSet(stopwords), threads, chunk_bytes);
+}
+
+TextStats analyze_text_parallel(const std::vector<std::string_view>& blocks,
+                                const StopwordSet& stopwords,
+                                size_t threads,
+                                size_t chunk_bytes)
+{
+    WorkStealingPool pool(threads);
+    if (pool.thread_count() == 1)
+        return analyze_text(blocks, stopwords);
+
+    if (chunk_bytes == 0)
+    {
+        // Несколько кусков на поток для балансировки, но не мельче 1 МБ.
+        size_t total = 0;
+        for (std::string_view block : blocks)
+            total += block.size();
+        chunk_bytes = std::max<size_t>(total / (pool.thread_count() * 8), size_t{1} << 20);
+    }
+
+    std::vector<std::string_view> chunks;
+    for (std::string_view block : blocks)
+    {
+        std::vector<std::string_view> pieces = split_at_word_boundaries(block, chunk_bytes);
+        chunks.insert(chunks.end(), pieces.begin(), pieces.end());
+    }
+
+    // Мелкие блоки (абзацы) объединяются в задачи примерно по chunk_bytes.
+    std::vector<size_t> task_begin;
+    size_t task_bytes = chunk_bytes;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        if (task_bytes >= chunk_bytes)
+        {
+            task_begin.push_back(i);
+            task_bytes = 0;
+        }
+        task_bytes += chunks[i].size() + 1;
+    }
+    task_begin.push_back(chunks.size());
+
+    std::vector<std::unique_ptr<StreamingAnalyzer>> analyzers;
+    for (size_t i = 0; i < pool.thread_count(); ++i)
+        analyzers.push_back(std::make_unique<StreamingAnalyzer>(stopwords));
+
+    // Каждый кусок кончается на разделителе, поэтому end_block после него
+    // ничего не меняет, а счёт предложений не зависит от того, где прошёл разрез.
+    pool.run(task_begin.size() - 1, [&](size_t worker, size_t task) {
+        for (size_t i = task_begin[task]; i < task_begin[task + 1]; ++i)
+        {
+            analyzers[worker]->feed(chunks[i]);
+            analyzers[worker]->end_block();
+        }
+    });
+
+    std::vector<TextStats> partial;
+    partial.reserve(analyzers.size());
+    for (auto& analyzer : analyzers)
+        partial.push_back(analyzer->finish(false));
+
+    // Попарное слияние деревом: log2(потоков) раундов, пары раунда — параллельно.
+    for (size_t stride = 1; stride < partial.size(); stride *= 2)
+    {
+        const size_t pairs = (partial.size() + 2 * stride - 1) / (2 * stride);
+        pool.run(pairs, [&](size_t, size_t pair) {
+            size_t into = pair * 2 * stride;
+            if (into + stride < partial.size())
+            {
+                merge_stats(partial[into], partial[into + stride], false);
+                partial[into + stride] = TextStats{};
+            }
+        });
+    }
+
+    TextStats result = std::move(partial.front());
+    build_ordered_views(result);
+    return result;
+}
+
+void build_ordered_views(TextStats& stats)
+{
+    profile::ScopedTimer timer(profile::Stage::Views);
+    stats.length_distribution.clear();
+    stats.unique_words = 0;
+
+    // Один проход по столбцам словаря; длины копятся в плотном массиве, а в
+    // карту попадает только по записи на встретившуюся длину.
+    const Vocabulary& vocab = stats.vocab;
+    std::vector<size_t> by_length;
+    for (Vocabulary::Id id = 0; id < vocab.size(); ++id)
+    {
+        const size_t count = vocab.count(id);
+        if (count == 0)
+            continue;
+        ++stats.unique_words;
+        const size_t length = vocab.length(id);
+        if (length >= by_length.size())
+            by_length.resize(length + 1, 0);
+        by_length[length] += count;
+    }
+    for (size_t length = 0; length < by_length.size(); ++length)
+    {
+        if (by_length[length] != 0)
+            stats.length_distribution.emplace_hint(stats.length_distribution.end(), length, by_length[length]);
+    }
+}
+
+void build_word_maps(TextStats& stats)
+{
+    stats.word_freq.clear();
+    stats.word_freq_no_stops.clear();
+    const Vocabulary& vocab = stats.vocab;
+    for (Vocabulary::Id id = 0; id < vocab.size(); ++id)
+    {
+        const size_t count = vocab.count(id);
+        if (count == 0)
+            continue;
+        std::string word(vocab.word(id));
+        if (!vocab.is_stop(id))
+            stats.word_freq_no_stops.emplace(word, count);
+        stats.word_freq.emplace(std::move(word), count);
+    }
+}
+
+StreamingAnalyzer::StreamingAnalyzer(const std::vector<std::string>& stopwords)
+    : m_stops(std::make_shared<const StopwordSet>(stopwords))
+{
+}
+
+StreamingAnalyzer::StreamingAnalyzer(const StopwordSet& stopwords)
+    : m_stops(std::shared_ptr<const StopwordSet>(), &stopwords)
+{
+}
+
+void StreamingAnalyzer::on_word(std::string_view word, size_t length)
+{
+    // Таблица внешнего подсчёта сбрасывается до вставки, которая вышла бы за
+    // бюджет: новое слово может потребовать новый блок арены (до 64 КБ).
+    if (m_spill && (m_stats.vocab.size() >= m_spill_words ||
+                    m_stats.vocab.arena_bytes() + std::max<size_t>(64 * 1024, word.size()) > m_spill_arena))
+        spill();
+
+    // Одна операция с хеш-таблицей на слово; стоп-флаг и длина
+    // определяются только при первом появлении слова.
+    auto [id, inserted] = m_stats.vocab.intern(word);
+    if (inserted)
+    {
+        m_stats.vocab.set_stop(id, m_stops->contains(word));
+        m_stats.vocab.set_length(id, static_cast<std::uint32_t>(length));
+    }
+    m_stats.vocab.add(id);
+    ++m_stats.total_words;
+}
+
+void StreamingAnalyzer::feed(std::string_view chunk)
+{
+    if (profile::enabled())
+        profile::thread_word_buffer().feed(m_tokenizer, chunk, *this);
+    else
+        m_tokenizer.feed(chunk, *this);
+}
+
+void StreamingAnalyzer::end_block()
+{
+    if (profile::enabled())
+        profile::thread_word_buffer().end_block(m_tokenizer, *this);
+    else
+        m_tokenizer.end_block(*this);
+}
+
+TextStats StreamingAnalyzer::finish(bool with_views)
+{
+    end_block();
+    profile::add(profile::Counter::HashProbes, m_stats.vocab.probes());
+    if (m_spill)
+    {
+        // Остаток таблицы — последний прогон; её память освобождается сразу,
+        // до слияния прогонов.
+        m_spill->spill(m_stats.vocab, m_spill_order);
+        m_stats.vocab = Vocabulary();
+        m_spill_order = std::vector<Vocabulary::Id>();
+        m_spill = nullptr;
+    }
+    if (with_views)
+        build_ordered_views(m_stats);
+    TextStats result = std::move(m_stats);
+    m_stats = TextStats{};
+    return result;
+}
+
+void StreamingAnalyzer::spill_to(ExternalCounter& counter, size_t memory_limit)
+{
+    if (memory_limit < ExternalCounter::kMinLimit)
+        throw std::runtime_error("Бюджет памяти внешнего подсчёта на анализатор должен быть не меньше " +
+                                 std::to_string(ExternalCounter::kMinLimit / 1024) + " КБ.");
+    // Буфер записи прогона — из бюджета; до половины остатка — таблица со
+    // столбцами и массивом порядка для сортировки, остальное — строки в арене.
+    // Слов в таблице на одно меньше половины слотов: reserve не удваивает таблицу.
+    const size_t budget = memory_limit - ExternalCounter::kIoBuffer;
+    auto table = [](size_t words) { return Vocabulary::table_bytes(words) + words * sizeof(Vocabulary::Id); };
+    size_t words = 31;
+    while (table(2 * words + 1) <= budget / 2)
+        words = 2 * words + 1;
+
+    m_spill = &counter;
+    m_spill_words = words;
+    m_spill_arena = budget - table(words);
+    m_spill_order.reserve(words);
+    m_stats.vocab.reserve(words);
+}
+
+void StreamingAnalyzer::spill()
+{
+    m_spill->spill(m_stats.vocab, m_spill_order);
+    m_stats.vocab.clear();
+    m_stats.vocab.reserve(m_spill_words);
+}
+
+TextBlockExtractor::TextBlockExtractor(TextSink& sink)
+    : m_sink(sink)
+{
+}
+
+void TextBlockExtractor::value_seen()
+{
+    if (m_depth == 0 && m_root == Root::None)
+        m_root = Root::Other;
+    m_capture_next = false;
+}
+
+bool TextBlockExtractor::on_string_begin()
+{
+    bool wanted = m_capture_next || (m_root == Root::Array && m_depth == 1);
+    value_seen();
+    if (wanted)
+        ++m_blocks;
+    return wanted;
+}
+
+void TextBlockExtractor::on_string_chunk(std::string_view chunk)
+{
+    m_sink.feed(chunk);
+}
+
+void TextBlockExtractor::on_string_end()
+{
+    m_sink.end_block();
+}
+
+void TextBlockExtractor::on_key(std::string_view key)
+{
+    bool target = (m_root == Root::Object && m_depth == 1 && key == "text") ||
+                  (m_root == Root::Array && m_depth == 2 && key == "paragraph");
+    m_capture_next = target && !m_key_taken;
+    if (target)
+        m_key_taken = true;
+}
+
+void TextBlockExtractor::on_object_begin()
+{
+    if (m_depth == 0 && m_root == Root::None)
+        m_root = Root::Object;
+    m_capture_next = false;
+    ++m_depth;
+    if (m_depth == 1 || (m_depth == 2 && m_root == Root::Array))
+        m_key_taken = false;
+}
+
+void TextBlockExtractor::on_array_begin()
+{
+    if (m_depth == 0 && m_root == Root::None)
+        m_root = Root::Array;
+    m_capture_next = false;
+    ++m_depth;
+}
+
+void merge_stats(TextStats& into, const TextStats& from, bool rebuild_views)
+{
+    profile::ScopedTimer timer(profile::Stage::Merge);
+    const std::uint64_t probes = into.vocab.probes();
+    into.total_words += from.total_words;
+    into.total_sentences += from.total_sentences;
+    into.vocab.merge(from.vocab);
+    profile::add(profile::Counter::HashProbes, into.vocab.probes() - probes);
+    if (rebuild_views)
+        build_ordered_views(into);
+}
+
+namespace
+{
+    // Порядок строк отчёта: частота по убыванию, затем слово по возрастанию.
+    bool ranks_higher(const WordCount& a, const WordCount& b)
+    {
+        if (a.count != b.count)
+            return a.count > b.count;
+        return a.word < b.word;
+    }
+
+    // Ограниченная куча из k лучших строк; на вершине — худшая из них,
+    // поэтому большинство кандидатов отсекается одним сравнением частот.
+    class TopKHeap
+    {
+    public:
+        explicit TopKHeap(size_t k) : m_k(k) {}
+
+        void reserve(size_t n) { m_items.reserve(std::min(m_k, n)); }
+
+        void offer(std::string_view word, size_t count)
+        {
+            if (m_items.size() < m_k)
+            {
+                m_items.push_back({ word, count });
+                std::push_heap(m_items.begin(), m_items.end(), ranks_higher);
+                return;
+            }
+            if (m_k == 0 || count < m_items.front().count)
+                return;
+            WordCount candidate{ word, count };
+            if (!ranks_higher(candidate, m_items.front()))
+                return;
+            std::pop_heap(m_items.begin(), m_items.end(), ranks_higher);
+            m_items.back() = candidate;
+            std::push_heap(m_items.begin(), m_items.end(), ranks_higher);
+        }
+
+        std::vector<WordCount> take()
+        {
+            std::sort_heap(m_items.begin(), m_items.end(), ranks_higher);
+            return std::move(m_items);
+        }
+
+    private:
+        size_t m_k;
+        std::vector<WordCount> m_items;
+    };
+
+    void print_top(std::ostringstream& out, const char* noun, const char* column, const char* title,
+                   size_t top_n, const std::vector<WordCount>& rows)
+    {
+        out << "Топ " << top_n << " " << noun << " (" << title << "):\n";
+        out << "----------------------------------------\n";
+        out << column << std::string(22 - std::min<size_t>(unicode::code_points(column), 22), ' ') << "| Частота\n";
+        out << "----------------------------------------\n";
+        for (const auto& row : rows)
+        {
+            out << row.word << std::string(22 - std::min<size_t>(unicode::code_points(row.word), 22), ' ')
+                << "| " << row.count << "\n";
+        }
+        out << "----------------------------------------\n\n";
+    }
+}
+
+TopWords top_words(const TextStats& stats, size_t top_n)
+{
+    profile::ScopedTimer timer(profile::Stage::TopK);
+    TopKHeap all(top_n);
+    TopKHeap no_stops(top_n);
+
+    if (!stats.vocab.empty() || stats.word_freq.empty())
+    {
+        const Vocabulary& vocab = stats.vocab;
+        all.reserve(vocab.size());
+        no_stops.reserve(vocab.size());
+        for (Vocabulary::Id id = 0; id < vocab.size(); ++id)
+        {
+            const size_t count = vocab.count(id);
+            if (count == 0)
+                continue;
+            all.offer(vocab.word(id), count);
+            if (!vocab.is_stop(id))
+                no_stops.offer(vocab.word(id), count);
+        }
+    }
+    else
+    {
+        for (const auto& [word, count] : stats.word_freq)
+            all.offer(word, count);
+        for (const auto& [word, count] : stats.word_freq_no_stops)
+            no_stops.offer(word, count);
+    }
+
+    return { all.take(), no_stops.take() };
 }
 
 std::string format_report(const TextStats& stats, size_t top_n)
 {
+    profile::ScopedTimer timer(profile::Stage::ReportFormat);
     std::ostringstream out;
 
     out << "=== Частотный анализ текста ===\n\n";
     out << "Всего слов: " << stats.total_words << "\n";
     out << "Всего предложений: " << stats.total_sentences << "\n";
-    out << "Уникальных слов: " << stats.unique_words << "\n\n";
-
-    std::vector<std::pair<std::string, size_t>> freq(stats.word_freq.begin(), stats.word_freq.end());
-    std::sort(freq.begin(), freq.end(),
-              [](const auto& a, const auto& b) {
-                  if (a.second != b.second)
-                      return a.second > b.second;
-                  return a.first < b.first;
-              });
-
-    out << "Топ " << top_n << " слов (все слова):\n";
-    out << "----------------------------------------\n";
-    out << "Слово                 | Частота\n";
-    out << "----------------------------------------\n";
-    size_t printed = 0;
-    for (const auto& p : freq)
-    {
-        if (printed >= top_n) break;
-        out << p.first << std::string(22 - std::min<size_t>(p.first.size(), 22), ' ')
-            << "| " << p.second << "\n";
-        ++printed;
-    }
-    out << "----------------------------------------\n\n";
-
-    std::vector<std::pair<std::string, size_t>> freq_ns(stats.word_freq_no_stops.begin(),
-                                                        stats.word_freq_no_stops.end());
-    std::sort(freq_ns.begin(), freq_ns.end(),
-              [](const auto& a, const auto& b) {
-                  if (a.second != b.second)
-                      return a.second > b.second;
-                  return a.first < b.first;
-              });
-
-    out << "Топ " << top_n << " слов (без стоп-слов):\n";
-    out << "----------------------------------------\n";
-    out << "Слово                 | Частота\n";
-    out << "----------------------------------------\n";
-    printed = 0;
-    for (const auto& p : freq_ns)
-    {
-        if (printed >= top_n) break;
-        out << p.first << std::string(22 - std::min<size_t>(p.first.size(), 22), ' ')
-            << "| " << p.second << "\n";
-        ++printed;
-    }
-    out << "----------------------------------------\n\n";
+    if (stats.approx)
+    {
+        const ApproxBounds& b = *stats.approx;
+        out << "Уникальных слов (оценка): " << stats.unique_words << " ± "
+            << std::fixed << std::setprecision(2) << b.unique_error * 100.0 << "%\n\n";
+        out.unsetf(std::ios::floatfield);
+        out << "Приближённый режим: " << b.counters << " счётчиков Space-Saving, бюджет памяти "
+            << b.memory_budget / 1024 << " КБ.\n";
+        out << "Частоты в таблицах завышены не более чем на " << b.max_overcount
+            << "; любое слово вне таблиц встречается не более " << b.missing_bound << " раз.\n";
+        out << "Погрешность числа уникальных слов — стандартная ошибка HyperLogLog.\n\n";
+    }
+    else
+    {
+        out << "Уникальных слов: " << stats.unique_words << "\n\n";
+    }
+
+    TopWords top = top_words(stats, top_n);
+    if (stats.ngrams)
+    {
+        const NgramSummary& g = *stats.ngrams;
+        const char* noun = g.n == 2 ? "биграмм" : "триграмм";
+        out << "Всего " << noun << ": " << g.total << ", различных: " << g.distinct << " (таблица "
+            << g.memory_bytes / 1024 << " КБ)\n";
+        if (g.skip_stop_only)
+            out << "Пропущено " << noun << " только из стоп-слов: " << g.skipped << "\n";
+        out << "\n";
+        print_top(out, noun, "N-грамма", "все", top_n, top.all);
+        print_top(out, noun, "N-грамма", "не только из стоп-слов", top_n, top.no_stops);
+    }
+    else
+    {
+        print_top(out, "слов", "Слово", "все слова", top_n, top.all);
+        print_top(out, "слов", "Слово", "без стоп-слов", top_n, top.no_stops);
+    }
 
     out << "Распределение по длине слов:\n";
     out << "-----------------------------\n";
@@ -0,0 +1,169 @@
+#include "tokenizer.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TEXTFREQ_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(TEXTFREQ_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TEXTFREQ_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TEXTFREQ_TARGET_AVX2
+#endif
+
+namespace tokenizer
+{
+    namespace
+    {
+        void classify64_scalar(const char* p, std::uint64_t& word_mask, std::uint64_t& sentence_mask,
+                               std::uint64_t& non_ascii_mask)
+        {
+            std::uint64_t w = 0;
+            std::uint64_t s = 0;
+            std::uint64_t h = 0;
+            for (unsigned k = 0; k < 64; ++k)
+            {
+                unsigned char cls = kTables.cls[static_cast<unsigned char>(p[k])];
+                w |= std::uint64_t{cls == Word} << k;
+                s |= std::uint64_t{cls == SentenceEnd} << k;
+                h |= std::uint64_t{cls == NonAscii} << k;
+            }
+            word_mask = w;
+            sentence_mask = s;
+            non_ascii_mask = h;
+        }
+
+#if defined(TEXTFREQ_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TEXTFREQ_HAVE_SSE2 1
+        // Байты >= 0x80 при знаковом сравнении отрицательны и ни в один диапазон
+        // не попадают; их маска — это просто старшие биты (movemask).
+        void classify64_sse2(const char* p, std::uint64_t& word_mask, std::uint64_t& sentence_mask,
+                               std::uint64_t& non_ascii_mask)
+        {
+            const __m128i lower_bit = _mm_set1_epi8(0x20);
+            const __m128i a_minus_1 = _mm_set1_epi8('a' - 1);
+            const __m128i z_plus_1 = _mm_set1_epi8('z' + 1);
+            const __m128i zero_minus_1 = _mm_set1_epi8('0' - 1);
+            const __m128i nine_plus_1 = _mm_set1_epi8('9' + 1);
+            const __m128i apostrophe = _mm_set1_epi8('\'');
+            const __m128i dot = _mm_set1_epi8('.');
+            const __m128i bang = _mm_set1_epi8('!');
+            const __m128i question = _mm_set1_epi8('?');
+
+            std::uint64_t w = 0;
+            std::uint64_t s = 0;
+            std::uint64_t h = 0;
+            for (unsigned k = 0; k < 4; ++k)
+            {
+                __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+                __m128i folded = _mm_or_si128(c, lower_bit);
+                __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(folded, a_minus_1), _mm_cmplt_epi8(folded, z_plus_1));
+                __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, zero_minus_1), _mm_cmplt_epi8(c, nine_plus_1));
+                __m128i word = _mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(c, apostrophe));
+                __m128i sent = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, dot), _mm_cmpeq_epi8(c, bang)),
+                                            _mm_cmpeq_epi8(c, question));
+                w |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(word))) << (16 * k);
+                s |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(sent))) << (16 * k);
+                h |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(c))) << (16 * k);
+            }
+            word_mask = w;
+            sentence_mask = s;
+            non_ascii_mask = h;
+        }
+#endif
+
+#if defined(TEXTFREQ_X86)
+        TEXTFREQ_TARGET_AVX2
+        void classify64_avx2(const char* p, std::uint64_t& word_mask, std::uint64_t& sentence_mask,
+                               std::uint64_t& non_ascii_mask)
+        {
+            const __m256i lower_bit = _mm256_set1_epi8(0x20);
+            const __m256i a_minus_1 = _mm256_set1_epi8('a' - 1);
+            const __m256i z_plus_1 = _mm256_set1_epi8('z' + 1);
+            const __m256i zero_minus_1 = _mm256_set1_epi8('0' - 1);
+            const __m256i nine_plus_1 = _mm256_set1_epi8('9' + 1);
+            const __m256i apostrophe = _mm256_set1_epi8('\'');
+            const __m256i dot = _mm256_set1_epi8('.');
+            const __m256i bang = _mm256_set1_epi8('!');
+            const __m256i question = _mm256_set1_epi8('?');
+
+            std::uint64_t w = 0;
+            std::uint64_t s = 0;
+            std::uint64_t h = 0;
+            for (unsigned k = 0; k < 2; ++k)
+            {
+                __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * k));
+                __m256i folded = _mm256_or_si256(c, lower_bit);
+                __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(folded, a_minus_1),
+                                                 _mm256_cmpgt_epi8(z_plus_1, folded));
+                __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, zero_minus_1),
+                                                 _mm256_cmpgt_epi8(nine_plus_1, c));
+                __m256i word = _mm256_or_si256(_mm256_or_si256(alpha, digit), _mm256_cmpeq_epi8(c, apostrophe));
+                __m256i sent = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, dot), _mm256_cmpeq_epi8(c, bang)),
+                                               _mm256_cmpeq_epi8(c, question));
+                w |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(word))) << (32 * k);
+                s |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(sent))) << (32 * k);
+                h |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(c))) << (32 * k);
+            }
+            word_mask = w;
+            sentence_mask = s;
+            non_ascii_mask = h;
+        }
+
+        bool cpu_has_avx2()
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return false;
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return false;
+#endif
+        }
+#endif
+
+        const Kernel kScalar{"scalar", classify64_scalar};
+#if defined(TEXTFREQ_HAVE_SSE2)
+        const Kernel kSse2{"sse2", classify64_sse2};
+#endif
+#if defined(TEXTFREQ_X86)
+        const Kernel kAvx2{"avx2", classify64_avx2};
+#endif
+    }
+
+    const Kernel& scalar_kernel()
+    {
+        return kScalar;
+    }
+
+    std::vector<const Kernel*> available_kernels()
+    {
+        std::vector<const Kernel*> kernels{&kScalar};
+#if defined(TEXTFREQ_HAVE_SSE2)
+        kernels.push_back(&kSse2);
+#endif
+#if defined(TEXTFREQ_X86)
+        if (cpu_has_avx2())
+            kernels.push_back(&kAvx2);
+#endif
+        return kernels;
+    }
+
+    const Kernel& active_kernel()
+    {
+        static const Kernel& best = *available_kernels().back();
+        return best;
+    }
+
+} // namespace tokenizer
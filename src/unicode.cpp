@@ -0,0 +1,212 @@
+#include "unicode.hpp"
+
+namespace unicode
+{
+    namespace
+    {
+        struct Tables
+        {
+            std::array<std::uint16_t, kTableSize> lower{};
+            std::array<std::uint8_t, kTableSize> letter{};
+
+            constexpr void letters(char32_t from, char32_t to)
+            {
+                for (char32_t c = from; c <= to; ++c)
+                    letter[c] = 1;
+            }
+
+            constexpr void shift(char32_t from, char32_t to, int delta)
+            {
+                for (char32_t c = from; c <= to; ++c)
+                    lower[c] = static_cast<std::uint16_t>(static_cast<int>(c) + delta);
+            }
+
+            // Пары «заглавная — строчная» с заглавной на позиции нужной чётности.
+            constexpr void pairs(char32_t from, char32_t to, char32_t parity)
+            {
+                for (char32_t c = from; c <= to; ++c)
+                {
+                    if ((c & 1) == parity)
+                        lower[c] = static_cast<std::uint16_t>(c + 1);
+                }
+            }
+
+            constexpr Tables()
+            {
+                for (char32_t c = 0; c < kTableSize; ++c)
+                    lower[c] = static_cast<std::uint16_t>(c);
+
+                // ASCII и Latin-1
+                letters('A', 'Z');
+                letters('a', 'z');
+                shift('A', 'Z', 0x20);
+                letter[0xAA] = letter[0xB5] = letter[0xBA] = 1;
+                letters(0xC0, 0xFF);
+                letter[0xD7] = letter[0xF7] = 0;
+                shift(0xC0, 0xDE, 0x20);
+                lower[0xD7] = 0xD7;
+
+                // Latin Extended-A/B, IPA, комбинируемые диакритические знаки
+                letters(0x100, 0x2AF);
+                letters(0x300, 0x36F);
+                pairs(0x100, 0x12F, 0);
+                lower[0x130] = 'i';
+                pairs(0x132, 0x137, 0);
+                pairs(0x139, 0x148, 1);
+                pairs(0x14A, 0x177, 0);
+                lower[0x178] = 0xFF;
+                pairs(0x179, 0x17E, 1);
+
+                // Греческий
+                letters(0x370, 0x373);
+                letters(0x376, 0x377);
+                letters(0x37B, 0x37D);
+                letter[0x37F] = letter[0x386] = letter[0x38C] = 1;
+                letters(0x388, 0x38A);
+                letters(0x38E, 0x3A1);
+                letters(0x3A3, 0x3FF);
+                letter[0x3F6] = 0;
+                lower[0x386] = 0x3AC;
+                shift(0x388, 0x38A, 37);
+                lower[0x38C] = 0x3CC;
+                shift(0x38E, 0x38F, 63);
+                shift(0x391, 0x3A1, 0x20);
+                shift(0x3A3, 0x3AB, 0x20);
+
+                // Кириллица и дополнение к ней
+                letters(0x400, 0x481);
+                letters(0x483, 0x487);
+                letters(0x48A, 0x52F);
+                shift(0x400, 0x40F, 0x50);
+                shift(0x410, 0x42F, 0x20);
+                pairs(0x460, 0x481, 0);
+                pairs(0x48A, 0x4BF, 0);
+                lower[0x4C0] = 0x4CF;
+                pairs(0x4C1, 0x4CE, 1);
+                pairs(0x4D0, 0x52F, 0);
+            }
+        };
+
+        constexpr Tables kTables{};
+
+        bool is_continuation(unsigned char c)
+        {
+            return (c & 0xC0) == 0x80;
+        }
+    }
+
+    const std::array<std::uint16_t, kTableSize> kLower = kTables.lower;
+    const std::array<std::uint8_t, kTableSize> kLetter = kTables.letter;
+
+    bool is_letter_outside_table(char32_t cp)
+    {
+        return !((cp >= 0x2000 && cp <= 0x2BFF)     // пунктуация, знаки, стрелки, математика, рамки
+                 || (cp >= 0x3000 && cp <= 0x303F)  // пунктуация CJK
+                 || (cp >= 0xE000 && cp <= 0xF8FF)  // область частного использования
+                 || (cp >= 0xFE30 && cp <= 0xFE4F)
+                 || (cp >= 0xFF01 && cp <= 0xFF0F)
+                 || (cp >= 0xFF1A && cp <= 0xFF20)
+                 || (cp >= 0xFFF0 && cp <= 0xFFFF)
+                 || (cp >= 0x1F000 && cp <= 0x1FAFF)); // эмодзи и пиктограммы
+    }
+
+    size_t sequence_length(unsigned char lead)
+    {
+        if (lead < 0x80)
+            return 1;
+        if (lead >= 0xC2 && lead <= 0xDF)
+            return 2;
+        if (lead >= 0xE0 && lead <= 0xEF)
+            return 3;
+        if (lead >= 0xF0 && lead <= 0xF4)
+            return 4;
+        return 0;
+    }
+
+    int decode(const char* p, size_t n, char32_t& cp)
+    {
+        const auto* s = reinterpret_cast<const unsigned char*>(p);
+        const size_t len = sequence_length(s[0]);
+        if (len == 0)
+            return kInvalid;
+        if (len == 1)
+        {
+            cp = s[0];
+            return 1;
+        }
+
+        // Второй байт ограничен сильнее: без избыточных форм и суррогатов.
+        unsigned char lo = 0x80;
+        unsigned char hi = 0xBF;
+        if (s[0] == 0xE0) lo = 0xA0;
+        else if (s[0] == 0xED) hi = 0x9F;
+        else if (s[0] == 0xF0) lo = 0x90;
+        else if (s[0] == 0xF4) hi = 0x8F;
+
+        const size_t avail = n < len ? n : len;
+        for (size_t k = 1; k < avail; ++k)
+        {
+            bool ok = k == 1 ? (s[k] >= lo && s[k] <= hi) : is_continuation(s[k]);
+            if (!ok)
+                return kInvalid;
+        }
+        if (avail < len)
+            return kIncomplete;
+
+        char32_t value = s[0] & (0xFF >> (len + 1));
+        for (size_t k = 1; k < len; ++k)
+            value = (value << 6) | (s[k] & 0x3F);
+        cp = value;
+        return static_cast<int>(len);
+    }
+
+    size_t encode(char32_t cp, char* out)
+    {
+        if (cp < 0x80)
+        {
+            out[0] = static_cast<char>(cp);
+            return 1;
+        }
+        if (cp < 0x800)
+        {
+            out[0] = static_cast<char>(0xC0 | (cp >> 6));
+            out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 2;
+        }
+        if (cp < 0x10000)
+        {
+            out[0] = static_cast<char>(0xE0 | (cp >> 12));
+            out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<char>(0xF0 | (cp >> 18));
+        out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 4;
+    }
+
+    std::string to_lower(std::string_view s)
+    {
+        std::string out;
+        out.reserve(s.size());
+        size_t i = 0;
+        while (i < s.size())
+        {
+            char32_t cp;
+            int len = decode(s.data() + i, s.size() - i, cp);
+            if (len <= 0)
+            {
+                out.push_back(s[i]);
+                ++i;
+                continue;
+            }
+            char buf[4];
+            out.append(buf, encode(to_lower(cp), buf));
+            i += static_cast<size_t>(len);
+        }
+        return out;
+    }
+
+} // namespace unicode
@@ -0,0 +1,182 @@
+#include "vocabulary.hpp"
+
+#include <cstring>
+
+namespace
+{
+    constexpr size_t kInitialSlots = 64;
+
+    std::uint64_t mix(std::uint64_t h) noexcept
+    {
+        h ^= h >> 32;
+        h *= 0xd6e8feb86659fd93ULL;
+        h ^= h >> 32;
+        return h;
+    }
+
+    std::uint32_t tag_of(std::uint64_t h) noexcept
+    {
+        return static_cast<std::uint32_t>(h >> 32);
+    }
+}
+
+Vocabulary::Vocabulary()
+{
+    rehash(kInitialSlots);
+}
+
+Vocabulary::Vocabulary(const Vocabulary& other)
+    : Vocabulary()
+{
+    merge(other);
+}
+
+Vocabulary& Vocabulary::operator=(const Vocabulary& other)
+{
+    if (this != &other)
+    {
+        clear();
+        merge(other);
+    }
+    return *this;
+}
+
+std::uint64_t Vocabulary::hash(std::string_view word) noexcept
+{
+    std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ word.size();
+    const char* p = word.data();
+    size_t n = word.size();
+    while (n >= 8)
+    {
+        std::uint64_t v;
+        std::memcpy(&v, p, 8);
+        h = (h ^ v) * 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 29;
+        p += 8;
+        n -= 8;
+    }
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, p, n);
+    h = (h ^ tail) * 0x94d049bb133111ebULL;
+    return mix(h);
+}
+
+void Vocabulary::rehash(size_t capacity)
+{
+    m_slots.assign(capacity, Slot{npos, 0});
+    m_mask = capacity - 1;
+    for (Id id = 0; id < m_words.size(); ++id)
+    {
+        std::uint64_t h = hash(m_words[id]);
+        size_t i = h & m_mask;
+        while (m_slots[i].id != npos)
+            i = (i + 1) & m_mask;
+        m_slots[i] = Slot{id, tag_of(h)};
+    }
+}
+
+std::pair<Vocabulary::Id, bool> Vocabulary::intern(std::string_view word)
+{
+    return intern(word, hash(word));
+}
+
+std::pair<Vocabulary::Id, bool> Vocabulary::intern(std::string_view word, std::uint64_t h)
+{
+    const std::uint32_t tag = tag_of(h);
+    size_t i = h & m_mask;
+    while (true)
+    {
+        ++m_probes;
+        const Slot& slot = m_slots[i];
+        if (slot.id == npos)
+            break;
+        if (slot.tag == tag && m_words[slot.id] == word)
+            return {slot.id, false};
+        i = (i + 1) & m_mask;
+    }
+
+    Id id = static_cast<Id>(m_words.size());
+    m_slots[i] = Slot{id, tag};
+    m_words.push_back(m_arena.store(word));
+    m_counts.push_back(0);
+    m_stop.push_back(0);
+    m_lengths.push_back(static_cast<std::uint32_t>(word.size()));
+
+    // Коэффициент заполнения не выше 1/2: короткие цепочки проб.
+    if (m_words.size() * 2 > m_slots.size())
+        rehash(m_slots.size() * 2);
+    return {id, true};
+}
+
+Vocabulary::Id Vocabulary::find(std::string_view word) const
+{
+    const std::uint64_t h = hash(word);
+    const std::uint32_t tag = tag_of(h);
+    size_t i = h & m_mask;
+    while (true)
+    {
+        ++m_probes;
+        const Slot& slot = m_slots[i];
+        if (slot.id == npos)
+            return npos;
+        if (slot.tag == tag && m_words[slot.id] == word)
+            return slot.id;
+        i = (i + 1) & m_mask;
+    }
+}
+
+void Vocabulary::clear()
+{
+    m_words.clear();
+    m_counts.clear();
+    m_stop.clear();
+    m_lengths.clear();
+    m_arena.reset();
+    rehash(kInitialSlots);
+}
+
+void Vocabulary::reserve(size_t words)
+{
+    m_words.reserve(words);
+    m_counts.reserve(words);
+    m_stop.reserve(words);
+    m_lengths.reserve(words);
+    size_t capacity = m_slots.size();
+    while (capacity < 2 * words + 2)
+        capacity *= 2;
+    if (capacity != m_slots.size())
+        rehash(capacity);
+}
+
+void Vocabulary::merge(const Vocabulary& other)
+{
+    for (Id src = 0; src < other.size(); ++src)
+    {
+        auto [id, inserted] = intern(other.m_words[src]);
+        if (inserted)
+        {
+            m_stop[id] = other.m_stop[src];
+            m_lengths[id] = other.m_lengths[src];
+        }
+        m_counts[id] += other.m_counts[src];
+    }
+}
+
+size_t Vocabulary::table_bytes(size_t words) noexcept
+{
+    size_t capacity = kInitialSlots;
+    while (capacity < 2 * words + 2)
+        capacity *= 2;
+    return capacity * sizeof(Slot)
+         + words * (sizeof(std::string_view) + sizeof(std::uint64_t) + sizeof(std::uint8_t) + sizeof(std::uint32_t));
+}
+
+size_t Vocabulary::memory_bytes() const noexcept
+{
+    return m_slots.capacity() * sizeof(Slot)
+         + m_words.capacity() * sizeof(std::string_view)
+         + m_counts.capacity() * sizeof(std::uint64_t)
+         + m_stop.capacity() * sizeof(std::uint8_t)
+         + m_lengths.capacity() * sizeof(std::uint32_t)
+         + m_arena.bytes_reserved();
+}
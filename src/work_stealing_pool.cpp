@@ -0,0 +1,100 @@
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : m_threads(threads)
+{
+    if (m_threads == 0)
+    {
+        m_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < m_threads; ++i)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+}
+
+bool WorkStealingPool::pop_local(size_t worker, size_t& task)
+{
+    Queue& q = *m_queues[worker];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+        return false;
+    task = q.tasks.back();
+    q.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t thief, size_t& task)
+{
+    for (size_t step = 1; step < m_threads; ++step)
+    {
+        Queue& victim = *m_queues[(thief + step) % m_threads];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(size_t task_count, const Task& fn)
+{
+    if (task_count == 0)
+        return;
+
+    const size_t workers = std::min(m_threads, task_count);
+    const size_t per_worker = task_count / workers;
+    const size_t remainder = task_count % workers;
+    size_t next = 0;
+    for (size_t w = 0; w < workers; ++w)
+    {
+        size_t n = per_worker + (w < remainder ? 1 : 0);
+        auto& tasks = m_queues[w]->tasks;
+        tasks.clear();
+        // Свой диапазон берётся с конца, поэтому кладём его в обратном порядке:
+        // владелец идёт по файлам по возрастанию, а воры забирают хвост.
+        for (size_t i = 0; i < n; ++i)
+            tasks.push_front(next + i);
+        next += n;
+    }
+    for (size_t w = workers; w < m_threads; ++w)
+        m_queues[w]->tasks.clear();
+
+    std::mutex error_mutex;
+    std::exception_ptr first_error;
+
+    auto worker_loop = [&](size_t worker) {
+        size_t task = 0;
+        while (pop_local(worker, task) || steal(worker, task))
+        {
+            try
+            {
+                fn(worker, task);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!first_error)
+                    first_error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t w = 1; w < workers; ++w)
+        threads.emplace_back(worker_loop, w);
+    worker_loop(0);
+    for (auto& t : threads)
+        t.join();
+
+    if (first_error)
+        std::rethrow_exception(first_error);
+}
@@ -0,0 +1,854 @@
+#include "approx.hpp"
+#include "batch.hpp"
+#include "compression.hpp"
+#include "external_count.hpp"
+#include "json_parser.hpp"
+#include "json_sax.hpp"
+#include "json_tape.hpp"
+#include "pack.hpp"
+#include "stopwords.hpp"
+#include "text_analyzer.hpp"
+#include "tokenizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// textfreq_bench: воспроизводимый набор бенчмарков.
+//
+// Каждый случай прогревается, затем замеряется несколько раз; один замер — это
+// столько повторов операции, чтобы он длился не меньше миллисекунды, а в отчёт
+// идёт время одной операции. Печатаются медиана и p99 (по рангу) в наносекундах,
+// байты/с и слова/с. Входные данные генерируются детерминированно (фиксированные
+// зёрна), поэтому прогоны на одной машине сравнимы между собой.
+
+namespace
+{
+    namespace fs = std::filesystem;
+    using Clock = std::chrono::steady_clock;
+
+    // Результаты операций складываются сюда, чтобы компилятор их не выбросил.
+    volatile std::uint64_t g_sink = 0;
+
+    struct BenchOptions
+    {
+        bool show_help{false};
+        bool list{false};
+        bool quick{false};
+        size_t warmup{2};
+        size_t repetitions{15};
+        double case_budget_s{2.0};
+        std::string filter;
+        std::optional<std::string> json_path;
+        std::optional<std::string> baseline_path;
+        double threshold{0.10};
+    };
+
+    BenchOptions parse_bench_arguments(int argc, char** argv)
+    {
+        BenchOptions opts;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h")
+            {
+                opts.show_help = true;
+            }
+            else if (arg == "--list")
+            {
+                opts.list = true;
+            }
+            else if (arg == "--quick")
+            {
+                opts.quick = true;
+            }
+            else if (arg == "--filter" && i + 1 < argc)
+            {
+                opts.filter = argv[++i];
+            }
+            else if (arg == "--warmup" && i + 1 < argc)
+            {
+                opts.warmup = static_cast<size_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--repetitions" && i + 1 < argc)
+            {
+                opts.repetitions = std::max<size_t>(1, std::stoul(argv[++i]));
+            }
+            else if (arg == "--budget" && i + 1 < argc)
+            {
+                opts.case_budget_s = std::stod(argv[++i]);
+            }
+            else if (arg == "--json" && i + 1 < argc)
+            {
+                opts.json_path = argv[++i];
+            }
+            else if (arg == "--baseline" && i + 1 < argc)
+            {
+                opts.baseline_path = argv[++i];
+            }
+            else if (arg == "--threshold" && i + 1 < argc)
+            {
+                opts.threshold = std::stod(argv[++i]) / 100.0;
+            }
+            else
+            {
+                std::ostringstream oss;
+                oss << "Неизвестный или некорректный аргумент: " << arg
+                    << "\nИспользуйте --help для справки.";
+                throw std::runtime_error(oss.str());
+            }
+        }
+        return opts;
+    }
+
+    std::string make_bench_help_text()
+    {
+        std::ostringstream out;
+        out << "Бенчмарки частотного анализатора\n\n";
+        out << "Использование:\n";
+        out << "  textfreq_bench [--quick] [--filter SUBSTR] [--json out.json] [--baseline base.json]\n\n";
+        out << "Параметры:\n";
+        out << "  --help, -h        Показать эту справку.\n";
+        out << "  --list            Только перечислить случаи.\n";
+        out << "  --quick           Малые размеры входа (для проверки, а не для замеров).\n";
+        out << "  --filter SUBSTR   Запускать только случаи, в имени которых есть SUBSTR.\n";
+        out << "  --warmup N        Прогревочных замеров на случай (по умолчанию 2).\n";
+        out << "  --repetitions N   Замеров на случай (по умолчанию 15; меньше, если не укладывается в --budget).\n";
+        out << "  --budget SEC      Ориентир времени на один случай, секунд (по умолчанию 2).\n";
+        out << "  --json PATH       Записать результаты в JSON (\"-\" — в стандартный вывод).\n";
+        out << "  --baseline PATH   Сравнить медианы с сохранённым JSON и отметить регрессии.\n";
+        out << "  --threshold PCT   Порог регрессии медианы, процентов (по умолчанию 10).\n";
+        out << "Код возврата 2, если найдена регрессия.\n";
+        return out.str();
+    }
+
+    struct Measurement
+    {
+        std::string name;
+        std::uint64_t bytes{0};
+        std::uint64_t tokens{0};
+        size_t repetitions{0};
+        size_t iterations{0}; // операций в одном замере
+        double median_ns{0};
+        double p99_ns{0};
+        double min_ns{0};
+        double mean_ns{0};
+
+        double bytes_per_s() const { return median_ns > 0 ? bytes * 1e9 / median_ns : 0; }
+        double tokens_per_s() const { return median_ns > 0 ? tokens * 1e9 / median_ns : 0; }
+    };
+
+    class Suite
+    {
+    public:
+        // Таблица идёт в log: в stderr, если стандартный вывод занят JSON.
+        Suite(const BenchOptions& options, std::ostream& log) : m_options(options), m_log(log) {}
+
+        bool selected(const std::string& name) const
+        {
+            return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+        }
+
+        // Нужно ли готовить входные данные для этих случаев. В режиме --list
+        // печатает выбранные имена и возвращает false: данные не генерируются.
+        bool wants(const std::vector<std::string>& names) const
+        {
+            bool any = false;
+            for (const std::string& name : names)
+            {
+                if (name.empty() || !selected(name))
+                    continue;
+                if (m_options.list)
+                    std::cout << name << "\n";
+                any = true;
+            }
+            return any && !m_options.list;
+        }
+
+        // Замеряет op() — одну операцию над bytes байтами входа, дающую tokens слов.
+        template <typename Op>
+        void run(const std::string& name, std::uint64_t bytes, std::uint64_t tokens, Op&& op)
+        {
+            if (!selected(name))
+                return;
+
+            // Калибровка: столько операций в замере, чтобы он длился не меньше 1 мс.
+            auto once_start = Clock::now();
+            op();
+            double once_ns = elapsed_ns(once_start);
+            size_t iterations = 1;
+            if (once_ns < 1e6)
+                iterations = static_cast<size_t>(1e6 / std::max(once_ns, 1.0)) + 1;
+
+            const double sample_ns = once_ns * iterations;
+            size_t repetitions = m_options.repetitions;
+            const double budget_ns = m_options.case_budget_s * 1e9;
+            if (sample_ns * (repetitions + m_options.warmup) > budget_ns)
+                repetitions = std::max<size_t>(3, static_cast<size_t>(budget_ns / sample_ns));
+
+            for (size_t w = 0; w < m_options.warmup; ++w)
+                for (size_t i = 0; i < iterations; ++i)
+                    op();
+
+            std::vector<double> samples;
+            samples.reserve(repetitions);
+            for (size_t r = 0; r < repetitions; ++r)
+            {
+                auto start = Clock::now();
+                for (size_t i = 0; i < iterations; ++i)
+                    op();
+                samples.push_back(elapsed_ns(start) / iterations);
+            }
+            std::sort(samples.begin(), samples.end());
+
+            Measurement m;
+            m.name = name;
+            m.bytes = bytes;
+            m.tokens = tokens;
+            m.repetitions = repetitions;
+            m.iterations = iterations;
+            m.median_ns = samples.size() % 2 ? samples[samples.size() / 2]
+                                             : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+            // p99 по рангу: ceil(0.99 * n)-й замер.
+            size_t rank = (samples.size() * 99 + 99) / 100;
+            m.p99_ns = samples[std::min(rank, samples.size()) - 1];
+            m.min_ns = samples.front();
+            double total = 0;
+            for (double s : samples)
+                total += s;
+            m.mean_ns = total / samples.size();
+
+            print(m);
+            m_results.push_back(m);
+        }
+
+        const std::vector<Measurement>& results() const noexcept { return m_results; }
+
+    private:
+        const BenchOptions& m_options;
+        std::ostream& m_log;
+        std::vector<Measurement> m_results;
+
+        static double elapsed_ns(Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        }
+
+        void print(const Measurement& m)
+        {
+            m_log << std::left << std::setw(40) << m.name << std::right << std::fixed << std::setprecision(0)
+                  << " медиана " << std::setw(13) << m.median_ns << " нс, p99 " << std::setw(13) << m.p99_ns
+                  << " нс" << std::setprecision(1);
+            if (m.bytes)
+                m_log << ", " << std::setw(8) << m.bytes_per_s() / 1e6 << " МБ/с";
+            if (m.tokens)
+                m_log << ", " << std::setw(8) << m.tokens_per_s() / 1e6 << " млн слов/с";
+            m_log << "  (" << m.repetitions << " x " << m.iterations << ")" << std::endl;
+        }
+    };
+
+    // ----- Генерация входных данных -----
+
+    enum class Distribution
+    {
+        Zipf,     // 50 000 слов, частоты по закону Ципфа — типичный текст
+        Uniform,  // 1 000 000 равновероятных слов — огромный словарь
+        Small,    // 100 слов — словарь целиком в кеше
+        Cyrillic  // как Zipf, но слова кириллические (UTF-8, смена регистра по таблицам)
+    };
+
+    const char* distribution_name(Distribution d)
+    {
+        switch (d)
+        {
+        case Distribution::Zipf: return "zipf";
+        case Distribution::Uniform: return "uniform";
+        case Distribution::Small: return "small";
+        case Distribution::Cyrillic: return "cyrillic";
+        }
+        return "?";
+    }
+
+    std::vector<std::string> make_dictionary(size_t size, bool cyrillic, unsigned seed)
+    {
+        static const char* const kCyrillic[] = {"а", "б", "в", "г", "д", "е", "ж", "з", "и", "к", "л",
+                                                "м", "н", "о", "п", "р", "с", "т", "у", "ф", "х", "ц",
+                                                "ч", "ш", "ы", "э", "ю", "я", "А", "О", "П", "С"};
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> length(2, 10);
+        std::uniform_int_distribution<int> latin(0, 25);
+        std::uniform_int_distribution<int> cyr(0, static_cast<int>(std::size(kCyrillic)) - 1);
+        std::vector<std::string> words(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            // Номер в конце гарантирует различие слов словаря.
+            int n = length(rng);
+            for (int k = 0; k < n; ++k)
+            {
+                if (cyrillic)
+                    words[i] += kCyrillic[cyr(rng)];
+                else
+                    words[i].push_back(static_cast<char>('a' + latin(rng)));
+            }
+            words[i] += std::to_string(i);
+        }
+        return words;
+    }
+
+    struct Text
+    {
+        std::string text;
+        std::uint64_t words{0};
+    };
+
+    // Текст из слов словаря с точкой в среднем через 12 слов.
+    Text make_text(Distribution distribution, size_t bytes, unsigned seed)
+    {
+        const bool cyrillic = distribution == Distribution::Cyrillic;
+        size_t vocabulary = distribution == Distribution::Uniform ? 1000000
+                          : distribution == Distribution::Small   ? 100
+                                                                  : 50000;
+        static std::map<std::pair<size_t, bool>, std::vector<std::string>> dictionaries;
+        auto& dictionary = dictionaries[{vocabulary, cyrillic}];
+        if (dictionary.empty())
+            dictionary = make_dictionary(vocabulary, cyrillic, 17);
+
+        std::mt19937 rng(seed);
+        std::vector<double> weights(vocabulary, 1.0);
+        if (distribution == Distribution::Zipf || distribution == Distribution::Cyrillic)
+        {
+            for (size_t rank = 0; rank < vocabulary; ++rank)
+                weights[rank] = 1.0 / static_cast<double>(rank + 1);
+        }
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        std::uniform_int_distribution<int> sentence(0, 11);
+
+        Text result;
+        result.text.reserve(bytes + 64);
+        while (result.text.size() < bytes)
+        {
+            result.text += dictionary[pick(rng)];
+            result.text += sentence(rng) == 0 ? ". " : " ";
+            ++result.words;
+        }
+        return result;
+    }
+
+    // JSON-документ с текстом, разбитым на параграфы по ~2 КБ.
+    std::string make_json_document(const std::string& text)
+    {
+        std::string json = "[";
+        for (size_t pos = 0; pos < text.size();)
+        {
+            size_t end = std::min(text.size(), pos + 2048);
+            while (end < text.size() && text[end] != ' ')
+                ++end;
+            if (pos != 0)
+                json += ",\n";
+            json += "{\"paragraph\": \"";
+            json.append(text, pos, end - pos);
+            json += "\"}";
+            pos = end;
+        }
+        json += "]";
+        return json;
+    }
+
+    // Тот же текст с экранированиями: переводы строк, кавычки и кириллица в \uXXXX
+    // на каждом ~8-м слове — так выглядят выгрузки, прошедшие через ensure_ascii.
+    std::string make_escaped_json_document(const std::string& text)
+    {
+        std::string json = "[";
+        size_t word = 0;
+        for (size_t pos = 0; pos < text.size();)
+        {
+            size_t end = std::min(text.size(), pos + 2048);
+            while (end < text.size() && text[end] != ' ')
+                ++end;
+            if (pos != 0)
+                json += ",\n";
+            json += "{\"paragraph\": \"";
+            for (size_t i = pos; i < end; ++i)
+            {
+                json += text[i];
+                if (text[i] == ' ' && ++word % 8 == 0)
+                    json += (word % 16 == 0) ? "\\u043f\\u0440\\u0438 " : "\\n\\\"q\\\" ";
+            }
+            json += "\"}";
+            pos = end;
+        }
+        json += "]";
+        return json;
+    }
+
+    // Корпус мелких записей с отступами и числами: структура, а не текст.
+    std::string make_records_json_document(size_t bytes)
+    {
+        std::mt19937 rng(5);
+        std::uniform_real_distribution<double> score(-1000.0, 1000.0);
+        std::ostringstream json;
+        json << "[\n";
+        for (size_t i = 0; static_cast<size_t>(json.tellp()) < bytes; ++i)
+        {
+            json << (i ? ",\n" : "") << "    {\n        \"id\": " << i << ",\n        \"score\": "
+                 << std::setprecision(9) << score(rng) << ",\n        \"tags\": [1, 2.5e3, true, null],\n"
+                 << "        \"paragraph\": \"short text " << i % 97 << "\"\n    }";
+        }
+        json << "\n]";
+        return json.str();
+    }
+
+    std::string size_label(size_t bytes)
+    {
+        if (bytes >= (1u << 20))
+            return std::to_string(bytes >> 20) + "MB";
+        return std::to_string(bytes >> 10) + "KB";
+    }
+
+    struct CountingSink
+    {
+        std::uint64_t words{0};
+        std::uint64_t sentences{0};
+
+        void on_word(std::string_view, size_t) { ++words; }
+        void on_sentence() { ++sentences; }
+    };
+
+    // Приёмник текста для SAX-разбора без анализа: замер только парсера.
+    class NullTextSink : public TextSink
+    {
+    public:
+        void feed(std::string_view chunk) override { bytes += chunk.size(); }
+        void end_block() override {}
+
+        std::uint64_t bytes{0};
+    };
+
+    // ----- Случаи -----
+
+    void bench_parser(Suite& suite, const std::vector<size_t>& sizes)
+    {
+        for (size_t size : sizes)
+        {
+            if (!suite.wants({"parse/tape/" + size_label(size), "parse/sax/" + size_label(size)}))
+                continue;
+            Text text = make_text(Distribution::Zipf, size, 1);
+            std::string document = make_json_document(text.text);
+            json::Tape tape;
+            suite.run("parse/tape/" + size_label(size), document.size(), text.words, [&] {
+                json::Parser parser(document);
+                parser.parse(tape);
+                g_sink = g_sink + tape.size();
+            });
+            suite.run("parse/sax/" + size_label(size), document.size(), text.words, [&] {
+                NullTextSink sink;
+                TextBlockExtractor extractor(sink);
+                json::SaxParser parser(document);
+                parser.parse(extractor);
+                g_sink = g_sink + sink.bytes;
+            });
+        }
+    }
+
+    // Строки с экранированиями и документы из мелких записей с числами.
+    void bench_parser_shapes(Suite& suite)
+    {
+        const size_t size = 1u << 20;
+        if (!suite.wants({"parse/escaped/1MB", "parse/records/1MB"}))
+            return;
+        Text text = make_text(Distribution::Zipf, size, 1);
+        std::string escaped = make_escaped_json_document(text.text);
+        std::string records = make_records_json_document(size);
+        json::Tape tape;
+        suite.run("parse/escaped/1MB", escaped.size(), text.words, [&] {
+            json::Parser parser(escaped);
+            parser.parse(tape);
+            g_sink = g_sink + tape.size();
+        });
+        suite.run("parse/records/1MB", records.size(), 0, [&] {
+            json::Parser parser(records);
+            parser.parse(tape);
+            g_sink = g_sink + tape.size();
+        });
+    }
+
+    void bench_tokenizer(Suite& suite, const std::vector<size_t>& sizes)
+    {
+        for (size_t size : sizes)
+        {
+            for (Distribution d : {Distribution::Zipf, Distribution::Cyrillic})
+            {
+                std::vector<std::string> names;
+                for (const tokenizer::Kernel* kernel : tokenizer::available_kernels())
+                    names.push_back(std::string("tokenize/") + kernel->name + "/" + distribution_name(d) + "/" +
+                                    size_label(size));
+                if (!suite.wants(names))
+                    continue;
+                Text text = make_text(d, size, 2);
+                const std::vector<const tokenizer::Kernel*> kernels = tokenizer::available_kernels();
+                for (size_t k = 0; k < kernels.size(); ++k)
+                {
+                    const tokenizer::Kernel* kernel = kernels[k];
+                    suite.run(names[k], text.text.size(), text.words, [&] {
+                        CountingSink sink;
+                        tokenizer::Tokenizer tok(*kernel);
+                        tok.feed(text.text, sink);
+                        tok.end_block(sink);
+                        g_sink = g_sink + sink.words;
+                    });
+                }
+            }
+        }
+    }
+
+    void bench_counting(Suite& suite, const std::vector<size_t>& sizes, const StopwordSet& stops)
+    {
+        for (size_t size : sizes)
+        {
+            for (Distribution d : {Distribution::Zipf, Distribution::Uniform, Distribution::Small,
+                                   Distribution::Cyrillic})
+            {
+                const std::string suffix = std::string(distribution_name(d)) + "/" + size_label(size);
+                const bool approx = d == Distribution::Zipf || d == Distribution::Uniform;
+                if (!suite.wants({"count/exact/" + suffix, approx ? "count/approx/" + suffix : std::string(),
+                                  approx ? "count/external/" + suffix : std::string()}))
+                    continue;
+                Text text = make_text(d, size, 3);
+                suite.run("count/exact/" + suffix, text.text.size(), text.words, [&] {
+                    StreamingAnalyzer analyzer(stops);
+                    analyzer.feed(text.text);
+                    TextStats stats = analyzer.finish(false);
+                    g_sink = g_sink + stats.total_words;
+                });
+                if (approx)
+                {
+                    suite.run("count/approx/" + suffix, text.text.size(), text.words, [&] {
+                        ApproxAnalyzer analyzer(stops, ApproxOptions{});
+                        analyzer.feed(text.text);
+                        TextStats stats = analyzer.finish();
+                        g_sink = g_sink + stats.total_words;
+                    });
+                    // Точный подсчёт в 4 МБ: прогоны на диск и их слияние с выбором топа.
+                    suite.run("count/external/" + suffix, text.text.size(), text.words, [&] {
+                        ExternalCounter counter(4u << 20);
+                        StreamingAnalyzer analyzer(stops);
+                        analyzer.spill_to(counter, counter.memory_limit());
+                        analyzer.feed(text.text);
+                        TextStats stats = analyzer.finish(false);
+                        counter.finish(stats, 20);
+                        g_sink = g_sink + stats.unique_words;
+                    });
+                }
+            }
+        }
+    }
+
+    void bench_top(Suite& suite, const std::vector<size_t>& vocabularies)
+    {
+        for (size_t vocabulary : vocabularies)
+        {
+            const std::string label = std::to_string(vocabulary);
+            if (!suite.wants({"top/heap/k20/" + label, "top/views/" + label}))
+                continue;
+            TextStats stats;
+            std::mt19937 rng(5);
+            std::uniform_int_distribution<int> freq(1, 1000);
+            for (size_t i = 0; i < vocabulary; ++i)
+            {
+                auto [id, inserted] = stats.vocab.intern("word" + std::to_string(i));
+                stats.vocab.add(id, static_cast<std::uint64_t>(freq(rng)));
+            }
+            suite.run("top/heap/k20/" + label, 0, vocabulary, [&] {
+                TopWords top = top_words(stats, 20);
+                g_sink = g_sink + top.all.size();
+            });
+            suite.run("top/views/" + label, 0, vocabulary, [&] {
+                TextStats copy;
+                copy.vocab = stats.vocab;
+                build_ordered_views(copy);
+                g_sink = g_sink + copy.unique_words;
+            });
+        }
+    }
+
+    void bench_end_to_end(Suite& suite, bool quick, const StopwordSet& stops)
+    {
+        const std::vector<size_t> corpora = quick ? std::vector<size_t>{1000} : std::vector<size_t>{1000, 20000};
+        for (size_t documents : corpora)
+        {
+            const std::string label = std::to_string(documents);
+            if (!suite.wants({"e2e/files/" + label, "e2e/files-gz/" + label, "e2e/pack/" + label,
+                              "e2e/pack-text/" + label}))
+                continue;
+            // Корпус как у scripts/generate_json.py: документы по ~600 байт.
+            fs::path dir = fs::temp_directory_path() / ("textfreq_bench_" + std::to_string(documents));
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+            std::uint64_t bytes = 0;
+            std::uint64_t words = 0;
+            for (size_t i = 0; i < documents; ++i)
+            {
+                Text text = make_text(Distribution::Zipf, 560, static_cast<unsigned>(100 + i));
+                std::string document = "{\"text\": \"" + text.text + "\"}";
+                std::ofstream(dir / ("text_" + std::to_string(i) + ".json"), std::ios::binary) << document;
+                bytes += document.size();
+                words += text.words;
+            }
+            std::vector<std::string> files = list_directory(dir.string(), "*.json");
+
+            suite.run("e2e/files/" + label, bytes, words, [&] {
+                BatchResult result = analyze_files(files, stops, 0);
+                g_sink = g_sink + result.stats.total_words;
+            });
+            // Тот же корпус в .json.gz: байты/с — по распакованному объёму, как у files.
+            if (suite.selected("e2e/files-gz/" + label) && compression_supported(Compression::Gzip))
+            {
+                const fs::path gz_dir = dir / "gz";
+                fs::create_directories(gz_dir);
+                std::vector<std::string> gz_files;
+                for (const std::string& file : files)
+                {
+                    std::ifstream in(file, std::ios::binary);
+                    const std::string document((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+                    gz_files.push_back((gz_dir / fs::path(file).filename()).string() + ".gz");
+                    std::ofstream(gz_files.back(), std::ios::binary) << compress(document, Compression::Gzip);
+                }
+                suite.run("e2e/files-gz/" + label, bytes, words, [&] {
+                    BatchResult result = analyze_files(gz_files, stops, 0);
+                    g_sink = g_sink + result.stats.total_words;
+                });
+            }
+            for (bool with_text : {false, true})
+            {
+                const std::string name = std::string("e2e/pack") + (with_text ? "-text/" : "/") + label;
+                if (!suite.selected(name))
+                    continue;
+                const fs::path pack_path = dir / "corpus.pack";
+                PackOptions options;
+                options.extract_text = with_text;
+                write_pack(files, pack_path.string(), options);
+                suite.run(name, bytes, words, [&] {
+                    PackReader pack(pack_path.string());
+                    BatchResult result = analyze_pack(pack, stops, 0);
+                    g_sink = g_sink + result.stats.total_words;
+                });
+            }
+            fs::remove_all(dir);
+        }
+
+        const size_t size = quick ? (1u << 20) : (32u << 20);
+        const std::string label = size_label(size);
+        if (!suite.wants({"e2e/document/" + label, "e2e/stream/" + label, "e2e/stream-gz/" + label}))
+            return;
+        Text text = make_text(Distribution::Zipf, size, 4);
+        std::string document = make_json_document(text.text);
+        suite.run("e2e/document/" + label, document.size(), text.words, [&] {
+            json::Parser parser(document);
+            json::Tape tape;
+            parser.parse(tape);
+            TextStats stats = analyze_text_parallel(extract_text_blocks(tape), stops, 0);
+            TopWords top = top_words(stats, 20);
+            g_sink = g_sink + stats.total_words + top.all.size();
+        });
+
+        // --stream с диска: несжатый файл и .gz, распаковываемый на лету.
+        const fs::path raw_path = fs::temp_directory_path() / "textfreq_bench_document.json";
+        std::ofstream(raw_path, std::ios::binary) << document;
+        std::vector<std::pair<std::string, fs::path>> streams = {{"e2e/stream/" + label, raw_path}};
+        if (compression_supported(Compression::Gzip))
+        {
+            const fs::path gz_path = raw_path.string() + ".gz";
+            std::ofstream(gz_path, std::ios::binary) << compress(document, Compression::Gzip);
+            streams.emplace_back("e2e/stream-gz/" + label, gz_path);
+        }
+        for (const auto& [name, path] : streams)
+        {
+            if (!suite.selected(name))
+                continue;
+            suite.run(name, document.size(), text.words, [&] {
+                std::unique_ptr<std::istream> in = open_input_stream(path.string());
+                StreamingAnalyzer analyzer(stops);
+                TextBlockExtractor extractor(analyzer);
+                json::SaxParser(*in).parse(extractor);
+                TextStats stats = analyzer.finish();
+                g_sink = g_sink + stats.total_words;
+            });
+        }
+        for (const auto& stream : streams)
+            fs::remove(stream.second);
+    }
+
+    // ----- JSON-отчёт и сравнение с базой -----
+
+    std::string json_escape(const std::string& s)
+    {
+        std::string out;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                out.push_back('\\');
+            out.push_back(c);
+        }
+        return out;
+    }
+
+    std::string to_json(const std::vector<Measurement>& results, const BenchOptions& options)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1);
+        out << "{\n  \"version\": 1,\n";
+#if defined(NDEBUG)
+        out << "  \"optimized\": true,\n";
+#else
+        out << "  \"optimized\": false,\n";
+#endif
+        out << "  \"kernel\": \"" << tokenizer::active_kernel().name << "\",\n";
+        out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+        out << "  \"quick\": " << (options.quick ? "true" : "false") << ",\n";
+        out << "  \"results\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Measurement& m = results[i];
+            out << (i ? ",\n" : "\n") << "    {\"name\": \"" << json_escape(m.name) << "\", \"bytes\": " << m.bytes
+                << ", \"tokens\": " << m.tokens << ", \"repetitions\": " << m.repetitions
+                << ", \"iterations\": " << m.iterations << ", \"median_ns\": " << m.median_ns
+                << ", \"p99_ns\": " << m.p99_ns << ", \"min_ns\": " << m.min_ns << ", \"mean_ns\": " << m.mean_ns
+                << ", \"bytes_per_s\": " << m.bytes_per_s() << ", \"tokens_per_s\": " << m.tokens_per_s() << "}";
+        }
+        out << "\n  ]\n}\n";
+        return out.str();
+    }
+
+    // Медианы из сохранённого JSON (формат to_json), по именам случаев.
+    std::map<std::string, double> load_baseline(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw std::runtime_error("Не удалось открыть базовый файл: " + path);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        json::Parser parser(content);
+        json::Tape tape;
+        parser.parse(tape);
+        std::optional<size_t> results = tape.find(json::Tape::root(), "results");
+        if (!results || tape[*results].type != json::NodeType::Array)
+            throw std::runtime_error("В базовом файле нет массива results: " + path);
+
+        std::map<std::string, double> medians;
+        for (size_t i = *results + 1, n = 0; n < tape[*results].count; i = tape.next(i), ++n)
+        {
+            std::optional<size_t> name = tape.find(i, "name");
+            std::optional<size_t> median = tape.find(i, "median_ns");
+            if (name && median && tape[*name].type == json::NodeType::String &&
+                tape[*median].type == json::NodeType::Number)
+                medians[std::string(tape[*name].str)] = tape[*median].number;
+        }
+        return medians;
+    }
+
+    // Печатает сравнение; возвращает число регрессий.
+    size_t compare_with_baseline(const std::vector<Measurement>& results,
+                                 const std::map<std::string, double>& baseline,
+                                 double threshold,
+                                 std::ostream& log)
+    {
+        size_t regressions = 0;
+        log << "\nСравнение с базой (порог " << threshold * 100 << "%):\n";
+        for (const Measurement& m : results)
+        {
+            auto it = baseline.find(m.name);
+            if (it == baseline.end() || it->second <= 0)
+            {
+                log << "  " << std::left << std::setw(40) << m.name << " нет в базе\n";
+                continue;
+            }
+            const double ratio = m.median_ns / it->second;
+            const char* verdict = ratio > 1 + threshold ? "РЕГРЕССИЯ" : ratio < 1 - threshold ? "улучшение" : "";
+            regressions += ratio > 1 + threshold;
+            log << "  " << std::left << std::setw(40) << m.name << std::right << std::fixed
+                << std::setprecision(2) << " x" << ratio << "  " << verdict << "\n";
+        }
+        return regressions;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        BenchOptions opts = parse_bench_arguments(argc, argv);
+        if (opts.show_help)
+        {
+            std::cout << make_bench_help_text() << std::endl;
+            return 0;
+        }
+#if !defined(NDEBUG)
+        if (!opts.list)
+            std::cerr << "Внимание: сборка без NDEBUG; для замеров соберите Release.\n";
+#endif
+
+        const std::vector<size_t> sizes = opts.quick ? std::vector<size_t>{64u << 10, 1u << 20}
+                                                     : std::vector<size_t>{64u << 10, 1u << 20, 16u << 20};
+        const std::vector<size_t> vocabularies =
+            opts.quick ? std::vector<size_t>{10000} : std::vector<size_t>{10000, 1000000};
+        StopwordSet stops({"the", "and", "of", "a", "in", "to", "и", "в", "на"});
+
+        std::ostream& log = opts.json_path == std::string("-") ? std::cerr : std::cout;
+        Suite suite(opts, log);
+        bench_parser(suite, sizes);
+        bench_parser_shapes(suite);
+        bench_tokenizer(suite, sizes);
+        bench_counting(suite, sizes, stops);
+        bench_top(suite, vocabularies);
+        bench_end_to_end(suite, opts.quick, stops);
+        if (opts.list)
+            return 0;
+
+        if (opts.json_path)
+        {
+            std::string json = to_json(suite.results(), opts);
+            if (*opts.json_path == "-")
+            {
+                std::cout << json;
+            }
+            else
+            {
+                std::ofstream out(*opts.json_path, std::ios::binary);
+                if (!(out << json))
+                    throw std::runtime_error("Не удалось записать результаты: " + *opts.json_path);
+            }
+        }
+
+        if (opts.baseline_path)
+        {
+            size_t regressions =
+                compare_with_baseline(suite.results(), load_baseline(*opts.baseline_path), opts.threshold, log);
+            if (regressions != 0)
+            {
+                log << "Регрессий: " << regressions << std::endl;
+                return 2;
+            }
+        }
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Ошибка: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -1,8 +1,115 @@
+#include "approx.hpp"
+#include "batch.hpp"
+#include "compression.hpp"
+#include "external_count.hpp"
+#include "file_input.hpp"
 #include "json_parser.hpp"
+#include "json_sax.hpp"
+#include "json_tape.hpp"
+#include "ndjson.hpp"
+#include "ngram.hpp"
+#include "pack.hpp"
+#include "partial.hpp"
+#include "profile.hpp"
+#include "report_writer.hpp"
+#include "server.hpp"
+#include "snapshot.hpp"
 #include "text_analyzer.hpp"
+#include "stopwords.hpp"
+#include "tokenizer.hpp"
+#include "unicode.hpp"
+#include "vocabulary.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Карты слов строятся только по запросу; самотесты сравнивают результаты по ним.
+static TextStats with_word_maps(TextStats stats)
+{
+    build_word_maps(stats);
+    return stats;
+}
+
+// Счётчик выделений памяти для проверок «без аллокаций».
+static std::atomic<size_t> g_allocations{0};
+
+// Выделение и освобождение идут через одну пару malloc/free, поэтому все
+// замены operator new/delete согласованы (и -Wmismatched-new-delete молчит).
+static void* counted_allocate(std::size_t size)
+{
+    ++g_allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+static void counted_release(void* p) noexcept
+{
+    std::free(p);
+}
+
+void* operator new(std::size_t size)
+{
+    return counted_allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    counted_release(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    counted_release(p);
+}
+
+namespace
+{
+    // Приёмник токенизатора, записывающий события по порядку.
+    struct RecordingSink
+    {
+        std::string events;
+
+        void on_word(std::string_view word, size_t length)
+        {
+            events.append(word).push_back('#');
+            events += std::to_string(length);
+            events.push_back(' ');
+        }
+        void on_sentence() { events += "| "; }
+    };
+
+    std::string random_text(size_t size, unsigned seed)
+    {
+        static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCXYZ0189'  \n\t.,!?;:-\"@[`{\x80\xd0\xb0\xff";
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 2);
+        std::string text(size, ' ');
+        for (auto& c : text)
+            c = alphabet[pick(rng)];
+        return text;
+    }
+}
 
 int main()
 {
@@ -21,6 +128,149 @@ int main()
             }
         }
 
+        // Плоская лента: строки без экранирований ссылаются во вход, с экранированиями — в арену
+        {
+            std::string sample = R"({"a": [1, -2.5e1, true, null], "text": "plain", "esc": "x\"y\n", "a": false})";
+            json::Parser p(sample);
+            json::Tape tape;
+            p.parse(tape);
+
+            auto text = tape.find(json::Tape::root(), "text");
+            auto esc = tape.find(json::Tape::root(), "esc");
+            auto arr = tape.find(json::Tape::root(), "a");
+            const char* begin = sample.data();
+            const char* end = sample.data() + sample.size();
+            if (!text || !esc || !arr || tape[json::Tape::root()].count != 4 ||
+                tape[*text].str != "plain" || tape[*text].str.data() < begin || tape[*text].str.data() >= end ||
+                tape[*esc].str != "x\"y\n" ||
+                tape[*arr].type != json::NodeType::Array || tape[*arr].count != 4 ||
+                tape[*arr + 2].number != -25.0 || !tape[*arr + 3].boolean ||
+                tape.next(*arr) != *arr + 5 || tape.next(json::Tape::root()) != tape.size())
+            {
+                std::cerr << "Самотест: неверная структура ленты JSON\n";
+                return 1;
+            }
+
+            std::string paragraphs = R"([{"paragraph": "one"}, "two", {"other": "x"}, 3, {"paragraph": "th\tree"}])";
+            json::Parser pp(paragraphs);
+            pp.parse(tape);
+            auto tape_blocks = extract_text_blocks(tape);
+            auto dom_blocks = extract_text_blocks(json::Parser(paragraphs).parse());
+            if (tape_blocks.size() != 3 || dom_blocks.size() != 3 ||
+                !std::equal(tape_blocks.begin(), tape_blocks.end(), dom_blocks.begin()))
+            {
+                std::cerr << "Самотест: извлечение блоков из ленты расходится с DOM\n";
+                return 1;
+            }
+
+            std::string stops_json = R"(["The", {"stop": "A"}, 5])";
+            json::Parser sp(stops_json);
+            sp.parse(tape);
+            if (extract_stopwords(tape) != extract_stopwords(json::Parser(stops_json).parse()))
+            {
+                std::cerr << "Самотест: извлечение стоп-слов из ленты расходится с DOM\n";
+                return 1;
+            }
+
+            // Повторное использование ленты: разбор небольшого документа без новых аллокаций
+            std::string doc = R"({"text": "Ims catx arcfc cbmy rsitk! Httmq kull zkuahhek.", "id": 7, "tags": ["a", "b\n"]})";
+            json::Parser warm(doc);
+            warm.parse(tape);
+            size_t before = g_allocations.load();
+            json::Parser again(doc);
+            again.parse(tape);
+            size_t allocations = g_allocations.load() - before;
+            if (allocations > 1)
+            {
+                std::cerr << "Самотест: разбор в переиспользуемую ленту выделил память " << allocations << " раз\n";
+                return 1;
+            }
+        }
+
+        // SAX-разбор потока окнами любого размера совпадает с разбором DOM
+        {
+            std::vector<std::string> docs = {
+                R"({"meta": {"text": "skip me", "n": [1, 2]}, "text": "Hello, wo\nrld. Don't stop! x1", "text": "dup"})",
+                R"([{"paragraph": "First words. Split\tby tabs"}, "bare string!", {"other": "x", "paragraph": 5}, [ "nested" ], {"paragraph": "last one?"}])",
+                R"({"text": 1, "meta": {}, "text": "second"})",
+                R"("just a string")",
+            };
+            std::vector<std::string> stops = { "words", "one" };
+            for (const auto& doc : docs)
+            {
+                TextStats expected = with_word_maps(analyze_text(extract_text_blocks(json::Parser(doc).parse()), stops));
+                for (size_t window : { size_t{1}, size_t{7}, size_t{64 * 1024} })
+                {
+                    std::istringstream in(doc);
+                    StreamingAnalyzer analyzer(stops);
+                    TextBlockExtractor extractor(analyzer);
+                    json::SaxParser parser(in, window);
+                    parser.parse(extractor);
+                    TextStats got = with_word_maps(analyzer.finish());
+                    if (got.total_words != expected.total_words ||
+                        got.total_sentences != expected.total_sentences ||
+                        got.unique_words != expected.unique_words ||
+                        got.word_freq != expected.word_freq ||
+                        got.word_freq_no_stops != expected.word_freq_no_stops ||
+                        got.length_distribution != expected.length_distribution)
+                    {
+                        std::cerr << "Самотест: потоковый анализ расходится с DOM (окно " << window << ")\n";
+                        return 1;
+                    }
+                }
+            }
+
+            std::istringstream broken(R"({"text": "unterminated)");
+            StreamingAnalyzer analyzer(std::vector<std::string>{});
+            TextBlockExtractor extractor(analyzer);
+            try
+            {
+                json::SaxParser(broken, 4).parse(extractor);
+                std::cerr << "Самотест: ожидалась ошибка SAX-разбора\n";
+                return 1;
+            }
+            catch (const json::ParseError&)
+            {
+                // ожидаемое поведение
+            }
+        }
+
+        // Чтение входа: маленький файл — в буфер, крупный — через mmap; объект переиспользуется
+        {
+            namespace fs = std::filesystem;
+            fs::path small = fs::temp_directory_path() / "textfreq_input_small.json";
+            fs::path large = fs::temp_directory_path() / "textfreq_input_large.json";
+            std::string small_text = R"({"text": "small file"})";
+            std::string large_text = "{\"text\": \"" + std::string(InputFile::kMmapThreshold * 2, 'a') + "\"}";
+            std::ofstream(small, std::ios::binary) << small_text;
+            std::ofstream(large, std::ios::binary) << large_text;
+
+            InputFile input(small.string());
+            bool small_ok = input.view() == small_text && !input.mapped();
+            input.open(large.string());
+            bool large_ok = input.view() == large_text;
+            input.open(small.string());
+            bool reuse_ok = input.view() == small_text;
+            fs::remove(small);
+            fs::remove(large);
+
+            bool missing_failed = false;
+            try
+            {
+                input.open((fs::temp_directory_path() / "textfreq_no_such_file.json").string());
+            }
+            catch (const std::runtime_error&)
+            {
+                missing_failed = true;
+            }
+
+            if (!small_ok || !large_ok || !reuse_ok || !missing_failed)
+            {
+                std::cerr << "Самотест: неверное чтение входного файла\n";
+                return 1;
+            }
+        }
+
         // Негативный тест: синтаксически испорченный JSON
         {
             std::string broken = R"({"text": "broken json" "missing_comma": true})";
@@ -55,47 +305,1463 @@ int main()
             std::vector<std::string> blocks = { "Hello world. Hello C++!" };
             std::vector<std::string> stops = { "hello" };
             TextStats stats = analyze_text(blocks, stops);
-            if (stats.total_words == 0 || stats.word_freq.empty())
+            if (stats.total_words == 0 || stats.unique_words == 0)
             {
                 std::cerr << "Самотест: анализ текста не дал результатов\n";
                 return 1;
             }
         }
 
-        // Простейший бенчмарк: анализ одного большого текста
+        // Словарь с открытой адресацией: плотные id, рост таблицы, слияние и копирование
         {
-            std::string big_text(100000, 'a');
-            std::vector<std::string> blocks = { big_text };
-            std::vector<std::string> stops;
+            Vocabulary vocab;
+            const size_t n = 5000;
+            for (size_t i = 0; i < n; ++i)
+            {
+                auto [id, inserted] = vocab.intern("w" + std::to_string(i));
+                if (!inserted || id != i)
+                {
+                    std::cerr << "Самотест: словарь выдал неверный id\n";
+                    return 1;
+                }
+                vocab.add(id, i + 1);
+            }
+            Vocabulary other;
+            other.add(other.intern("w7").first, 10);
+            auto extra = other.intern("extra").first;
+            other.add(extra, 2);
+            other.set_stop(extra, true);
+            vocab.merge(other);
 
-            auto start = std::chrono::high_resolution_clock::now();
+            Vocabulary copy = vocab;
+            auto w7 = copy.find("w7");
+            auto ex = copy.find("extra");
+            if (vocab.size() != n + 1 || vocab.intern("w42").second || vocab.find("missing") != Vocabulary::npos ||
+                w7 == Vocabulary::npos || copy.count(w7) != 18 || ex == Vocabulary::npos ||
+                !copy.is_stop(ex) || copy.length(ex) != 5 || copy.word(ex) != "extra")
+            {
+                std::cerr << "Самотест: неверная работа словаря\n";
+                return 1;
+            }
+        }
+
+        // Однопроходный анализ: любое разбиение блока на куски даёт тот же результат,
+        // а число аллокаций зависит от словаря, а не от числа слов
+        {
+            std::string text = "Don't PANIC. Mixed CASE words, word1 x " + std::string(300, 'Q') + " tail!? end";
+            std::vector<std::string> stops = { "words" };
+            TextStats expected = with_word_maps(analyze_text(std::vector<std::string>{ text }, stops));
+            if (expected.word_freq[std::string(300, 'q')] != 1 || expected.word_freq["don't"] != 1 ||
+                expected.total_sentences != 3)
+            {
+                std::cerr << "Самотест: неверный разбор на слова\n";
+                return 1;
+            }
+            for (size_t cut = 0; cut <= text.size(); ++cut)
+            {
+                StreamingAnalyzer analyzer(stops);
+                analyzer.feed(std::string_view(text).substr(0, cut));
+                analyzer.feed(std::string_view(text).substr(cut));
+                analyzer.end_block();
+                TextStats got = with_word_maps(analyzer.finish());
+                if (got.total_words != expected.total_words || got.total_sentences != expected.total_sentences ||
+                    got.word_freq != expected.word_freq || got.length_distribution != expected.length_distribution)
+                {
+                    std::cerr << "Самотест: слово на стыке кусков разобрано неверно (разрез " << cut << ")\n";
+                    return 1;
+                }
+            }
+
+            std::string repeated;
+            for (size_t i = 0; i < 100000; ++i)
+                repeated += (i % 2 ? "Alpha " : "beta. ");
+            std::vector<std::string_view> blocks = { repeated };
+            size_t before = g_allocations.load();
             TextStats stats = analyze_text(blocks, stops);
-            auto end = std::chrono::high_resolution_clock::now();
-            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+            size_t allocations = g_allocations.load() - before;
+            if (stats.total_words != 100000 || stats.unique_words != 2 || allocations > 64)
+            {
+                std::cerr << "Самотест: анализ выделил память " << allocations << " раз на 100000 слов\n";
+                return 1;
+            }
+        }
+
+        // SIMD-ядра классификации байтов дают те же события, что и скалярное
+        {
+            std::string text = random_text(10000, 42);
+            for (const tokenizer::Kernel* kernel : tokenizer::available_kernels())
+            {
+                for (size_t offset = 0; offset + 64 <= 256; ++offset)
+                {
+                    std::uint64_t w1, s1, h1, w2, s2, h2;
+                    tokenizer::scalar_kernel().classify64(text.data() + offset, w1, s1, h1);
+                    kernel->classify64(text.data() + offset, w2, s2, h2);
+                    if (w1 != w2 || s1 != s2 || h1 != h2)
+                    {
+                        std::cerr << "Самотест: маски ядра " << kernel->name << " расходятся со скалярными\n";
+                        return 1;
+                    }
+                }
+
+                RecordingSink whole_scalar;
+                tokenizer::Tokenizer reference(tokenizer::scalar_kernel());
+                reference.feed(text, whole_scalar);
+                reference.end_block(whole_scalar);
+
+                for (size_t piece : { size_t{1}, size_t{63}, size_t{64}, size_t{100}, text.size() })
+                {
+                    RecordingSink sink;
+                    tokenizer::Tokenizer tok(*kernel);
+                    for (size_t pos = 0; pos < text.size(); pos += piece)
+                        tok.feed(std::string_view(text).substr(pos, piece), sink);
+                    tok.end_block(sink);
+                    if (sink.events != whole_scalar.events)
+                    {
+                        std::cerr << "Самотест: токенизация ядром " << kernel->name
+                                  << " расходится со скалярной (кусок " << piece << ")\n";
+                        return 1;
+                    }
+                }
+            }
+        }
+
+        // UTF-8: кириллица и латиница с диакритикой приводятся к нижнему регистру,
+        // длина считается в символах, обрезанные символы переносятся между кусками
+        {
+            std::string text = "ПРИВЕТ мир. Ёлка, Straße и ÀÉÎ! «кавычки» \xff\xd0 Ωμέγα";
+            std::string expected = "привет#6 мир#3 | ёлка#4 straße#6 и#1 àéî#3 | кавычки#7 ωμέγα#5 ";
+            for (size_t cut = 0; cut <= text.size(); ++cut)
+            {
+                RecordingSink sink;
+                tokenizer::Tokenizer tok;
+                tok.feed(std::string_view(text).substr(0, cut), sink);
+                tok.feed(std::string_view(text).substr(cut), sink);
+                tok.end_block(sink);
+                if (sink.events != expected)
+                {
+                    std::cerr << "Самотест: UTF-8 разобран неверно (разрез " << cut << "): " << sink.events << "\n";
+                    return 1;
+                }
+            }
+
+            std::string stops_json = R"(["И", {"stop": "МИР"}])";
+            json::Tape stops_tape;
+            json::Parser(stops_json).parse(stops_tape);
+            std::vector<std::string> stops = extract_stopwords(stops_tape);
+            TextStats stats = with_word_maps(analyze_text(std::vector<std::string>{ text }, stops));
+            if (stats.word_freq["привет"] != 1 || stats.word_freq_no_stops.count("и") != 0 ||
+                stats.word_freq_no_stops.count("мир") != 0 || stats.length_distribution[6] != 2)
+            {
+                std::cerr << "Самотест: неверная статистика для кириллицы\n";
+                return 1;
+            }
+        }
+
+        // Замороженное множество стоп-слов: поиск, двоичный файл и анализ с ним
+        {
+            std::vector<std::string> words = { "the", "a", "and", "и", "не", "ёлка", "the", "longer-stopword" };
+            for (size_t i = 0; i < 20000; ++i)
+                words.push_back("stop" + std::to_string(i));
+            StopwordSet set(words);
+
+            bool ok = set.size() == words.size() - 1;
+            for (const auto& w : words)
+                ok = ok && set.contains(w);
+            for (std::string_view w : { "", "th", "thee", "b", "an", "ёлки", "stop20000", "stop", "longer-stopwords" })
+                ok = ok && !set.contains(w);
+            if (!ok || !StopwordSet().empty() || StopwordSet().contains("the"))
+            {
+                std::cerr << "Самотест: неверный поиск в StopwordSet\n";
+                return 1;
+            }
+
+            namespace fs = std::filesystem;
+            fs::path path = fs::temp_directory_path() / "textfreq_stopwords_selftest.bin";
+            set.save(path.string());
+            StopwordSet loaded = StopwordSet::load(path.string());
+            if (!loaded.mapped() || loaded.words() != set.words() || !loaded.contains("stop19999") ||
+                loaded.contains("stop20000"))
+            {
+                std::cerr << "Самотест: StopwordSet не восстановился из двоичного файла\n";
+                return 1;
+            }
+
+            // Усечённый файл и чужая сигнатура отвергаются. (Отображённый файл
+            // нельзя переписывать, пока он загружен, — портим копию.)
+            fs::path broken = fs::temp_directory_path() / "textfreq_stopwords_broken.bin";
+            std::string image(loaded.size_bytes(), '\0');
+            std::ifstream(path, std::ios::binary).read(image.data(), static_cast<std::streamsize>(image.size()));
+            std::ofstream(broken, std::ios::binary | std::ios::trunc) << image.substr(0, image.size() / 2);
+            bool truncated_rejected = false;
+            try { StopwordSet::load(broken.string()); } catch (const std::runtime_error&) { truncated_rejected = true; }
+            std::ofstream(broken, std::ios::binary | std::ios::trunc) << "[\"the\"]";
+            bool json_rejected = false;
+            try { StopwordSet::load(broken.string()); } catch (const std::runtime_error&) { json_rejected = true; }
+            fs::remove(broken);
+            if (!truncated_rejected || !json_rejected)
+            {
+                std::cerr << "Самотест: повреждённый файл стоп-слов не отвергнут\n";
+                return 1;
+            }
+
+            std::vector<std::string> blocks = { "The cat and the dog. Ёлка и stop7 stopper" };
+            TextStats with_set = with_word_maps(analyze_text(blocks, loaded));
+            TextStats with_vector = with_word_maps(analyze_text(blocks, words));
+            fs::remove(path);
+            if (with_set.word_freq_no_stops != with_vector.word_freq_no_stops ||
+                with_set.word_freq_no_stops.size() != 3)
+            {
+                std::cerr << "Самотест: анализ с StopwordSet расходится с анализом по списку\n";
+                return 1;
+            }
+        }
+
+        // Параллельный анализ одного документа совпадает с последовательным
+        {
+            std::string text = random_text(200000, 3) + " Привет, МИР! Ёлка... мир? " + random_text(50000, 4);
+            std::vector<std::string_view> blocks = { text, "short block. Мир", "" };
+            std::vector<std::string> stops = { "abc", "мир" };
+            TextStats sequential = with_word_maps(analyze_text(blocks, stops));
+
+            for (size_t chunk : { size_t{1}, size_t{7}, size_t{64}, size_t{4096}, size_t{0} })
+            {
+                std::vector<std::string_view> pieces = split_at_word_boundaries(text, chunk);
+                std::string joined;
+                for (size_t i = 0; i < pieces.size(); ++i)
+                {
+                    joined.append(pieces[i]);
+                    unsigned char last = pieces[i].empty() ? ' ' : static_cast<unsigned char>(pieces[i].back());
+                    if (i + 1 < pieces.size() && (last >= 0x80 || tokenizer::kTables.cls[last] == tokenizer::Word))
+                    {
+                        std::cerr << "Самотест: кусок разрезал слово (размер " << chunk << ")\n";
+                        return 1;
+                    }
+                }
+                if (joined != text)
+                {
+                    std::cerr << "Самотест: куски не складываются в исходный текст\n";
+                    return 1;
+                }
+
+                for (size_t threads : { size_t{1}, size_t{3}, size_t{8} })
+                {
+                    TextStats parallel = with_word_maps(analyze_text_parallel(blocks, stops, threads, chunk));
+                    if (parallel.total_words != sequential.total_words ||
+                        parallel.total_sentences != sequential.total_sentences ||
+                        parallel.unique_words != sequential.unique_words ||
+                        parallel.word_freq != sequential.word_freq ||
+                        parallel.word_freq_no_stops != sequential.word_freq_no_stops ||
+                        parallel.length_distribution != sequential.length_distribution)
+                    {
+                        std::cerr << "Самотест: параллельный анализ (потоков " << threads << ", кусок " << chunk
+                                  << ") расходится с последовательным\n";
+                        return 1;
+                    }
+                }
+            }
+        }
+
+        // Выбор топа кучей совпадает с полной сортировкой (с равными частотами и стоп-словами)
+        {
+            std::mt19937 rng(7);
+            std::uniform_int_distribution<int> word_id(0, 499);
+            std::string text;
+            for (size_t i = 0; i < 20000; ++i)
+                text += "w" + std::to_string(word_id(rng) % (i % 3 ? 500 : 40)) + " ";
+            std::vector<std::string> stops = { "w1", "w2", "w3", "w17" };
+            TextStats stats = with_word_maps(analyze_text(std::vector<std::string>{ text }, stops));
+
+            auto reference = [](const std::map<std::string, size_t>& freq, size_t k) {
+                std::vector<std::pair<std::string, size_t>> rows(freq.begin(), freq.end());
+                std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+                    return a.second != b.second ? a.second > b.second : a.first < b.first;
+                });
+                rows.resize(std::min(k, rows.size()));
+                return rows;
+            };
+            auto same = [](const std::vector<WordCount>& got, const std::vector<std::pair<std::string, size_t>>& want) {
+                if (got.size() != want.size())
+                    return false;
+                for (size_t i = 0; i < got.size(); ++i)
+                    if (got[i].word != want[i].first || got[i].count != want[i].second)
+                        return false;
+                return true;
+            };
+
+            TextStats manual; // только карты, без словаря
+            manual.word_freq = stats.word_freq;
+            manual.word_freq_no_stops = stats.word_freq_no_stops;
+            for (size_t k : { size_t{0}, size_t{1}, size_t{20}, size_t{499}, size_t{1000} })
+            {
+                for (const TextStats* source : { &stats, &manual })
+                {
+                    TopWords top = top_words(*source, k);
+                    if (!same(top.all, reference(stats.word_freq, k)) ||
+                        !same(top.no_stops, reference(stats.word_freq_no_stops, k)))
+                    {
+                        std::cerr << "Самотест: top_words(" << k << ") расходится с полной сортировкой\n";
+                        return 1;
+                    }
+                }
+            }
+        }
+
+        // Слияние статистик равно анализу объединённого набора блоков
+        {
+            std::vector<std::string> a = { "One two. Two three!" };
+            std::vector<std::string> b = { "three four four?" };
+            std::vector<std::string> stops = { "two" };
+            TextStats merged = analyze_text(a, stops);
+            merge_stats(merged, analyze_text(b, stops));
+            build_word_maps(merged);
+            TextStats whole = with_word_maps(analyze_text(std::vector<std::string>{ a[0], b[0] }, stops));
+            if (merged.total_words != whole.total_words ||
+                merged.total_sentences != whole.total_sentences ||
+                merged.unique_words != whole.unique_words ||
+                merged.word_freq != whole.word_freq ||
+                merged.word_freq_no_stops != whole.word_freq_no_stops ||
+                merged.length_distribution != whole.length_distribution)
+            {
+                std::cerr << "Самотест: merge_stats расходится с анализом целого набора\n";
+                return 1;
+            }
+        }
+
+        // Пакетный режим: шаблоны имён и устойчивость к ошибочным файлам
+        {
+            if (!match_glob("text_*.json", "text_00001.json") || match_glob("text_*.json", "text_1.txt") ||
+                !match_glob("t?xt*", "text") || match_glob("*.json", "json"))
+            {
+                std::cerr << "Самотест: неверное сопоставление с шаблоном\n";
+                return 1;
+            }
+
+            namespace fs = std::filesystem;
+            fs::path dir = fs::temp_directory_path() / "textfreq_batch_selftest";
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+            std::ofstream(dir / "a.json") << R"({"text": "alpha beta. alpha!"})";
+            std::ofstream(dir / "b.json") << R"([{"paragraph": "beta gamma"}, "alpha"])";
+            std::ofstream(dir / "broken.json") << R"({ "text": "broken json without closing brace" )";
+            std::ofstream(dir / "notext.json") << R"({"title": "no text field here"})";
+            std::ofstream(dir / "skip.txt") << "not json";
+
+            std::vector<std::string> files = list_directory(dir.string(), "*.json");
+            BatchResult result = analyze_files(files, { "beta" }, 3);
+            build_word_maps(result.stats);
+            fs::remove_all(dir);
+
+            if (files.size() != 4 || result.files_ok != 2 || result.failed.size() != 2 ||
+                result.stats.total_words != 6 || result.stats.total_sentences != 2 ||
+                result.stats.word_freq["alpha"] != 3 || result.stats.word_freq_no_stops.count("beta") != 0 ||
+                result.stats.unique_words != 3)
+            {
+                std::cerr << "Самотест: неверный результат пакетной обработки\n";
+                return 1;
+            }
+        }
+
+        // Space-Saving на распределении Ципфа: частые слова и их частоты находятся точно
+        {
+            std::string text;
+            for (size_t rank = 1; rank <= 2000; ++rank)
+            {
+                size_t repeats = 20000 / rank;
+                for (size_t k = 0; k < std::max<size_t>(repeats, 1); ++k)
+                    text += "w" + std::to_string(rank) + (k % 7 == 6 ? ". " : " ");
+            }
+            // Перемешиваем порядок слов, сохраняя частоты.
+            std::vector<std::string> words;
+            std::istringstream split(text);
+            for (std::string w; split >> w;)
+                words.push_back(w);
+            std::shuffle(words.begin(), words.end(), std::mt19937(11));
+            std::string shuffled;
+            for (const auto& w : words)
+                shuffled += w + " ";
+
+            ApproxOptions small;
+            small.memory_budget = 64 * 1024;
+            ApproxAnalyzer approx({ "w2" }, small);
+            approx.feed(shuffled);
+            approx.end_block();
+            TextStats estimated = approx.finish();
+            TextStats exact = analyze_text(std::vector<std::string>{ shuffled }, { "w2" });
 
-            std::cout << "[bench] Анализ текста длиной " << big_text.size()
-                      << " символов занял " << ms << " мс\n";
+            TopWords got = top_words(estimated, 10);
+            TopWords want = top_words(exact, 10);
+            for (size_t i = 0; i < 10; ++i)
+            {
+                if (got.all[i].word != want.all[i].word || got.no_stops[i].word != want.no_stops[i].word ||
+                    got.all[i].count < want.all[i].count ||
+                    got.all[i].count > want.all[i].count + estimated.approx->max_overcount)
+                {
+                    std::cerr << "Самотест: Space-Saving потерял частое слово " << want.all[i].word << "\n";
+                    return 1;
+                }
+            }
         }
 
-        // Бенчмарк, имитирующий обработку большого количества файлов (до 100000)
+        // Приближённый анализ сгенерированного корпуса укладывается в заявленные границы ошибок
         {
-            std::string text = "word1 word2 word3 word4 word5.";
-            std::vector<std::string> stops = { "word1", "word2" };
+            namespace fs = std::filesystem;
+            const std::string dir = std::string(TEXTFREQ_DATA_DIR) + "/generated";
+            if (fs::is_directory(dir))
+            {
+                std::vector<std::string> files = list_directory(dir, "*.json");
+                files.resize(std::min<size_t>(files.size(), 3000));
+                std::vector<std::string> stops = { "the", "and" };
 
-            const size_t iterations = 100000; // имитация 100000 файлов
-            auto start = std::chrono::high_resolution_clock::now();
+                BatchResult exact = analyze_files(files, stops, 2);
+                ApproxOptions budget;
+                budget.memory_budget = 512 * 1024;
+                BatchResult approx = analyze_files(files, stops, 2, budget);
+
+                build_word_maps(exact.stats);
+                const TextStats& e = exact.stats;
+                const TextStats& a = approx.stats;
+                const ApproxBounds& bounds = *a.approx;
+                double unique_error = std::abs(static_cast<double>(a.unique_words) - static_cast<double>(e.unique_words)) /
+                                      static_cast<double>(e.unique_words);
+                bool ok = a.total_words == e.total_words && a.total_sentences == e.total_sentences &&
+                          a.length_distribution == e.length_distribution && unique_error <= 4 * bounds.unique_error;
+                for (Vocabulary::Id id = 0; ok && id < a.vocab.size(); ++id)
+                {
+                    // Оценка не меньше истинной частоты и завышена не больше объявленного.
+                    auto it = e.word_freq.find(std::string(a.vocab.word(id)));
+                    size_t truth = it == e.word_freq.end() ? 0 : it->second;
+                    ok = a.vocab.count(id) >= truth && a.vocab.count(id) <= truth + bounds.max_overcount;
+                }
+                for (const auto& [word, count] : e.word_freq)
+                {
+                    // Слова чаще границы пропуска обязаны остаться в таблице.
+                    if (ok && count > bounds.missing_bound)
+                        ok = a.vocab.find(word) != Vocabulary::npos;
+                }
+                if (!ok)
+                {
+                    std::cerr << "Самотест: приближённый анализ вышел за границы ошибок (уникальных "
+                              << a.unique_words << " против " << e.unique_words << ")\n";
+                    return 1;
+                }
+            }
+        }
 
-            for (size_t i = 0; i < iterations; ++i)
+        // Снапшот корпуса: сохранение, загрузка и инкрементальное обновление
+        //                 совпадают с полным пересчётом
+        {
+            namespace fs = std::filesystem;
+            fs::path dir = fs::temp_directory_path() / "textfreq_snapshot_selftest";
+            fs::path snapshot_path = dir / "snapshot.bin";
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+            std::ofstream(dir / "a.json") << R"({"text": "alpha beta. alpha!"})";
+            std::ofstream(dir / "b.json") << R"({"text": "beta gamma delta"})";
+            std::ofstream(dir / "c.json") << R"({"text": "gamma gamma. Епсилон"})";
+            std::ofstream(dir / "d.json") << R"({ "text": "broken )";
+
+            StopwordSet stops(std::vector<std::string>{ "beta" });
+            CorpusSnapshot created;
+            CorpusSnapshot::UpdateSummary first = created.update(list_directory(dir.string(), "*.json"), stops, 2);
+            created.save(snapshot_path.string());
+
+            // b изменён (другой размер), c удалён, e добавлен, d исправлен.
+            std::ofstream(dir / "b.json") << R"({"text": "beta beta zeta. Zeta eta theta"})";
+            fs::remove(dir / "c.json");
+            std::ofstream(dir / "e.json") << R"([{"paragraph": "alpha omega"}, "omega"])";
+            std::ofstream(dir / "d.json") << R"({"text": "fixed"})";
+
+            std::vector<std::string> files = list_directory(dir.string(), "*.json");
+            CorpusSnapshot loaded = CorpusSnapshot::load(snapshot_path.string());
+            CorpusSnapshot::UpdateSummary second = loaded.update(files, stops, 2);
+            loaded.save(snapshot_path.string());
+            BatchResult incremental = CorpusSnapshot::load(snapshot_path.string()).result();
+            BatchResult full = analyze_files(files, stops, 2);
+            fs::remove_all(dir);
+
+            build_word_maps(incremental.stats);
+            build_word_maps(full.stats);
+            const TextStats& a = incremental.stats;
+            const TextStats& e = full.stats;
+            if (first.added != 4 || second.added != 1 || second.changed != 2 || second.removed != 1 ||
+                second.unchanged != 1 || incremental.files_ok != full.files_ok ||
+                incremental.failed.size() != full.failed.size() || a.total_words != e.total_words ||
+                a.total_sentences != e.total_sentences || a.unique_words != e.unique_words ||
+                a.word_freq != e.word_freq || a.word_freq_no_stops != e.word_freq_no_stops ||
+                a.length_distribution != e.length_distribution)
             {
-                std::vector<std::string> blocks = { text };
-                (void)analyze_text(blocks, stops);
+                std::cerr << "Самотест: инкрементальное обновление снапшота расходится с полным пересчётом\n";
+                return 1;
             }
+        }
+
+        // Упакованный корпус: анализ пакета (с текстом и без) совпадает с анализом
+        //                     файлов, диапазоны документов покрывают пакет без пропусков
+        {
+            namespace fs = std::filesystem;
+            fs::path dir = fs::temp_directory_path() / "textfreq_pack_selftest";
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+            std::ofstream(dir / "a.json") << R"({"text": "alpha beta. alpha!"})";
+            std::ofstream(dir / "b.json") << R"([{"paragraph": "beta gam"}, "ma delta"])";
+            std::ofstream(dir / "broken.json") << R"({ "text": "broken )";
+            std::ofstream(dir / "notext.json") << R"({"title": "no text"})";
+            for (int i = 0; i < 40; ++i)
+                std::ofstream(dir / ("doc_" + std::to_string(i) + ".json"))
+                    << R"({"text": "word)" << i << R"( shared. Другое слово"})";
 
-            auto end = std::chrono::high_resolution_clock::now();
-            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+            std::vector<std::string> files = list_directory(dir.string(), "*.json");
+            StopwordSet stops(std::vector<std::string>{ "beta" });
+            BatchResult expected = analyze_files(files, stops, 2);
+            build_word_maps(expected.stats);
+
+            bool ok = true;
+            for (bool with_text : { true, false })
+            {
+                fs::path pack_path = dir / "corpus.pack";
+                PackOptions options;
+                options.extract_text = with_text;
+                PackSummary summary = write_pack(files, pack_path.string(), options);
+                PackReader pack(pack_path.string());
+                BatchResult packed = analyze_pack(pack, stops, 3);
+                build_word_maps(packed.stats);
 
-            std::cout << "[bench] Имитация анализа " << iterations
-                      << " небольших текстов заняла " << ms << " мс\n";
+                ok = ok && summary.documents == files.size() && summary.with_text == (with_text ? 42u : 0u) &&
+                     pack.size() == files.size() && pack.name(0) == files[0] &&
+                     packed.files_ok == expected.files_ok && packed.failed.size() == expected.failed.size() &&
+                     packed.stats.total_words == expected.stats.total_words &&
+                     packed.stats.total_sentences == expected.stats.total_sentences &&
+                     packed.stats.word_freq == expected.stats.word_freq &&
+                     packed.stats.word_freq_no_stops == expected.stats.word_freq_no_stops;
+                for (size_t i = 0; ok && i < packed.failed.size(); ++i)
+                    ok = packed.failed[i].path == expected.failed[i].path &&
+                         packed.failed[i].message == expected.failed[i].message;
+
+                for (size_t parts : { 1, 3, 7, 100 })
+                {
+                    std::vector<PackReader::Range> ranges = pack.ranges(parts);
+                    size_t next = 0;
+                    for (const PackReader::Range& range : ranges)
+                    {
+                        ok = ok && range.begin == next && range.end > range.begin;
+                        next = range.end;
+                    }
+                    ok = ok && next == pack.size() && ranges.size() <= parts;
+                }
+            }
+
+            std::ofstream(dir / "bad.pack") << "TFPK but not a pack";
+            try
+            {
+                PackReader bad((dir / "bad.pack").string());
+                ok = false;
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+            fs::remove_all(dir);
+
+            if (!ok)
+            {
+                std::cerr << "Самотест: анализ упакованного корпуса расходится с анализом файлов\n";
+                return 1;
+            }
+        }
+
+        // N-граммы (--ngram): топ совпадает с наивным подсчётом строк "слово слово",
+        // n-граммы не пересекают предложений и блоков, подача кусками ничего не меняет.
+        {
+            const std::vector<std::string> stops{ "the", "a", "и" };
+            const StopwordSet stop_set(stops);
+            const char* vocabulary[] = { "the", "a", "и", "cat", "dog", "Кот", "пёс", "saw", "ran" };
+            std::mt19937 rng(19);
+            std::vector<std::string> blocks(3);
+            for (std::string& block : blocks)
+            {
+                for (int i = 0; i < 4000; ++i)
+                {
+                    block += vocabulary[rng() % 9];
+                    block += (rng() % 7 == 0) ? ". " : (rng() % 5 == 0 ? ", " : " ");
+                }
+            }
+
+            bool ok = true;
+            for (size_t n : { 2u, 3u })
+            {
+                for (bool skip : { true, false })
+                {
+                    // Наивный подсчёт: предложения — по точкам, блоки — отдельно.
+                    std::map<std::string, size_t> naive;
+                    size_t total = 0;
+                    for (const std::string& block : blocks)
+                    {
+                        std::vector<std::string> sentence;
+                        auto flush = [&] {
+                            for (size_t i = 0; i + n <= sentence.size(); ++i)
+                            {
+                                std::string phrase;
+                                bool all_stop = true;
+                                for (size_t k = 0; k < n; ++k)
+                                {
+                                    phrase += (k ? " " : "") + sentence[i + k];
+                                    all_stop = all_stop && std::find(stops.begin(), stops.end(), sentence[i + k]) != stops.end();
+                                }
+                                if (skip && all_stop)
+                                    continue;
+                                ++naive[phrase];
+                                ++total;
+                            }
+                            sentence.clear();
+                        };
+                        std::string word;
+                        for (char c : block)
+                        {
+                            if (c == ' ' || c == ',' || c == '.')
+                            {
+                                if (!word.empty())
+                                    sentence.push_back(unicode::to_lower(word));
+                                word.clear();
+                                if (c == '.')
+                                    flush();
+                            }
+                            else
+                            {
+                                word += c;
+                            }
+                        }
+                        if (!word.empty())
+                            sentence.push_back(unicode::to_lower(word));
+                        flush();
+                    }
+                    std::vector<std::pair<std::string, size_t>> expected(naive.begin(), naive.end());
+                    std::sort(expected.begin(), expected.end(), [](const auto& x, const auto& y) {
+                        return x.second != y.second ? x.second > y.second : x.first < y.first;
+                    });
+                    expected.resize(std::min<size_t>(expected.size(), 15));
+
+                    NgramOptions options;
+                    options.n = n;
+                    options.skip_stop_only = skip;
+                    NgramAnalyzer analyzer(stop_set, options);
+                    for (const std::string& block : blocks)
+                    {
+                        for (size_t pos = 0; pos < block.size(); pos += 333)
+                            analyzer.feed(std::string_view(block).substr(pos, 333));
+                        analyzer.end_block();
+                    }
+                    TextStats stats = analyzer.finish(15);
+                    TopWords top = top_words(stats, 15);
+                    ok = ok && stats.ngrams && stats.ngrams->total == total &&
+                         stats.ngrams->distinct == naive.size() && top.all.size() == expected.size();
+                    for (size_t i = 0; ok && i < expected.size(); ++i)
+                        ok = top.all[i].word == expected[i].first && top.all[i].count == expected[i].second;
+                    ok = ok && stats.total_words == analyze_text(blocks, stops).total_words;
+                }
+            }
+            if (!ok)
+            {
+                std::cerr << "Самотест: частоты n-грамм расходятся с наивным подсчётом\n";
+                return 1;
+            }
+        }
+
+        // Машиночитаемые отчёты (--format): двоичный читается обратно без потерь,
+        // JSON разбирается нашим парсером, CSV экранирует кавычки и запятые.
+        {
+            namespace fs = std::filesystem;
+            const fs::path dir = fs::temp_directory_path() / "textfreq_report_test";
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+
+            const std::vector<std::string> stops{ "the", "и" };
+            const std::vector<std::string> blocks{ "The cat and the dog. Кот и пёс!", "Dog, cat; dog?" };
+            TextStats exact = with_word_maps(analyze_text(blocks, stops));
+            const StopwordSet stop_set(stops);
+            ApproxAnalyzer approx_analyzer(stop_set, ApproxOptions{});
+            for (const std::string& block : blocks)
+            {
+                approx_analyzer.feed(block);
+                approx_analyzer.end_block();
+            }
+            TextStats approx = with_word_maps(approx_analyzer.finish());
+
+            bool ok = true;
+            for (const TextStats* stats : { &exact, &approx })
+            {
+                const std::string path = (dir / "report.bin").string();
+                {
+                    FdWriter out(path);
+                    write_report(out, *stats, 10, ReportFormat::Binary);
+                    out.close();
+                }
+                TextStats loaded = with_word_maps(read_binary_report(path));
+                ok = ok && loaded.total_words == stats->total_words &&
+                     loaded.total_sentences == stats->total_sentences &&
+                     loaded.unique_words == stats->unique_words && loaded.word_freq == stats->word_freq &&
+                     loaded.word_freq_no_stops == stats->word_freq_no_stops &&
+                     loaded.length_distribution == stats->length_distribution &&
+                     loaded.approx.has_value() == stats->approx.has_value() &&
+                     format_report(loaded, 10) == format_report(*stats, 10);
+            }
+
+            // Статистика только из упорядоченных представлений, со словами,
+            // которые требуют экранирования.
+            TextStats odd;
+            odd.total_words = 3;
+            odd.word_freq = { { "a,\"b", 2 }, { "x\ny", 1 } };
+            odd.word_freq_no_stops = { { "a,\"b", 2 } };
+            {
+                FdWriter out((dir / "report.json").string());
+                write_report(out, odd, 1, ReportFormat::Json);
+                out.close();
+                FdWriter csv((dir / "report.csv").string());
+                write_report(csv, odd, 1, ReportFormat::Csv);
+                csv.close();
+            }
+            InputFile json_file((dir / "report.json").string());
+            json::Parser parser(json_file.view());
+            json::Tape tape;
+            parser.parse(tape);
+            auto words = tape.find(json::Tape::root(), "words");
+            ok = ok && words && tape[*words].count == 2;
+            if (ok)
+            {
+                auto first = tape.find(*words + 1, "word");
+                auto stop = tape.find(tape.next(*words + 1), "stop");
+                ok = first && tape[*first].str == "a,\"b" && stop && tape[*stop].boolean;
+            }
+            InputFile csv_file((dir / "report.csv").string());
+            ok = ok && csv_file.view() == "word,count,stop,length\n\"a,\"\"b\",2,0,4\n\"x\ny\",1,1,3\n";
+
+            std::ofstream(dir / "bad.bin") << "TFRP and nothing else";
+            try
+            {
+                read_binary_report((dir / "bad.bin").string());
+                ok = false;
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+            fs::remove_all(dir);
+
+            if (!ok)
+            {
+                std::cerr << "Самотест: машиночитаемый отчёт не совпадает с исходной статистикой\n";
+                return 1;
+            }
+        }
+
+        // Сервер (--serve): ответ совпадает с разовым отчётом, ошибки возвращаются
+        // статусом, рамки stdin/stdout обрабатываются пулом и сопоставляются по id.
+        {
+            const std::vector<std::string> stops{ "the", "a" };
+            Server::Options options;
+            options.threads = 3;
+            options.top_n = 4;
+            options.max_pending = 2; // 50 рамок упираются в очередь
+            Server server(StopwordSet(stops), options);
+
+            const std::string document = R"({"text": "The cat saw a dog. The dog saw the cat!"})";
+            const std::string expected =
+                format_report(analyze_text(std::vector<std::string>{ "The cat saw a dog. The dog saw the cat!" }, stops), 4);
+            std::string response;
+            bool ok = server.handle(document, response) == Server::Ok && response == expected;
+            ok = ok && server.handle("top=2 format=csv\n" + document, response) == Server::Ok &&
+                 response.rfind("word,count,stop,length\nthe,3,1,3\ncat,2,0,3\n", 0) == 0;
+            ok = ok && server.handle("{\"text\": ", response) == Server::Error &&
+                 server.handle("colour=red\n" + document, response) == Server::Error;
+            // stops= выбирает только наборы, загруженные при запуске, а не пути.
+            server.add_stopwords("none", StopwordSet(std::vector<std::string>{}));
+            ok = ok && server.handle("top=1 format=csv stops=none\n" + document, response) == Server::Ok &&
+                 response.rfind("word,count,stop,length\nthe,3,0,3\n", 0) == 0;
+            ok = ok && server.handle("stops=data/stopwords.json\n" + document, response) == Server::Error;
+            // Слишком глубокая вложенность — ответ с ошибкой, а не падение сервера.
+            ok = ok && server.handle("{\"text\": \"a\", \"x\": " + std::string(200000, '[') + std::string(200000, ']') + "}",
+                                     response) == Server::Error;
+
+#if !defined(_WIN32)
+            int requests[2];
+            int responses[2];
+            if (::pipe(requests) != 0 || ::pipe(responses) != 0)
+                throw std::runtime_error("pipe");
+            std::string input;
+            const auto put_u32 = [&](std::uint32_t v) {
+                for (int shift = 0; shift < 32; shift += 8)
+                    input.push_back(static_cast<char>((v >> shift) & 0xFF));
+            };
+            for (std::uint32_t id = 0; id < 50; ++id)
+            {
+                const std::string payload = id % 10 == 9 ? std::string("{oops") : document;
+                put_u32(static_cast<std::uint32_t>(payload.size()));
+                put_u32(id);
+                input += payload;
+            }
+            std::thread writer([&] {
+                ::write(requests[1], input.data(), input.size());
+                ::close(requests[1]);
+            });
+            std::string output;
+            std::thread reader([&] {
+                char buffer[4096];
+                ssize_t n;
+                while ((n = ::read(responses[0], buffer, sizeof(buffer))) > 0)
+                    output.append(buffer, static_cast<size_t>(n));
+            });
+            server.serve_stream(requests[0], responses[1]);
+            ::close(responses[1]);
+            writer.join();
+            reader.join();
+            ::close(requests[0]);
+            ::close(responses[0]);
+
+            std::vector<int> seen(50, 0);
+            size_t pos = 0;
+            while (ok && pos + 9 <= output.size())
+            {
+                std::uint32_t length = 0;
+                std::uint32_t id = 0;
+                std::memcpy(&length, output.data() + pos, 4);
+                std::memcpy(&id, output.data() + pos + 4, 4);
+                ok = id < 50 && pos + 8 + length <= output.size();
+                if (!ok)
+                    break;
+                const bool failed = output[pos + 8] != Server::Ok;
+                ok = failed == (id % 10 == 9) &&
+                     (failed || output.compare(pos + 9, length - 1, expected) == 0);
+                ++seen[id];
+                pos += 8 + length;
+            }
+            ok = ok && pos == output.size() && std::count(seen.begin(), seen.end(), 1) == 50;
+            ok = ok && server.latency().requests == 57 && server.latency().p50 <= server.latency().max;
+#endif
+            if (!ok)
+            {
+                std::cerr << "Самотест: ответы сервера расходятся с разовым анализом\n";
+                return 1;
+            }
+        }
+
+#if !defined(_WIN32)
+        // Сервер сокета с одним потоком: простаивающее соединение посреди рамки не
+        // держит поток — другой клиент получает ответ и останавливает сервер.
+        {
+            namespace fs = std::filesystem;
+            const std::string socket_path = (fs::temp_directory_path() / "textfreq_serve_selftest.sock").string();
+            Server::Options options;
+            options.threads = 1;
+            options.top_n = 3;
+            Server server(StopwordSet(std::vector<std::string>{}), options);
+            std::thread serving([&] { server.serve_unix(socket_path); });
+
+            const auto connect_client = [&socket_path] {
+                sockaddr_un address{};
+                address.sun_family = AF_UNIX;
+                std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+                for (int attempt = 0; attempt < 500; ++attempt)
+                {
+                    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+                    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0)
+                    {
+                        // Зависший ответ — провал теста, а не вечное ожидание.
+                        timeval timeout{5, 0};
+                        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                        return fd;
+                    }
+                    ::close(fd);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                return -1;
+            };
+            const auto ask = [](int fd, std::uint32_t id, const std::string& payload, std::string& body) {
+                std::string frame;
+                for (std::uint32_t v : { static_cast<std::uint32_t>(payload.size()), id })
+                    for (int shift = 0; shift < 32; shift += 8)
+                        frame.push_back(static_cast<char>((v >> shift) & 0xFF));
+                frame += payload;
+                if (::write(fd, frame.data(), frame.size()) != static_cast<ssize_t>(frame.size()))
+                    return false;
+                const auto take = [fd](char* data, size_t size) {
+                    for (size_t done = 0; done < size;)
+                    {
+                        const ssize_t n = ::read(fd, data + done, size - done);
+                        if (n <= 0)
+                            return false;
+                        done += static_cast<size_t>(n);
+                    }
+                    return true;
+                };
+                char header[9];
+                if (!take(header, sizeof(header)))
+                    return false;
+                std::uint32_t length = 0;
+                std::uint32_t got_id = 0;
+                std::memcpy(&length, header, 4);
+                std::memcpy(&got_id, header + 4, 4);
+                body.assign(length - 1, '\0');
+                return take(body.data(), body.size()) && got_id == id && header[8] == Server::Ok;
+            };
+
+            const int idle = connect_client();
+            const int active = connect_client();
+            bool ok = idle >= 0 && active >= 0 && ::write(idle, "\x05\0", 2) == 2;
+            std::string body;
+            ok = ok && ask(active, 7, R"({"text": "one two two"})", body) && body.find("two") != std::string::npos;
+            ok = ok && ask(active, 8, "shutdown", body);
+            if (!ok)
+                server.stop(); // упавший тест не должен виснуть на join
+            serving.join();
+            ::close(idle);
+            ::close(active);
+            if (!ok)
+            {
+                std::cerr << "Самотест: простаивающее соединение сокета задерживает других клиентов\n";
+                return 1;
+            }
+        }
+#endif
+
+        // Упреждающее чтение (--read-ahead): io_uring и потоки чтения дают тот же
+        // результат, что обычный пакетный режим, в том числе при крошечном пределе
+        // памяти, файле больше предела и отсутствующем файле.
+        {
+            namespace fs = std::filesystem;
+            fs::path dir = fs::temp_directory_path() / "textfreq_read_ahead_selftest";
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+            std::vector<std::string> files;
+            for (size_t i = 0; i < 40; ++i)
+            {
+                std::string text;
+                for (size_t k = 0; k < (i == 7 ? 20000 : i * 37 + 1); ++k)
+                    text += "w" + std::to_string((k * 7 + i) % 53) + (k % 9 == 8 ? ". " : " ");
+                files.push_back((dir / ("doc_" + std::to_string(i) + ".json")).string());
+                std::ofstream(files.back()) << "{\"text\": \"" << text << "\"}";
+            }
+            std::ofstream(dir / "broken.json") << R"({ "text": "no closing brace" )";
+            files.push_back((dir / "broken.json").string());
+            files.push_back((dir / "missing.json").string());
+
+            StopwordSet stops(std::vector<std::string>{ "w1", "w2" });
+            BatchResult expected = analyze_files(files, stops, 3);
+            build_word_maps(expected.stats);
+            bool ok = expected.files_ok == 40 && expected.failed.size() == 2;
+            for (bool uring : { true, false })
+            {
+                ReadAheadOptions options;
+                options.queue_depth = 4;
+                options.max_inflight_bytes = 16 * 1024; // doc_7 крупнее предела
+                options.use_uring = uring;
+                BatchResult got = analyze_files(files, stops, 3, options);
+                build_word_maps(got.stats);
+                ok = ok && got.files_ok == expected.files_ok && got.failed.size() == expected.failed.size() &&
+                     got.bytes_read == expected.bytes_read && got.stats.total_words == expected.stats.total_words &&
+                     got.stats.total_sentences == expected.stats.total_sentences &&
+                     got.stats.word_freq == expected.stats.word_freq;
+                for (size_t i = 0; ok && i < got.failed.size(); ++i)
+                    ok = got.failed[i].path == expected.failed[i].path;
+            }
+            fs::remove_all(dir);
+            if (!ok)
+            {
+                std::cerr << "Самотест: упреждающее чтение расходится с обычным пакетным режимом\n";
+                return 1;
+            }
+        }
+
+        // map/reduce: шарды делят набор без пересечений, а слияние частичных
+        // результатов совпадает с анализом всего набора одним процессом.
+        {
+            namespace fs = std::filesystem;
+            fs::path dir = fs::temp_directory_path() / "textfreq_partial_selftest";
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+            std::vector<std::string> files;
+            for (size_t i = 0; i < 30; ++i)
+            {
+                std::string text;
+                for (size_t k = 0; k < i * 11 + 3; ++k)
+                    text += "w" + std::to_string((k * 5 + i) % 41) + (k % 6 == 5 ? ". " : " ");
+                files.push_back((dir / ("doc_" + std::to_string(i) + ".json")).string());
+                std::ofstream(files.back()) << "{\"text\": \"" << text << "\"}";
+            }
+            std::ofstream(dir / "broken.json") << R"({ "text": )";
+            files.push_back((dir / "broken.json").string());
+
+            StopwordSet stops(std::vector<std::string>{ "w1", "w3" });
+            BatchResult expected = analyze_files(files, stops, 2);
+            build_word_maps(expected.stats);
+
+            const size_t shards = 3;
+            std::vector<std::string> partials;
+            size_t selected = 0;
+            for (size_t i = 0; i < shards; ++i)
+            {
+                const ShardSpec shard = parse_shard(std::to_string(i) + "/" + std::to_string(shards));
+                std::vector<std::string> part = select_shard(files, shard);
+                selected += part.size();
+                partials.push_back((dir / ("partial_" + std::to_string(i) + ".bin")).string());
+                write_partial(partials.back(), analyze_files(part, stops, 2), shard, stops);
+            }
+            std::reverse(partials.begin(), partials.end()); // порядок файлов не важен
+            BatchResult reduced = reduce_partials(partials);
+            build_word_maps(reduced.stats);
+
+            bool ok = selected == files.size() && reduced.files_total == expected.files_total &&
+                      reduced.files_ok == expected.files_ok && reduced.failed.size() == 1 &&
+                      reduced.failed[0].path == expected.failed[0].path &&
+                      reduced.bytes_read == expected.bytes_read &&
+                      reduced.stats.total_words == expected.stats.total_words &&
+                      reduced.stats.total_sentences == expected.stats.total_sentences &&
+                      reduced.stats.word_freq == expected.stats.word_freq &&
+                      reduced.stats.word_freq_no_stops == expected.stats.word_freq_no_stops &&
+                      reduced.stats.length_distribution == expected.stats.length_distribution;
+
+            // Неполный набор шардов, повтор шарда и неверная запись шарда отвергаются.
+            auto rejects = [](auto&& action) {
+                try
+                {
+                    action();
+                }
+                catch (const std::runtime_error&)
+                {
+                    return true;
+                }
+                return false;
+            };
+            ok = ok && rejects([&] { reduce_partials({ partials[0], partials[1] }); }) &&
+                 rejects([&] { reduce_partials({ partials[0], partials[1], partials[2], partials[0] }); }) &&
+                 rejects([] { parse_shard("3/3"); }) && rejects([] { parse_shard("1/x"); });
+            fs::remove_all(dir);
+            if (!ok)
+            {
+                std::cerr << "Самотест: reduce частичных результатов расходится с анализом всего набора\n";
+                return 1;
+            }
+        }
+
+        // NDJSON: строки режутся верно при любом окне чтения, ошибочные строки
+        // пропускаются, а статистика совпадает с анализом тех же документов целиком.
+        {
+            std::string stream;
+            std::vector<std::string> texts;
+            for (size_t i = 0; i < 300; ++i)
+            {
+                std::string text;
+                for (size_t k = 0; k < i % 17 + 1; ++k)
+                    text += "w" + std::to_string((k * 3 + i) % 29) + (k % 5 == 4 ? ". " : " ");
+                texts.push_back(text);
+                stream += "{\"text\": \"" + text + "\"}" + (i % 3 == 0 ? "\r\n" : "\n");
+                if (i % 50 == 7)
+                    stream += "{\"text\": \"broken\n\n";
+                if (i % 60 == 11)
+                    stream += "[{\"paragraph\": \"x\"}, \"" + std::string(600, 'y') + "\"]\n"; // длиннее предела
+            }
+            stream += "{\"title\": \"no text\"}\n{\"text\": \"last line without newline\"}";
+            texts.push_back("last line without newline");
+            TextStats expected = with_word_maps(analyze_text(texts, { "w2" }));
+
+            bool ok = true;
+            for (size_t window : { size_t{1}, size_t{13}, size_t{4096} })
+            {
+                std::istringstream in(stream);
+                LineReader reader(in, 512, window);
+                size_t lines = 0;
+                for (std::string_view line; reader.next(line);)
+                    ok = ok && (reader.oversized() || line.size() <= 512) && line.find('\r') == std::string_view::npos &&
+                         ++lines == reader.line_number();
+                ok = ok && reader.capacity() <= 2 * (512 + window) + 1 && reader.bytes() == stream.size();
+            }
+            // Без чтения (остановка по сигналу) отдаются только целые строки из буфера.
+            {
+                std::istringstream in("l1\nl2\nl3 tail\n");
+                LineReader reader(in, 512, 8);
+                std::string_view line;
+                ok = ok && reader.next(line) && line == "l1" && reader.next(line, false) && line == "l2" &&
+                     !reader.next(line, false) && reader.buffered() == 2 && reader.bytes() == 8 &&
+                     reader.next(line) && line == "l3 tail" && reader.buffered() == 0;
+            }
+            // Вход, оборванный посреди слишком длинной строки: она всё равно считается ошибкой.
+            // Строка ровно в предел — обычная, даже если окно кончилось на ней.
+            for (size_t tail_size : { size_t{512}, size_t{513}, size_t{600} })
+            {
+                const std::string cut = "{\"text\": \"a\"}\n" + std::string(tail_size, 'z');
+                for (size_t window : { size_t{1}, size_t{64} })
+                {
+                    std::istringstream in(cut);
+                    LineReader reader(in, 512, window);
+                    std::string_view line;
+                    ok = ok && reader.next(line) && !reader.oversized() && reader.next(line) &&
+                         reader.oversized() == (tail_size > 512) && reader.line_number() == 2 && !reader.next(line);
+                }
+                std::istringstream in(cut);
+                StreamingAnalyzer tail_analyzer(std::vector<std::string>{});
+                NdjsonSummary tail = analyze_ndjson(in, tail_analyzer, nullptr, 512);
+                ok = ok && tail.lines == 2 && tail.records == 1 && tail.errors == 1;
+            }
+
+            std::istringstream in(stream);
+            StopwordSet stops(std::vector<std::string>{ "w2" });
+            StreamingAnalyzer analyzer(stops);
+            NdjsonSummary summary = analyze_ndjson(in, analyzer, nullptr, 512);
+            TextStats got = with_word_maps(analyzer.finish());
+            ok = ok && summary.records == 301 && summary.empty == 6 && summary.errors == 6 + 5 + 1 &&
+                 summary.first_errors.size() == NdjsonSummary::kReportedErrors &&
+                 got.total_words == expected.total_words && got.total_sentences == expected.total_sentences &&
+                 got.word_freq == expected.word_freq && got.word_freq_no_stops == expected.word_freq_no_stops;
+            if (!ok)
+            {
+                std::cerr << "Самотест: разбор NDJSON расходится с анализом документов целиком\n";
+                return 1;
+            }
+        }
+
+        // Вложенность JSON: kMaxDepth уровней разбирается, глубже — ParseError в
+        // ленте, DOM и SAX, а не переполнение стека.
+        {
+            const auto nested = [](size_t depth) {
+                return "{\"text\": \"a\", \"x\": " + std::string(depth - 1, '[') + std::string(depth - 1, ']') + "}";
+            };
+            const auto rejects = [](auto&& parse) {
+                try
+                {
+                    parse();
+                }
+                catch (const json::ParseError&)
+                {
+                    return true;
+                }
+                return false;
+            };
+            bool ok = true;
+            for (size_t depth : { json::kMaxDepth, json::kMaxDepth + 1, size_t{200000} })
+            {
+                const std::string doc = nested(depth);
+                const bool too_deep = depth > json::kMaxDepth;
+                json::Tape tape;
+                json::SaxHandler ignore;
+                std::istringstream in(doc);
+                ok = ok && rejects([&] { json::Parser(doc).parse(tape); }) == too_deep &&
+                     rejects([&] { json::Parser(doc).parse(); }) == too_deep &&
+                     rejects([&] { json::SaxParser(in, 64).parse(ignore); }) == too_deep;
+            }
+            if (!ok)
+            {
+                std::cerr << "Самотест: предел вложенности JSON не соблюдается\n";
+                return 1;
+            }
+        }
+
+        // Разбор JSON: \uXXXX (в том числе суррогатные пары и одиночные суррогаты),
+        // числа и пробелы одинаковы в ленте, DOM и SAX при любом окне
+        {
+            struct Collector : json::SaxHandler
+            {
+                std::vector<std::string> strings;
+                std::vector<double> numbers;
+                bool on_string_begin() override
+                {
+                    strings.emplace_back();
+                    return true;
+                }
+                void on_string_chunk(std::string_view chunk) override { strings.back() += chunk; }
+                void on_key(std::string_view key) override { strings.emplace_back(key); }
+                void on_number(double value) override { numbers.push_back(value); }
+            };
+
+            const std::string spaces = " \t\r\n\v\f";
+            std::string doc = spaces + R"({"kéy")" + spaces + ":" + spaces +
+                              R"("при \"q\"\/ 😀 \ud800x \udc00 \ud800\n \ud83d😀 A\ud83d\ud83d\ude00",)" +
+                              R"( "n": [0, -0.5, 12.5e-1, 1E3, -7e+2, 123456789, 0.1],)" + spaces +
+                              R"("long": ")" + std::string(100, 'a') + R"(\t", "w": [)" + spaces + "]}" + spaces;
+            const std::string replacement = "\xEF\xBF\xBD";
+            const std::string emoji = "\xF0\x9F\x98\x80";
+            const std::vector<std::string> expected_strings = {
+                "k\xC3\xA9y",
+                "\xD0\xBF\xD1\x80\xD0\xB8 \"q\"/ " + emoji + " " + replacement + "x " + replacement + " " + replacement +
+                    "\n " + replacement + emoji + " A" + replacement + emoji,
+                "n", "long", std::string(100, 'a') + "\t", "w",
+            };
+            const std::vector<double> expected_numbers = { 0, -0.5, 1.25, 1000, -700, 123456789, 0.1 };
+
+            bool ok = true;
+            json::Tape tape;
+            json::Parser(doc).parse(tape);
+            std::vector<std::string> tape_strings;
+            std::vector<double> tape_numbers;
+            for (size_t i = 0; i < tape.size(); ++i)
+            {
+                if (tape[i].type == json::NodeType::String)
+                    tape_strings.emplace_back(tape[i].str);
+                else if (tape[i].type == json::NodeType::Number)
+                    tape_numbers.push_back(tape[i].number);
+            }
+            ok = ok && tape_strings == expected_strings && tape_numbers == expected_numbers;
+
+            json::Value root = json::Parser(doc).parse();
+            const auto& object = std::get<json::Object>(root.data);
+            ok = ok && object.count(expected_strings[0]) == 1 &&
+                 std::get<std::string>(object.at(expected_strings[0]).data) == expected_strings[1];
+
+            for (size_t window : { size_t{1}, size_t{3}, size_t{17}, size_t{64 * 1024} })
+            {
+                std::istringstream in(doc);
+                Collector collector;
+                json::SaxParser(in, window).parse(collector);
+                ok = ok && collector.strings == expected_strings && collector.numbers == expected_numbers;
+            }
+            if (!ok)
+            {
+                std::cerr << "Самотест: экранирования, числа или пробелы JSON разобраны неверно\n";
+                return 1;
+            }
+
+            for (std::string bad : { R"("\u12G4")", R"("\x")", R"("abc)", R"("\)", "01", "-", "1.", "1e+", "1e999" })
+            {
+                bool failed = false;
+                try
+                {
+                    json::Parser(bad).parse();
+                }
+                catch (const json::ParseError&)
+                {
+                    failed = true;
+                }
+                if (!failed)
+                {
+                    std::cerr << "Самотест: ожидалась ошибка разбора " << bad << "\n";
+                    return 1;
+                }
+            }
+        }
+
+        // Сжатый вход: .json.gz читается InputFile, потоком и в пакетном режиме
+        // (в том числе с упреждающим чтением) так же, как несжатый; склеенные
+        // gzip-члены — один поток; обрезанный файл и несобранный формат — ошибка.
+        {
+            namespace fs = std::filesystem;
+            fs::path dir = fs::temp_directory_path() / "textfreq_compression_selftest";
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+            bool ok = compression_of("a.json.gz") == Compression::Gzip &&
+                      compression_of("a.json.zst") == Compression::Zstd &&
+                      compression_of("a.json") == Compression::None && compression_of("gz") == Compression::None;
+
+            if (compression_supported(Compression::Gzip))
+            {
+                std::vector<std::string> plain;
+                std::vector<std::string> packed;
+                for (size_t i = 0; i < 12; ++i)
+                {
+                    std::string text;
+                    for (size_t k = 0; k < (i == 3 ? 60000 : i * 41 + 1); ++k)
+                        text += "w" + std::to_string((k * 13 + i) % 97) + (k % 7 == 6 ? ". " : " ");
+                    const std::string document = "{\"text\": \"" + text + "\"}";
+                    plain.push_back((dir / ("doc_" + std::to_string(i) + ".json")).string());
+                    packed.push_back(plain.back() + ".gz");
+                    std::ofstream(plain.back(), std::ios::binary) << document;
+                    // Крупный документ — из трёх склеенных gzip-членов.
+                    std::string compressed = compress(document, Compression::Gzip);
+                    if (i == 3)
+                    {
+                        const size_t third = document.size() / 3;
+                        compressed = compress(std::string_view(document).substr(0, third), Compression::Gzip) +
+                                     compress(std::string_view(document).substr(third, third), Compression::Gzip) +
+                                     compress(std::string_view(document).substr(2 * third), Compression::Gzip);
+                    }
+                    std::ofstream(packed.back(), std::ios::binary) << compressed;
+
+                    InputFile input(packed.back());
+                    ok = ok && input.view() == document;
+                    auto stream = open_input_stream(packed.back());
+                    std::string streamed((std::istreambuf_iterator<char>(*stream)), std::istreambuf_iterator<char>());
+                    ok = ok && streamed == document;
+                }
+                ok = ok && list_json_files(dir.string()).size() == plain.size() + packed.size();
+
+                StopwordSet stops(std::vector<std::string>{ "w5" });
+                BatchResult expected = analyze_files(plain, stops, 2);
+                build_word_maps(expected.stats);
+                ReadAheadOptions options;
+                options.queue_depth = 3;
+                options.use_uring = false;
+                for (BatchResult got : { analyze_files(packed, stops, 2), analyze_files(packed, stops, 2, options) })
+                {
+                    build_word_maps(got.stats);
+                    ok = ok && got.files_ok == plain.size() && got.failed.empty() &&
+                         got.bytes_read == expected.bytes_read && got.stats.word_freq == expected.stats.word_freq &&
+                         got.stats.word_freq_no_stops == expected.stats.word_freq_no_stops &&
+                         got.stats.total_sentences == expected.stats.total_sentences;
+                }
+
+                const std::string whole = compress("{\"text\": \"truncated\"}", Compression::Gzip);
+                const fs::path truncated = dir / "truncated.json.gz";
+                std::ofstream(truncated, std::ios::binary) << whole.substr(0, whole.size() - 6);
+                bool failed = false;
+                try
+                {
+                    InputFile input(truncated.string());
+                }
+                catch (const std::runtime_error&)
+                {
+                    failed = true;
+                }
+                ok = ok && failed;
+                BatchResult broken = analyze_files({ truncated.string() }, stops, 1);
+                ok = ok && broken.files_ok == 0 && broken.failed.size() == 1;
+            }
+            if (!compression_supported(Compression::Zstd))
+            {
+                const fs::path zst = dir / "doc.json.zst";
+                std::ofstream(zst, std::ios::binary) << "x";
+                try
+                {
+                    InputFile input(zst.string());
+                    ok = false;
+                }
+                catch (const std::runtime_error& e)
+                {
+                    ok = ok && std::string(e.what()).find("zstd") != std::string::npos;
+                }
+            }
+            fs::remove_all(dir);
+            if (!ok)
+            {
+                std::cerr << "Самотест: сжатый вход читается не так, как несжатый\n";
+                return 1;
+            }
+        }
+
+        // Внешний подсчёт (--mem-limit): таблица в минимальном бюджете сбрасывается
+        // многими прогонами, слияние идёт в несколько проходов, а частоты, топ и
+        // отчёт совпадают с подсчётом в памяти — и для одного анализатора, и в пакетном режиме.
+        {
+            namespace fs = std::filesystem;
+            fs::path dir = fs::temp_directory_path() / "textfreq_external_selftest";
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+
+            std::vector<std::string> blocks;
+            std::vector<std::string> files;
+            for (size_t i = 0; i < 8; ++i)
+            {
+                std::string text;
+                for (size_t k = 0; k < 3000; ++k)
+                    text += "w" + std::to_string((k * 7919 + i * 31) % (k % 3 ? 9000 : 40)) + (k % 9 == 8 ? ". " : " ");
+                blocks.push_back(text);
+                files.push_back((dir / ("doc_" + std::to_string(i) + ".json")).string());
+                std::ofstream(files.back()) << "{\"text\": \"" << text << "\"}";
+            }
+            StopwordSet stops(std::vector<std::string>{ "w0", "w7", "w12" });
+            const size_t top_n = 15;
+            TextStats expected = with_word_maps(analyze_text(blocks, stops));
+
+            TextStats got;
+            std::map<std::string, size_t> merged;
+            std::map<std::string, size_t> merged_no_stops;
+            bool ok = true;
+            {
+                ExternalCounter counter(ExternalCounter::kMinLimit, (dir / "runs").string());
+                StreamingAnalyzer analyzer(stops);
+                analyzer.spill_to(counter, counter.memory_limit());
+                for (const std::string& block : blocks)
+                {
+                    analyzer.feed(block);
+                    analyzer.end_block();
+                }
+                got = analyzer.finish();
+                counter.finish(got, top_n);
+                ok = counter.runs() > 3 && counter.intermediate_merges() > 0 &&
+                     counter.spilled_words() > expected.unique_words;
+                counter.merge([&](std::string_view word, std::uint64_t count, bool stop, std::uint32_t) {
+                    merged.emplace(std::string(word), count);
+                    if (!stop)
+                        merged_no_stops.emplace(std::string(word), count);
+                });
+            }
+            // Каталог прогонов удаляется вместе с ExternalCounter.
+            ok = ok && fs::is_empty(dir / "runs") && merged == expected.word_freq &&
+                 merged_no_stops == expected.word_freq_no_stops && got.total_words == expected.total_words &&
+                 got.unique_words == expected.unique_words &&
+                 got.length_distribution == expected.length_distribution &&
+                 format_report(got, top_n) == format_report(expected, top_n);
+
+            BatchResult batch_expected = analyze_files(files, stops, 2);
+            ExternalCounter counter(2 * ExternalCounter::kMinLimit);
+            BatchResult batch_got = analyze_files(files, stops, 2, std::nullopt, &counter);
+            counter.finish(batch_got.stats, top_n);
+            ok = ok && counter.runs() > 2 && batch_got.files_ok == files.size() &&
+                 format_report(batch_got.stats, top_n) == format_report(batch_expected.stats, top_n);
+
+            // Бюджет меньше минимального отвергается.
+            try
+            {
+                ExternalCounter tiny(ExternalCounter::kMinLimit - 1);
+                ok = false;
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+            fs::remove_all(dir);
+            if (!ok)
+            {
+                std::cerr << "Самотест: внешний подсчёт расходится с подсчётом в памяти\n";
+                return 1;
+            }
+        }
+
+        // Профиль (--profile): токенизация и подсчёт через буфер слов дают тот же
+        // результат, что слитный путь, а этапы и счётчики заполняются.
+        // Профиль включается глобально, поэтому этот тест последний.
+        {
+            std::string text;
+            std::mt19937 rng(16);
+            const char* words[] = { "alpha", "Бета", "gamma", "и", "the", "ёлка", "delta-x", "don't" };
+            while (text.size() < 300 * 1024)
+            {
+                text += words[rng() % 8];
+                text += (rng() % 11 == 0) ? ". " : " ";
+            }
+            const std::vector<std::string> stops{ "the", "и" };
+            std::vector<std::string_view> blocks{ text, "Второй блок. alpha!" };
+
+            TextStats plain = with_word_maps(analyze_text(blocks, stops));
+            const StopwordSet stop_set(stops);
+            ApproxOptions approx_options;
+            ApproxAnalyzer plain_approx(stop_set, approx_options);
+            for (std::string_view block : blocks)
+            {
+                plain_approx.feed(block);
+                plain_approx.end_block();
+            }
+            TextStats plain_top = with_word_maps(plain_approx.finish());
+
+            profile::enable();
+            TextStats profiled = with_word_maps(analyze_text(blocks, stops));
+            ApproxAnalyzer profiled_approx(stop_set, approx_options);
+            for (std::string_view block : blocks)
+            {
+                profiled_approx.feed(block);
+                profiled_approx.end_block();
+            }
+            TextStats profiled_top = with_word_maps(profiled_approx.finish());
+            top_words(profiled, 10);
+
+            const std::string json = profile::format_json(1);
+            bool ok = profiled.total_words == plain.total_words
+                && profiled.total_sentences == plain.total_sentences
+                && profiled.word_freq == plain.word_freq
+                && profiled.word_freq_no_stops == plain.word_freq_no_stops
+                && profiled.length_distribution == plain.length_distribution
+                && profiled_top.word_freq == plain_top.word_freq
+                && profiled_top.total_sentences == plain_top.total_sentences;
+            for (const char* zero : { "\"tokenize\": 0,", "\"count\": 0,", "\"top_k\": 0,",
+                                      "\"ordered_views\": 0,", "\"hash_probes\": 0," })
+                ok = ok && json.find(zero) == std::string::npos;
+            if (!ok)
+            {
+                std::cerr << "Самотест: профилированный анализ расходится с обычным\n";
+                return 1;
+            }
         }
 
         std::cout << "Самотесты успешно пройдены.\n";